@@ -0,0 +1,69 @@
+#
+# Control transfers in the last word of an I-cache line (32-byte lines,
+# as in sim.conf), so that every delay slot is fetched from a line that
+# is not cached yet.  Each delay slot adds 1 to $8; the wrong path adds
+# 100.  Prints "ok" and exits with 0 when all four delay slots ran once.
+#
+       .section .text
+       .globl main
+       .ent main
+main:
+        li $8, 0      # delay slots executed
+        li $9, 1
+        la $10, b4
+        j b1
+        nop
+
+        .set noreorder
+        .align 5
+b1:     .space 28
+        j b2          # taken jump
+        addiu $8, $8, 1
+        addiu $8, $8, 100
+
+        .align 5
+b2:     .space 28
+        beq $9, $9, b3 # taken branch
+        addiu $8, $8, 1
+        addiu $8, $8, 100
+
+        .align 5
+b3:     .space 28
+        bne $9, $9, bad # branch not taken
+        addiu $8, $8, 1
+        .space 24
+        jr $10        # register jump
+        addiu $8, $8, 1
+        addiu $8, $8, 100
+        .set reorder
+
+        .align 5
+b4:     nop
+        li $11, 4
+        bne $8, $11, bad
+        nop
+        li $4, 1
+        la $5, ok
+        li $6, 3
+        li $2, 1004   # print
+        syscall
+        nop
+        li $4, 0
+        li $2, 1001   # exit
+        syscall
+        nop
+
+bad:    li $4, 1
+        la $5, notok
+        li $6, 4
+        li $2, 1004
+        syscall
+        nop
+        li $4, 1
+        li $2, 1001
+        syscall
+        nop
+
+ok:     .ascii "ok\n"
+notok:  .ascii "bad\n"
+        .end main
@@ -0,0 +1,84 @@
+#
+# Load-use on L1D misses (run with loaduse.conf: MSHRs, MemLatency 100).
+# Eight loads from cold lines, each read by the next instruction, so
+# each consumer has to wait out its load's miss: at least 8 x 100
+# cycles between the two SimTime backdoor calls.  The block runs twice
+# and only the second pass, with the I-cache warm and a fresh buffer,
+# is timed.  Prints "ok" and exits with 0 if the consumers waited.
+#
+       .section .text
+       .globl main
+       .ent main
+main:
+        la $16, buf
+        li $19, 2
+
+loop:   li $2, 1181   # SYS_backdoor
+        li $4, 1      # BackDoor_SimTime, cycle in $a0
+        syscall
+        nop
+        move $17, $4
+
+        .set noreorder
+        lw $8, 0($16)
+        addu $9, $9, $8
+        lw $8, 32($16)
+        addu $9, $9, $8
+        lw $8, 64($16)
+        addu $9, $9, $8
+        lw $8, 96($16)
+        addu $9, $9, $8
+        lw $8, 128($16)
+        addu $9, $9, $8
+        lw $8, 160($16)
+        addu $9, $9, $8
+        lw $8, 192($16)
+        addu $9, $9, $8
+        lw $8, 224($16)
+        addu $9, $9, $8
+        .set reorder
+
+        li $2, 1181
+        li $4, 1
+        syscall
+        nop
+        move $18, $4
+        addiu $16, $16, 256
+        addiu $19, $19, -1
+        bne $19, $0, loop
+        nop
+
+        subu $11, $18, $17
+        slti $10, $11, 800
+        bne $10, $0, bad
+        nop
+
+        li $4, 1
+        la $5, ok
+        li $6, 3
+        li $2, 1004   # print
+        syscall
+        nop
+        li $4, 0
+        li $2, 1001   # exit
+        syscall
+        nop
+
+bad:    li $4, 1
+        la $5, notok
+        li $6, 4
+        li $2, 1004
+        syscall
+        nop
+        li $4, 1
+        li $2, 1001
+        syscall
+        nop
+
+ok:     .ascii "ok\n"
+notok:  .ascii "bad\n"
+        .end main
+
+        .data
+        .align 5
+buf:    .space 512
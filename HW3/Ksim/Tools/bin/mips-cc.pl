@@ -5,6 +5,7 @@ $as="mips-sgi-irix5-as";
 $ld="mips-sgi-irix5-ld -no-warn-mismatch";
 $mipspath="/usr/local/lib/gcc-lib/mips-sgi-irix5";
 $image="$ENV{'SIMDIR'}/Tools/bin/genmipsimage.pl";
+$elf2image="$ENV{'SIMDIR'}/Tools/bin/elf2image";
 $cc="mips-sgi-irix5-gcc";
 
 
@@ -247,24 +248,29 @@ sub gen_image_file {
     printf ("Generating image for $infile -> $outfile\n");
   }
 
-  my_system ("$image $infile > $outfile");
-
   #
   # Determine entry point by looking at the executable
   #
 
-  open (FUBAR, "$objdump -h $infile|");
+  if (-x $elf2image) {
+    open (FUBAR, "$elf2image -e $infile|");
+    $entry_point=hex(<FUBAR>);
+    close(FUBAR);
+  }
+  else {
+    open (FUBAR, "$objdump -h $infile|");
 
-  $entry_point=0;
+    $entry_point=0;
 
-  while (<FUBAR>) {
-    if (/.text/) {
-      /.text\s+[0-9a-f]+\s+([0-9a-f]+)\s+/;
-      $entry_point=hex($1);
-      last;
+    while (<FUBAR>) {
+      if (/.text/) {
+        /.text\s+[0-9a-f]+\s+([0-9a-f]+)\s+/;
+        $entry_point=hex($1);
+        last;
+      }
     }
+    close(FUBAR);
   }
-  close(FUBAR);
 
 
   $tmpfile = "tmp.image.$$";
@@ -303,8 +309,19 @@ sub gen_image_file {
   }
   unlink ($tmpfile);
 
-  my_system ($image . " boot.o .text > boot.image");
-  my_system ("cat boot.image >> $outfile");
+  #
+  # Binary image (Tools/src/elf2image) when it has been built: program
+  # and boot code in one pass, loaded a segment at a time.  Otherwise
+  # fall back to the text format.
+  #
+  if (-x $elf2image) {
+    my_system ("$elf2image -o $outfile $infile boot.o");
+  }
+  else {
+    my_system ("$image $infile > $outfile");
+    my_system ($image . " boot.o .text > boot.image");
+    my_system ("cat boot.image >> $outfile");
+  }
 }
 
 
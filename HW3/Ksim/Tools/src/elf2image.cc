@@ -0,0 +1,199 @@
+/*-*-mode:c++-*-**********************************************************
+ *
+ *  elf2image -- convert big-endian MIPS ELF executables to a binary
+ *  memory image (lib/image.h) that Mem::ReadImage and MergeImage load in bulk.
+ *
+ *  usage: elf2image [-o <image>] <elf> [<elf> ...]
+ *         elf2image -e <elf>         print the entry point
+ *
+ *  Every PT_LOAD segment of every file goes into the image, with the
+ *  part past p_filesz (.bss, .sbss) zero-filled; files without program
+ *  headers contribute their allocated sections instead.  The image
+ *  entry point is the first file's.  This replaces genmipsimage.pl
+ *  and its objdump round trip.
+ *
+ *************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "image.h"
+
+#define MAX_SEGS 256
+
+struct Seg {
+  ImageSegment s;
+  unsigned char *data;		/* filesz bytes */
+};
+
+static Seg segs[MAX_SEGS];
+static int nsegs;
+static unsigned long long entry;
+
+static void fatal (const char *msg, const char *file)
+{
+  fprintf (stderr, "elf2image: %s: %s\n", file, msg);
+  exit (1);
+}
+
+static unsigned char *read_file (const char *file, long *len)
+{
+  FILE *fp;
+  unsigned char *buf;
+
+  if (!(fp = fopen (file, "rb")))
+    fatal ("cannot open", file);
+  fseek (fp, 0, SEEK_END);
+  *len = ftell (fp);
+  rewind (fp);
+  if (*len <= 0 || !(buf = (unsigned char *) malloc (*len)))
+    fatal ("empty or too large", file);
+  if (fread (buf, 1, *len, fp) != (size_t)*len)
+    fatal ("read error", file);
+  fclose (fp);
+  return buf;
+}
+
+static void add_seg (const char *file, unsigned char *elf, long len,
+		     unsigned long long addr, unsigned long long off,
+		     unsigned long long filesz, unsigned long long memsz)
+{
+  Seg *g;
+
+  if (memsz == 0)
+    return;
+  if (nsegs == MAX_SEGS)
+    fatal ("too many segments", file);
+  if (filesz > memsz || off + filesz > (unsigned long long)len)
+    fatal ("segment outside the file", file);
+  g = &segs[nsegs++];
+  g->s.addr = addr;
+  g->s.filesz = filesz;
+  g->s.memsz = memsz;
+  g->s.fill = 0;
+  g->data = elf + off;
+}
+
+static void load_elf (const char *file, int first)
+{
+  unsigned char *elf, *h;
+  long len;
+  unsigned long long phoff, shoff;
+  int phentsize, phnum, shentsize, shnum, i, nload;
+
+  elf = read_file (file, &len);	/* kept: segments point into it */
+  if (len < ELF_EHDR_SIZE || memcmp (elf, ELF_MAGIC, 4) != 0)
+    fatal ("not an ELF file", file);
+  if (elf[4] != ELFCLASS32 || elf[5] != ELFDATA2MSB)
+    fatal ("not a 32-bit big-endian ELF file", file);
+  if (image_get (elf + 18, 2) != EM_MIPS)
+    fatal ("not a MIPS ELF file", file);
+
+  if (first)
+    entry = image_get (elf + 24, 4);
+  phoff = image_get (elf + 28, 4);
+  shoff = image_get (elf + 32, 4);
+  phentsize = image_get (elf + 42, 2);
+  phnum = image_get (elf + 44, 2);
+  shentsize = image_get (elf + 46, 2);
+  shnum = image_get (elf + 48, 2);
+
+  nload = 0;
+  for (i=0; i < phnum; i++) {
+    h = elf + phoff + i * phentsize;
+    if (h + ELF_PHDR_SIZE > elf + len)
+      fatal ("program header outside the file", file);
+    if (image_get (h, 4) != PT_LOAD)
+      continue;
+    add_seg (file, elf, len, image_get (h + 8, 4), image_get (h + 4, 4),
+	     image_get (h + 16, 4), image_get (h + 20, 4));
+    nload++;
+  }
+  if (nload > 0)
+    return;
+
+  /* no program headers: take the allocated sections */
+  for (i=0; i < shnum; i++) {
+    h = elf + shoff + i * shentsize;
+    if (h + ELF_SHDR_SIZE > elf + len)
+      fatal ("section header outside the file", file);
+    if (!(image_get (h + 8, 4) & SHF_ALLOC))
+      continue;
+    add_seg (file, elf, len, image_get (h + 12, 4), image_get (h + 16, 4),
+	     image_get (h + 4, 4) == SHT_NOBITS ? 0 : image_get (h + 20, 4),
+	     image_get (h + 20, 4));
+  }
+}
+
+static void write_image (FILE *fp)
+{
+  unsigned char hdr[IMAGE_HDR_SIZE], t[IMAGE_SEG_SIZE];
+  unsigned long long off;
+  int i;
+
+  memcpy (hdr, IMAGE_MAGIC, IMAGE_MAGIC_LEN);
+  image_put (hdr + 8, 4, IMAGE_VERSION);
+  image_put (hdr + 12, 4, nsegs);
+  image_put (hdr + 16, 8, entry);
+  fwrite (hdr, 1, IMAGE_HDR_SIZE, fp);
+
+  off = IMAGE_HDR_SIZE + (unsigned long long)nsegs * IMAGE_SEG_SIZE;
+  for (i=0; i < nsegs; i++) {
+    segs[i].s.offset = off;
+    image_put (t, 8, segs[i].s.addr);
+    image_put (t + 8, 8, segs[i].s.filesz);
+    image_put (t + 16, 8, segs[i].s.memsz);
+    image_put (t + 24, 8, segs[i].s.fill);
+    image_put (t + 32, 8, segs[i].s.offset);
+    fwrite (t, 1, IMAGE_SEG_SIZE, fp);
+    off += segs[i].s.filesz;
+  }
+  for (i=0; i < nsegs; i++)
+    fwrite (segs[i].data, 1, segs[i].s.filesz, fp);
+}
+
+static void usage (void)
+{
+  fprintf (stderr, "usage: elf2image [-o <image>] <elf> [<elf> ...]\n");
+  fprintf (stderr, "       elf2image -e <elf>\n");
+  exit (1);
+}
+
+int main (int argc, char **argv)
+{
+  const char *out = NULL;
+  int i, print_entry = 0;
+  FILE *fp;
+
+  for (i=1; i < argc && argv[i][0] == '-'; i++) {
+    if (!strcmp (argv[i], "-e"))
+      print_entry = 1;
+    else if (!strcmp (argv[i], "-o") && i+1 < argc)
+      out = argv[++i];
+    else
+      usage ();
+  }
+  if (i == argc)
+    usage ();
+
+  if (print_entry) {
+    load_elf (argv[i], 1);
+    printf ("0x%08llx\n", entry);
+    return 0;
+  }
+
+  for (; i < argc; i++)
+    load_elf (argv[i], nsegs == 0);
+
+  if (out) {
+    if (!(fp = fopen (out, "wb")))
+      fatal ("cannot create", out);
+  }
+  else
+    fp = stdout;
+  write_image (fp);
+  if (ferror (fp))
+    fatal ("write error", out ? out : "stdout");
+  if (out)
+    fclose (fp);
+  return 0;
+}
@@ -18,6 +18,9 @@
  *
  *************************************************************************/
 #include "cachecore.h"
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
 
 
 void CacheCore::RegisterDefault (char *name)
@@ -38,6 +41,9 @@ void CacheCore::RegisterDefault (char *name)
 
   sprintf (buf, "%s.Banks", name);
   ::RegisterDefault (buf, 1);
+
+  sprintf (buf, "%s.Replacement", name);
+  ::RegisterDefault (buf, "lru");
 }
 
 
@@ -64,7 +70,7 @@ static int logbase2 (LL x)
 
 
 // Create a cache data array
-CacheCore::CacheCore (char *name)
+CacheCore::CacheCore (char *name, int data)
 {
   char buf[1024];
   int i, j;
@@ -135,6 +141,11 @@ CacheCore::CacheCore (char *name)
   else
     fatal_error ("%s.EndianNess: should be `big' or `little'", name);
 
+  sprintf (buf, "%s.Replacement", name);
+  _repl = ReplPolicy::Create (ParamGetString (buf), _nlines, _nsets);
+  if (!_repl)
+    fatal_error ("%s.Replacement: unknown policy `%s'", name, ParamGetString (buf));
+
   _c = (CacheLine *)malloc(sizeof(CacheLine)*_nlines*_nsets);
   if (!_c)
     fatal_error ("Malloc failed, size=%d\n", sizeof(CacheLine)*_nlines*_nsets);
@@ -149,13 +160,17 @@ CacheCore::CacheCore (char *name)
 #endif
       _c[i+j].lru = 0;
       _c[i+j].way = j;
-      MALLOC (_c[i+j].b, Byte, _nbytes);
+      _c[i+j].b = NULL;
     }
   }
+  _alloc_data (data);
+  _keys = (LL *)calloc (_nlines*_nsets, sizeof(LL));
+  if (!_keys)
+    fatal_error ("Malloc failed, size=%d\n", sizeof(LL)*_nlines*_nsets);
 }
 
 // Create a cache data array
-CacheCore::CacheCore (int nlines, int nbanks, int nsets, int nbytes)
+CacheCore::CacheCore (int nlines, int nbanks, int nsets, int nbytes, int data)
 {
   int i, j;
 
@@ -201,6 +216,8 @@ CacheCore::CacheCore (int nlines, int nbanks, int nsets, int nbytes)
   _endianness = (_bytemask) & 0x7;
 #endif
 
+  _repl = ReplPolicy::Create ("lru", _nlines, _nsets);
+
   _c = (CacheLine *)malloc(sizeof(CacheLine)*_nlines*_nsets);
   if (!_c)
     fatal_error ("Malloc failed, size=%d\n", sizeof(CacheLine)*_nlines*_nsets);
@@ -214,9 +231,13 @@ CacheCore::CacheCore (int nlines, int nbanks, int nsets, int nbytes)
       _c[i+j].owned = 0;
 #endif
       _c[i+j].way = j;
-      MALLOC (_c[i+j].b, Byte, _nbytes);
+      _c[i+j].b = NULL;
     }
   }
+  _alloc_data (data);
+  _keys = (LL *)calloc (_nlines*_nsets, sizeof(LL));
+  if (!_keys)
+    fatal_error ("Malloc failed, size=%d\n", sizeof(LL)*_nlines*_nsets);
 }
 
 
@@ -224,36 +245,86 @@ CacheCore::CacheCore (int nlines, int nbanks, int nsets, int nbytes)
 
 CacheCore::~CacheCore ()
 {
-  int i;
   context_disable ();		// will be a NOP for unfair sims
-  for (i=0; i < _nlines*_nsets; i++)
-    FREE (_c[i].b);
+  free (_data);
   free (_c);
+  free (_keys);
+  delete _repl;
   free (_name);
   context_enable ();		// more NOPs for unfair sims
 }
 
-// Hit test
+// Line data comes from one arena instead of a malloc per line
+void CacheCore::_alloc_data (int data)
+{
+  size_t i, n = (size_t)_nlines*_nsets;
+
+  _data = NULL;
+  if (!data)
+    return;
+  _data = (Byte *)malloc (n*_nbytes);
+  if (!_data)
+    fatal_error ("Malloc failed, size=%llu\n", (LL)n*_nbytes);
+  for (i=0; i < n; i++)
+    _c[i].b = _data + i*_nbytes;
+}
+
+// Hit test, on the keys of the set
 CacheLine *CacheCore::GetLine (LL addr)
 {
-  CacheLine *cl;
-  int i;
-  
-  cl = GetLines (addr);
-  
-  for (i=0; i < _nsets; i++) {
-     if (cl[i].valid && (cl[i].tag == ((addr & _tagsmask) >> _lgdata)))
-      return &cl[i]; // hit
+  int base, i;
+  LL key, *k;
+
+  base = _nsets*((addr & _idxmask) >> _idxsa);
+  key = CACHE_KEY ((addr & _tagsmask) >> _lgdata);
+  k = &_keys[base];
+  i = 0;
+
+#if defined(__AVX2__)
+  __m256i kv4 = _mm256_set1_epi64x ((long long)key);
+  for (; i + 4 <= _nsets; i += 4) {
+    int m = _mm256_movemask_pd (_mm256_castsi256_pd
+	  (_mm256_cmpeq_epi64 (_mm256_loadu_si256 ((__m256i *)(k+i)), kv4)));
+    if (m)
+      return &_c[base + i + __builtin_ctz (m)]; // hit
+  }
+#endif
+#if defined(__SSE4_1__)
+  __m128i kv2 = _mm_set1_epi64x ((long long)key);
+  for (; i + 2 <= _nsets; i += 2) {
+    int m = _mm_movemask_pd (_mm_castsi128_pd
+	  (_mm_cmpeq_epi64 (_mm_loadu_si128 ((__m128i *)(k+i)), kv2)));
+    if (m)
+      return &_c[base + i + __builtin_ctz (m)]; // hit
   }
+#endif
+  for (; i < _nsets; i++)
+    if (k[i] == key)
+      return &_c[base + i]; // hit
+
   // miss
   return NULL;
 }
 
 
+// Line a fill of addr replaces: an invalid way, else the policy's pick
+CacheLine *CacheCore::Victim (LL addr)
+{
+  CacheLine *cl;
+  int i;
+
+  cl = GetLines (addr);
+  for (i=0; i < _nsets; i++)
+    if (!cl[i].valid)
+      return &cl[i];
+  return &cl[_repl->Victim ((addr & _idxmask) >> _idxsa)];
+}
+
 void CacheCore::Invalidate (void)
 {
   int i;
 
   for (i=0; i < _nlines*_nsets; i++)
     _c[i].valid = 0;
+  memset (_keys, 0, sizeof(LL)*_nlines*_nsets);
 }
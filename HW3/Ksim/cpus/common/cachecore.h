@@ -22,6 +22,7 @@
 
 #include "sim.h"
 #include "mem.h"
+#include "replace.h"
 
 struct CacheLine {
   unsigned int dirty:2;
@@ -44,15 +45,28 @@ struct CacheLine {
 
 #define DIRTY(c)  (c)->dirty
 #define VALID(c)  (c)->valid
+
+/*
+ * GetLine searches a second, structure-of-arrays copy of the tags: one
+ * LL key per line, laid out like the CacheLine array so that a set's
+ * keys are contiguous, with the valid bit folded in (key = tag<<1 | 1,
+ * 0 when invalid).  Ways are compared four (AVX2) or two (SSE4.1) at a
+ * time when the compiler targets those (make SIMD=avx2 or SIMD=sse4.1).
+ * SetTags and Invalidate keep the keys up to date; code that writes
+ * valid or tag in a CacheLine itself must call SyncTags afterwards.
+ */
+#define CACHE_KEY(tag) (((tag) << 1) | 1)
 #ifdef DIRTY_SHARING
 #define OWNED(c)  (c)->owned
 #endif
 
 class CacheCore {
 public:
-  // name.params are read from config file
-  CacheCore (char *name);
-  CacheCore (int nlines, int nbanks, int nsets, int nbytes);
+  // name.params are read from config file.  data=0 builds a tags-only
+  // cache for timing models: no line has a data buffer (b is NULL),
+  // and the Get/Set data calls must not be used.
+  CacheCore (char *name, int data = 1);
+  CacheCore (int nlines, int nbanks, int nsets, int nbytes, int data = 1);
   ~CacheCore ();
 
   // get cache line(s) corresponding to address. No check made re:
@@ -159,6 +173,27 @@ public:
   inline void SetTags (CacheLine *c, LL addr) {
     c->tag = (addr & _tagsmask) >> _lgdata;
     c->valid = 1;
+    _keys[c - _c] = CACHE_KEY (c->tag);
+    _repl->Insert ((c - _c) / _nsets, c->way);
+  };
+
+  // replacement (<name>.Replacement, see replace.h): record a hit on
+  // "c", and pick the line a fill of "addr" goes to, invalid ones first
+  inline void Touch (CacheLine *c) {
+    _repl->Touch ((c - _c) / _nsets, c->way);
+  };
+
+  CacheLine *Victim (LL addr);
+
+  inline char *ReplName (void) { return _repl->_kind; };
+
+  inline void CheckpointRepl (FILE *fp, int save) {
+    _repl->Checkpoint (fp, save);
+  };
+
+  // refresh the lookup key after changing c->valid or c->tag directly
+  inline void SyncTags (CacheLine *c) {
+    _keys[c - _c] = c->valid ? CACHE_KEY (c->tag) : 0;
   };
 
   // invalidate all cache lines!
@@ -199,6 +234,8 @@ public:
   static void RegisterDefault (char *name);
 
 private:
+  void _alloc_data (int data);
+
   int _nbanks;			// # of cache banks
   int _nlines;			// # of cache lines
   int _nsets;			// # of sets
@@ -222,6 +259,9 @@ private:
   //  line0,set0  line0,set1, ... line0, setN-1, line1,set0, ... etc
 
   CacheLine *_c;
+  LL *_keys;			// lookup keys, one per line as in _c
+  Byte *_data;			// every line's data, one block; NULL if tags-only
+  ReplPolicy *_repl;
 
   char *_name;
   
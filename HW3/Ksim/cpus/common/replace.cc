@@ -0,0 +1,192 @@
+/*-*-mode:c++-*-**********************************************************
+ *
+ *  Replacement policies for CacheCore, see replace.h
+ *
+ *************************************************************************/
+#include "replace.h"
+#include "checkpoint.h"
+
+ReplPolicy *ReplPolicy::Create (char *kind, int nindex, int nways)
+{
+  ReplPolicy *p;
+
+  if (!strcmp (kind, "lru"))
+    p = new LRUPolicy (nindex, nways);
+  else if (!strcmp (kind, "plru"))
+    p = new PLRUPolicy (nindex, nways);
+  else if (!strcmp (kind, "srrip"))
+    p = new RRIPPolicy (nindex, nways, 0);
+  else if (!strcmp (kind, "brrip"))
+    p = new RRIPPolicy (nindex, nways, 1);
+  else if (!strcmp (kind, "random"))
+    p = new RandomPolicy (nindex, nways);
+  else
+    return NULL;
+  p->_kind = kind;
+  return p;
+}
+
+/*------------------------------------------------------------------------
+ *  True LRU
+ *------------------------------------------------------------------------
+ */
+LRUPolicy::LRUPolicy (int nindex, int nways)
+{
+  _nindex = nindex;
+  _nways = nways;
+  _stamp = (LL *)calloc (nindex*nways, sizeof(LL));
+  if (!_stamp)
+    fatal_error ("Malloc failed, size=%d\n", sizeof(LL)*nindex*nways);
+  _clock = 0;
+}
+
+LRUPolicy::~LRUPolicy ()
+{
+  free (_stamp);
+}
+
+int LRUPolicy::Victim (int index)
+{
+  LL *s = &_stamp[index*_nways];
+  int i, v = 0;
+
+  for (i=1; i < _nways; i++)
+    if (s[i] < s[v])
+      v = i;
+  return v;
+}
+
+void LRUPolicy::Checkpoint (FILE *fp, int save)
+{
+  ckpt_io (fp, save, _stamp, sizeof(LL)*_nindex*_nways);
+  CKPT_IO (fp, save, _clock);
+}
+
+/*------------------------------------------------------------------------
+ *  Tree pseudo-LRU
+ *------------------------------------------------------------------------
+ */
+PLRUPolicy::PLRUPolicy (int nindex, int nways)
+{
+  _nindex = nindex;
+  _nways = nways;
+  if (nways > 64 || (nways & (nways-1)) != 0)
+    fatal_error ("plru replacement needs a power-of-two associativity up to 64");
+  for (_lgways = 0; (1 << _lgways) < nways; _lgways++)
+    ;
+  _tree = (LL *)calloc (nindex, sizeof(LL));
+  if (!_tree)
+    fatal_error ("Malloc failed, size=%d\n", sizeof(LL)*nindex);
+}
+
+PLRUPolicy::~PLRUPolicy ()
+{
+  free (_tree);
+}
+
+// point every node on the way's path at the other half
+void PLRUPolicy::Touch (int index, int way)
+{
+  LL t = _tree[index];
+  int n = 1, l, b;
+
+  for (l = _lgways-1; l >= 0; l--) {
+    b = (way >> l) & 1;
+    if (b)
+      t &= ~((LL)1 << n);
+    else
+      t |= (LL)1 << n;
+    n = 2*n + b;
+  }
+  _tree[index] = t;
+}
+
+int PLRUPolicy::Victim (int index)
+{
+  LL t = _tree[index];
+  int n = 1;
+
+  while (n < _nways)
+    n = 2*n + (int)((t >> n) & 1);
+  return n - _nways;
+}
+
+void PLRUPolicy::Checkpoint (FILE *fp, int save)
+{
+  ckpt_io (fp, save, _tree, sizeof(LL)*_nindex);
+}
+
+/*------------------------------------------------------------------------
+ *  SRRIP and BRRIP (Jaleel et al., ISCA 2010), hit promotion
+ *------------------------------------------------------------------------
+ */
+RRIPPolicy::RRIPPolicy (int nindex, int nways, int bimodal)
+{
+  int i;
+
+  _nindex = nindex;
+  _nways = nways;
+  _bimodal = bimodal;
+  _fills = 0;
+  MALLOC (_rrpv, unsigned char, nindex*nways);
+  for (i=0; i < nindex*nways; i++)
+    _rrpv[i] = RRIP_MAX;
+}
+
+RRIPPolicy::~RRIPPolicy ()
+{
+  free (_rrpv);
+}
+
+void RRIPPolicy::Insert (int index, int way)
+{
+  if (_bimodal && (++_fills % BRRIP_EPSILON) != 0)
+    _rrpv[index*_nways + way] = RRIP_MAX;
+  else
+    _rrpv[index*_nways + way] = RRIP_MAX - 1;
+}
+
+// first way predicted distant, ageing the whole set until there is one
+int RRIPPolicy::Victim (int index)
+{
+  unsigned char *r = &_rrpv[index*_nways];
+  int i, v = 0;
+
+  for (i=1; i < _nways; i++)
+    if (r[i] > r[v])
+      v = i;
+  if (r[v] < RRIP_MAX) {
+    unsigned char age = RRIP_MAX - r[v];
+    for (i=0; i < _nways; i++)
+      r[i] += age;
+  }
+  return v;
+}
+
+void RRIPPolicy::Checkpoint (FILE *fp, int save)
+{
+  ckpt_io (fp, save, _rrpv, _nindex*_nways);
+  CKPT_IO (fp, save, _fills);
+}
+
+/*------------------------------------------------------------------------
+ *  Random
+ *------------------------------------------------------------------------
+ */
+RandomPolicy::RandomPolicy (int nindex, int nways)
+{
+  _nindex = nindex;
+  _nways = nways;
+  _seed = 1;
+}
+
+int RandomPolicy::Victim (int index)
+{
+  _seed = _seed * 1103515245 + 12345;
+  return (int)((_seed >> 16) % _nways);
+}
+
+void RandomPolicy::Checkpoint (FILE *fp, int save)
+{
+  CKPT_IO (fp, save, _seed);
+}
@@ -0,0 +1,104 @@
+/*-*-mode:c++-*-**********************************************************
+ *
+ *  Replacement policies for CacheCore (<name>.Replacement)
+ *
+ *    lru     true LRU: a timestamp per line, O(1) Touch
+ *    plru    tree pseudo-LRU: ways-1 bits per set (power-of-two
+ *            associativity, at most 64 ways), O(log ways)
+ *    srrip   static RRIP: 2-bit re-reference prediction per line,
+ *            filled at "long", promoted to "near" on a hit
+ *    brrip   bimodal RRIP: fills at "distant" but one in BRRIP_EPSILON
+ *            fills at "long"; resists thrashing
+ *    random  pseudo-random way, reproducible from run to run
+ *
+ *  A policy knows sets by index (CacheCore::GetLinesFromIndex) and lines
+ *  by way.  CacheCore calls Insert when a line is filled and Touch on a
+ *  hit, and asks Victim only when every way of the set is valid.
+ *
+ *************************************************************************/
+#ifndef __REPLACE_H__
+#define __REPLACE_H__
+
+#include "sim.h"
+
+#define RRIP_BITS 2
+#define RRIP_MAX ((1 << RRIP_BITS) - 1)	/* distant re-reference */
+#define BRRIP_EPSILON 32
+
+class ReplPolicy {
+public:
+  virtual ~ReplPolicy () { }
+
+  virtual void Touch (int index, int way) = 0; // hit
+  virtual void Insert (int index, int way) { Touch (index, way); } // fill
+  virtual int Victim (int index) = 0;	// every way valid
+  virtual void Checkpoint (FILE *fp, int save) = 0; // binary state
+
+  // NULL for an unknown kind
+  static ReplPolicy *Create (char *kind, int nindex, int nways);
+
+  char *_kind;
+
+protected:
+  int _nindex;			// # of sets
+  int _nways;			// associativity
+};
+
+class LRUPolicy : public ReplPolicy {
+public:
+  LRUPolicy (int nindex, int nways);
+  ~LRUPolicy ();
+
+  void Touch (int index, int way) { _stamp[index*_nways + way] = ++_clock; }
+  int Victim (int index);
+  void Checkpoint (FILE *fp, int save);
+
+private:
+  LL *_stamp;			// last use of each line
+  LL _clock;
+};
+
+class PLRUPolicy : public ReplPolicy {
+public:
+  PLRUPolicy (int nindex, int nways);
+  ~PLRUPolicy ();
+
+  void Touch (int index, int way);
+  int Victim (int index);
+  void Checkpoint (FILE *fp, int save);
+
+private:
+  LL *_tree;			// per set: node n (1..ways-1) in bit n,
+				// set when the LRU side is the right one
+  int _lgways;
+};
+
+class RRIPPolicy : public ReplPolicy {
+public:
+  RRIPPolicy (int nindex, int nways, int bimodal);
+  ~RRIPPolicy ();
+
+  void Touch (int index, int way) { _rrpv[index*_nways + way] = 0; }
+  void Insert (int index, int way);
+  int Victim (int index);
+  void Checkpoint (FILE *fp, int save);
+
+private:
+  unsigned char *_rrpv;		// re-reference prediction of each line
+  int _bimodal;
+  unsigned _fills;		// BRRIP: picks every BRRIP_EPSILON-th fill
+};
+
+class RandomPolicy : public ReplPolicy {
+public:
+  RandomPolicy (int nindex, int nways);
+
+  void Touch (int index, int way) { }
+  int Victim (int index);
+  void Checkpoint (FILE *fp, int save);
+
+private:
+  unsigned _seed;
+};
+
+#endif /* __REPLACE_H__ */
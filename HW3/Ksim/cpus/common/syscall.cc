@@ -29,6 +29,7 @@
 #include "syscall.h"
 #include "misc.h"
 #include "mips.h"
+#include "checkpoint.h"
 
 // map open(), creat() flags from host architecture to native
 // architecture
@@ -72,8 +73,10 @@ SysCall::SysCall (void)
   int i;
   char buf[1024];
   
-  for (i=0; i < 256; i++)
+  for (i=0; i < 256; i++) {
     _fdlist[i] = -1;
+    _fdname[i] = NULL;
+  }
   
   // open file descriptors
   _fdlist[0] = 0;
@@ -90,8 +93,10 @@ SysCall::SysCall (Mipc * ms)
   int i;          
   char buf[1024];
   
-  for (i=0; i < 256; i++)
+  for (i=0; i < 256; i++) {
     _fdlist[i] = -1;
+    _fdname[i] = NULL;
+  }
    
   // open file descriptors
   _fdlist[0] = 0;
@@ -126,6 +131,84 @@ void SysCall::Reset (void)
   }
 }
 
+/*
+ * remember what the program opened as fd "i", so that a checkpoint
+ * can open it again; name == NULL forgets it
+ */
+void SysCall::_setfdname (int i, char *name, int flags)
+{
+  if (_fdname[i])
+    free (_fdname[i]);
+  _fdname[i] = name ? Strdup (name) : NULL;
+  _fdflags[i] = flags;
+}
+
+/*
+ * Binary checkpoint of the file table and counters.  Files the program
+ * opened are saved as name, flags and offset and opened again on
+ * restore (without O_CREAT/O_TRUNC); stdin/stdout/stderr stay attached
+ * to the host's.
+ */
+void SysCall::SaveState (FILE *fp)
+{
+  int i, len;
+  LL off;
+
+  for (i=0; i < 256; i++) {
+    CKPT_IO (fp, 1, _fdlist[i]);
+    if (_fdlist[i] < 0 || i < 3)
+      continue;
+    len = _fdname[i] ? strlen (_fdname[i]) : 0;
+    CKPT_IO (fp, 1, len);
+    if (len)
+      ckpt_io (fp, 1, _fdname[i], len);
+    CKPT_IO (fp, 1, _fdflags[i]);
+    off = lseek (_fdlist[i], 0, SEEK_CUR);
+    CKPT_IO (fp, 1, off);
+  }
+  CKPT_IO (fp, 1, _num_load);
+  CKPT_IO (fp, 1, _num_store);
+  CKPT_IO (fp, 1, _num_load_since_reset);
+  CKPT_IO (fp, 1, _num_store_since_reset);
+}
+
+void SysCall::RestoreState (FILE *fp)
+{
+  int i, len, fd;
+  LL off;
+  char name[1024];
+
+  Reset ();
+  for (i=0; i < 256; i++) {
+    _setfdname (i, NULL, 0);
+    CKPT_IO (fp, 0, fd);
+    if (fd < 0 || i < 3) {
+      _fdlist[i] = fd;
+      continue;
+    }
+    CKPT_IO (fp, 0, len);
+    if (len < 0 || len >= (int)sizeof (name))
+      fatal_error ("Bad file name in checkpoint");
+    ckpt_io (fp, 0, name, len);
+    name[len] = 0;
+    CKPT_IO (fp, 0, _fdflags[i]);
+    CKPT_IO (fp, 0, off);
+    _fdlist[i] = len ? open (name, _fdflags[i] & ~(O_CREAT|O_TRUNC|O_EXCL)) : -1;
+    if (_fdlist[i] >= 0 && (LL)lseek (_fdlist[i], off, SEEK_SET) != off) {
+      close (_fdlist[i]);
+      _fdlist[i] = -1;
+    }
+    if (_fdlist[i] < 0)
+      PrintError ("cannot reopen fd %d (`%s') from the checkpoint", i, name);
+    else
+      _setfdname (i, name, _fdflags[i]);
+  }
+  CKPT_IO (fp, 0, _num_load);
+  CKPT_IO (fp, 0, _num_store);
+  CKPT_IO (fp, 0, _num_load_since_reset);
+  CKPT_IO (fp, 0, _num_store_since_reset);
+}
+
 void SysCall::ArgumentSetup (int argc, char **argv, LL addr, char *input_file, unsigned thread_id)
 {
   int i;
@@ -629,18 +712,31 @@ void SysCall::PrintError (char *s, ...)
   fflush (stdout);
 }
 
+/*
+ * copy a NUL-terminated string of at most max-1 characters out of
+ * simulated memory a doubleword at a time; returns 0 if it was cut
+ */
+int SysCall::_readstring (LL addr, char *buf, int max)
+{
+  int i, n;
+
+  i = 0;
+  while (i < max - 1) {
+    n = 8 - ((addr + i) & 7);
+    if (n > max - 1 - i)
+      n = max - 1 - i;
+    ReadBlock (addr + i, buf + i, n);
+    while (n-- > 0)
+      if (buf[i++] == 0)
+	return 1;
+  }
+  buf[max - 1] = 0;
+  return 0;
+}
+
 #define READ_FNAME(addr)					\
-    i = 0;							\
-    do {							\
-      c = ReadByte (addr+i);					\
-      buf[i] = c;						\
-      i++;							\
-      if (i == 1023) {						\
-	PrintError ("input filename exceeds 1023 chars!");	\
-	buf[1023] = 0;						\
-	break;							\
-      }								\
-    } while (c != 0);
+    if (!_readstring (addr, buf, 1024))				\
+      PrintError ("input filename exceeds 1023 chars!");
 
 
 void SysCall::EmulateSysCall (void)
@@ -704,13 +800,11 @@ void SysCall::EmulateSysCall (void)
         
         if(GetReg (REG_A2) > 1024)
          {
-           for (i=0; i < x; i++)
-              WriteByte (GetReg (REG_A1)+i, buffer_temp[i]);
+           WriteBlock (GetReg (REG_A1), buffer_temp, x);
            free(buffer_temp);
          }
 	else
-           for (i=0; i < x; i++)
-              WriteByte (GetReg (REG_A1)+i, buf[i]);
+           WriteBlock (GetReg (REG_A1), buf, x);
         UNIX_RETURN (x);
 	break;
       }
@@ -727,18 +821,30 @@ void SysCall::EmulateSysCall (void)
 		  _fdlist[0xff & GetReg (REG_A0)]);
       UNIX_RETURN (MINUS_ONE);
      }
-     for (i=0; i < GetReg(REG_A2); i++) {
-      c = ReadByte (GetReg(REG_A1)+i);
-      x = write (_fdlist[0xff & GetReg(REG_A0)], &c, 1);
-      if (x != 1) {
-	if (x == 0) {
-	  UNIX_RETURN (i+1);
-        }
-	UNIX_RETURN (MINUS_ONE);
+     {
+      // the guest picks the length: stream it through buf a chunk at
+      // a time rather than allocating that much on the host
+      LL addr = GetReg (REG_A1);
+      LL len = GetReg (REG_A2);
+      LL done = 0;
+      int n;
+
+      x = 0;
+      while (done < len) {
+	n = (len - done > (LL)sizeof (buf)) ? (int)sizeof (buf) : (int)(len - done);
+	ReadBlock (addr + done, buf, n);
+	x = write (_fdlist[0xff & GetReg(REG_A0)], buf, n);
+	if (x < 0)
+	  break;
+	done += x;
+	if (x < n)		// short write: report what got out
+	  break;
       }
+      if (x < 0 && done == 0)
+	UNIX_RETURN (MINUS_ONE);
+      UNIX_RETURN (done);
      }
-     UNIX_RETURN (GetReg(REG_A2));
-     break; 
+     break;
    }
 
   case SYS_open:		// open (file, type)
@@ -757,6 +863,7 @@ void SysCall::EmulateSysCall (void)
 	UNIX_RETURN (MINUS_ONE);
       }
       else {
+	_setfdname (i, buf, mode_remap ((int)GetReg(REG_A1)));
 #if 0
         printf("syscall: fd is %d\n",i);
 #endif
@@ -768,6 +875,7 @@ void SysCall::EmulateSysCall (void)
   {
    int tmpfd = _fdlist[0xff & GetReg(REG_A0)];
    _fdlist[0xff & GetReg(REG_A0)] = -1;
+   _setfdname (0xff & GetReg(REG_A0), NULL, 0);
    UNIX_RETURN (close (tmpfd));
    break; 
   }
@@ -780,6 +888,8 @@ void SysCall::EmulateSysCall (void)
     if (i == 256)
       UNIX_RETURN (MINUS_ONE);
     _fdlist[i] = creat (buf, GetReg(REG_A1));
+    if (_fdlist[i] >= 0)
+      _setfdname (i, buf, O_WRONLY|O_CREAT|O_TRUNC);
 #if 0
         printf("syscall: fd is %d\n",i);
 #endif
@@ -967,10 +1077,8 @@ void SysCall::EmulateSysCall (void)
 	for (i=0; i < _argc; i++) {
 	  WriteWord (GetReg (REG_SP) + (4+4*i), curaddr);
 	  y = strlen (_argv[i]);
-	  for (x=0; x <= y; x++) {
-	    WriteByte (curaddr, _argv[i][x]);
-	    curaddr++;
-	  }
+	  WriteBlock (curaddr, _argv[i], y + 1);
+	  curaddr += y + 1;
 	}
       }
       UNIX_RETURN (0);
@@ -71,6 +71,10 @@ class SysCall {
 
   virtual Word GetWord (LL addr) = 0;
   virtual void SetWord (LL addr, Word value) = 0;
+
+  /* host buffer <-> simulated memory, in target byte order */
+  virtual void ReadBlock (LL addr, void *buf, LL len) = 0;
+  virtual void WriteBlock (LL addr, const void *buf, LL len) = 0;
   
   virtual void SetReg (int regnum, LL value) = 0;
   virtual LL   GetReg (int regnum) = 0;
@@ -115,6 +119,9 @@ class SysCall {
 
   virtual void EmulateSysCall (void);
 
+  void SaveState (FILE *fp);	// binary: file table and counters
+  void RestoreState (FILE *fp);
+
   virtual void PrintError (char *s, ...);
   virtual char *SysCallName (int num);
 
@@ -137,9 +144,13 @@ class SysCall {
  protected:
   Mem *m;
   int _fdlist[256];
+  char *_fdname[256];		// what the program opened, for checkpoints
+  int _fdflags[256];
+  void _setfdname (int i, char *name, int flags);
 
   LL _emulate_fxstat (int fd, LL addr);
   LL _emulate_gettime(LL ts_addr, LL tz_addr);
+  int _readstring (LL addr, char *buf, int max);
 
   int _argc;
   char **_argv;
@@ -0,0 +1,148 @@
+#include <string.h>
+#include "bpred.h"
+#include "checkpoint.h"
+
+static char *bp_names[] = {"static", "bimodal", "gshare", "tournament"};
+
+// Conditional branches: regimm (bltz, bgez, ...) and beq..bgtz
+#define BP_IS_COND(ins) (((ins) >> 26) == 1 || (((ins) >> 26) >= 4 && ((ins) >> 26) <= 7))
+
+#define BP_TAKEN(c) ((c) >= 2)
+#define BP_TRAIN(c, t)              \
+   do                               \
+   {                                \
+      if ((t) && (c) < 3)           \
+         (c)++;                     \
+      else if (!(t) && (c) > 0)     \
+         (c)--;                     \
+   } while (0)
+
+BranchPred::BranchPred(char *type, int entries, int histBits, int btbEntries)
+{
+   int i;
+
+   for (_type = 0; _type < 4; _type++)
+      if (!strcmp(type, bp_names[_type]))
+         break;
+   if (_type == 4)
+      fatal_error("Unknown Mipc.BranchPredictor \"%s\"", type);
+
+   Assert(entries > 0 && (entries & (entries - 1)) == 0, "Mipc.BPredEntries must be a power of two");
+   Assert(btbEntries > 0 && (btbEntries & (btbEntries - 1)) == 0, "Mipc.BTBEntries must be a power of two");
+   Assert(histBits >= 0 && histBits <= 30, "Mipc.BPredHistory out of range");
+
+   _mask = entries - 1;
+   _hist = 0;
+   _histMask = (1U << histBits) - 1;
+
+   _bimodal = new unsigned char[entries];
+   _gshare = new unsigned char[entries];
+   _chooser = new unsigned char[entries];
+   for (i = 0; i < entries; i++)
+   {
+      _bimodal[i] = 2; // weakly taken
+      _gshare[i] = 2;
+      _chooser[i] = 2; // weakly prefer gshare
+   }
+
+   _btbMask = btbEntries - 1;
+   _btb = new BTBEntry[btbEntries];
+   for (i = 0; i < btbEntries; i++)
+      _btb[i]._valid = FALSE;
+
+   _npred = 0;
+   _nbtbMiss = 0;
+}
+
+BranchPred::~BranchPred(void)
+{
+   delete[] _bimodal;
+   delete[] _gshare;
+   delete[] _chooser;
+   delete[] _btb;
+}
+
+char *BranchPred::Name(void)
+{
+   return bp_names[_type];
+}
+
+// The table sizes come from sim.conf and must match the saved ones
+void BranchPred::Checkpoint(FILE *fp, Bool save)
+{
+   unsigned mask = _mask, btbMask = _btbMask;
+
+   CKPT_IO(fp, save, mask);
+   CKPT_IO(fp, save, btbMask);
+   Assert(mask == _mask && btbMask == _btbMask, "Checkpoint has different branch predictor tables");
+   ckpt_io(fp, save, _bimodal, _mask + 1);
+   ckpt_io(fp, save, _gshare, _mask + 1);
+   ckpt_io(fp, save, _chooser, _mask + 1);
+   ckpt_io(fp, save, _btb, (_btbMask + 1) * sizeof(BTBEntry));
+   CKPT_IO(fp, save, _hist);
+   CKPT_IO(fp, save, _npred);
+   CKPT_IO(fp, save, _nbtbMiss);
+}
+
+Bool BranchPred::Direction(unsigned int pc, unsigned int ins)
+{
+   unsigned b = (pc >> 2) & _mask;
+   unsigned g = ((pc >> 2) ^ _hist) & _mask;
+
+   if (!BP_IS_COND(ins))
+      return TRUE; // j, jal, jr, jalr
+
+   switch (_type)
+   {
+   case BP_STATIC:
+      return (ins & 0x8000) != 0; // negative offset: backward
+   case BP_BIMODAL:
+      return BP_TAKEN(_bimodal[b]);
+   case BP_GSHARE:
+      return BP_TAKEN(_gshare[g]);
+   default:
+      return BP_TAKEN(_chooser[b]) ? BP_TAKEN(_gshare[g]) : BP_TAKEN(_bimodal[b]);
+   }
+}
+
+unsigned int BranchPred::Predict(unsigned int pc, unsigned int ins)
+{
+   BTBEntry *e;
+
+   _npred++;
+   if (!Direction(pc, ins))
+      return pc + 8;
+
+   e = &_btb[(pc >> 2) & _btbMask];
+   if (e->_valid && e->_pc == pc)
+      return e->_tgt;
+   _nbtbMiss++;
+   return pc + 8;
+}
+
+// "hist" is History() as it was when the branch was predicted
+void BranchPred::Update(unsigned int pc, unsigned int ins, Bool taken, unsigned int target, unsigned hist)
+{
+   unsigned b = (pc >> 2) & _mask;
+   unsigned g = ((pc >> 2) ^ hist) & _mask;
+   BTBEntry *e;
+
+   if (BP_IS_COND(ins))
+   {
+      if (_type == BP_TOURNAMENT && BP_TAKEN(_bimodal[b]) != BP_TAKEN(_gshare[g]))
+         BP_TRAIN(_chooser[b], BP_TAKEN(_gshare[g]) == (taken != 0));
+      if (_type == BP_BIMODAL || _type == BP_TOURNAMENT)
+         BP_TRAIN(_bimodal[b], taken);
+      if (_type == BP_GSHARE || _type == BP_TOURNAMENT)
+         BP_TRAIN(_gshare[g], taken);
+      _hist = ((_hist << 1) | (taken ? 1 : 0)) & _histMask;
+   }
+
+   if (taken)
+   {
+      e = &_btb[(pc >> 2) & _btbMask];
+      e->_pc = pc;
+      e->_tgt = target;
+      e->_valid = TRUE;
+   }
+}
@@ -0,0 +1,61 @@
+#ifndef __BPRED_H__
+#define __BPRED_H__
+
+#include "mips.h"
+
+/*
+ * Fetch-stage branch prediction (Mipc.BranchPredictor).
+ *
+ *   static      backward taken, forward not taken; jumps always taken
+ *   bimodal     2-bit counters indexed by PC
+ *   gshare      2-bit counters indexed by PC xor global history
+ *   tournament  bimodal and gshare, with a 2-bit chooser per PC
+ *
+ * Targets come from a direct-mapped BTB; a taken prediction that misses
+ * in the BTB falls through.  Tables and history are trained when the
+ * branch resolves in EX (mips-ooo: when it commits), at the counters
+ * it was predicted from: fetch keeps History() with the branch and
+ * hands it back to Update.
+ */
+#define BP_STATIC 0
+#define BP_BIMODAL 1
+#define BP_GSHARE 2
+#define BP_TOURNAMENT 3
+
+typedef struct
+{
+   unsigned int _pc; // tag
+   unsigned int _tgt;
+   Bool _valid;
+} BTBEntry;
+
+class BranchPred
+{
+public:
+   BranchPred(char *type, int entries, int histBits, int btbEntries);
+   ~BranchPred();
+
+   // PC to fetch after the delay slot of the CTI "ins" at "pc"
+   unsigned int Predict(unsigned int pc, unsigned int ins);
+   void Update(unsigned int pc, unsigned int ins, Bool taken, unsigned int target, unsigned hist);
+   unsigned History(void) { return _hist; }
+
+   char *Name(void);
+   void Checkpoint(FILE *fp, Bool save); // tables, history and counters
+
+   LL _npred;    // predictions made
+   LL _nbtbMiss; // predicted taken without a target
+
+private:
+   Bool Direction(unsigned int pc, unsigned int ins);
+
+   int _type;
+   unsigned char *_bimodal, *_gshare, *_chooser; // 2-bit counters
+   unsigned _mask;
+   unsigned _hist, _histMask; // global history, youngest branch in bit 0
+
+   BTBEntry *_btb;
+   unsigned _btbMask;
+};
+
+#endif /* __BPRED_H__ */
@@ -0,0 +1,226 @@
+#include "cache.h"
+#include "prefetch.h"
+#include "checkpoint.h"
+
+MipcCache::MipcCache(char *name, MipcCache *next, int latency, int memLatency)
+{
+   _name = name;
+   _core = new CacheCore(name, 0); // tags only
+   _next = next;
+   _latency = latency;
+   _memLatency = memLatency;
+
+   _nlines = _core->NumLines() * _core->NumSets();
+   _pf = Prefetcher::Create(name, _core->GetLineSize());
+   _pfBit = new Bool[_nlines];
+   _pfReady = new LL[_nlines];
+   _pfVictim = new LL[_nlines];
+   Reset();
+}
+
+MipcCache::~MipcCache(void)
+{
+   delete _core;
+   delete _pf;
+   delete[] _pfBit;
+   delete[] _pfReady;
+   delete[] _pfVictim;
+}
+
+void MipcCache::Reset(void)
+{
+   int i;
+
+   _core->Invalidate();
+   for (i = 0; i < _nlines; i++)
+   {
+      _pfBit[i] = FALSE;
+      _pfVictim[i] = -1;
+   }
+   _nacc = 0;
+   _nmiss = 0;
+   _nwb = 0;
+   _nwbIn = 0;
+   _stallCycles = 0;
+   _pfIssued = 0;
+   _pfUseful = 0;
+   _pfLate = 0;
+   _pfUseless = 0;
+   _pfPollution = 0;
+}
+
+/*
+ * Empty line "c" of the set "addr" maps to, writing it back if dirty.
+ * A prefetch remembers the line it evicts so that a later demand miss
+ * on it can be charged as pollution.
+ */
+void MipcCache::Evict(CacheLine *c, LL addr, Bool prefetch)
+{
+   LL victim;
+   int idx;
+
+   if (!c->valid)
+      return;
+   idx = c - _core->GetLinesFromIndex(0);
+   victim = _core->GetLineAddr(c, addr);
+   if (c->dirty)
+   {
+      _nwb++;
+      if (_next)
+         _next->WriteBack(victim);
+   }
+   if (_pfBit[idx])
+      _pfUseless++; // prefetched, never used
+   else if (prefetch)
+      _pfVictim[PF_FILTER(victim)] = victim;
+}
+
+/*
+ * Bring the line holding "addr" in; returns the cycles until it arrives.
+ * Demand misses go on to train the next level's prefetcher.
+ */
+int MipcCache::Fill(LL addr, Bool write, Bool prefetch, unsigned int pc)
+{
+   CacheLine *c;
+   int idx, wait;
+
+   c = _core->Victim(addr);
+   idx = c - _core->GetLinesFromIndex(0);
+   Evict(c, addr, prefetch);
+
+   if (_next)
+      wait = _next->_latency + _next->Access(addr, FALSE, pc, !prefetch);
+   else
+      wait = _memLatency;
+
+   _core->SetTags(c, addr);
+   c->dirty = write ? 1 : 0;
+   _pfBit[idx] = prefetch;
+   _pfReady[idx] = SIM_TIME + wait;
+   return wait;
+}
+
+/*
+ * Take a dirty line from the level above.  The whole line arrives, so a
+ * miss allocates without reading the next level; nothing here is a
+ * demand access, so the access/miss counters and the prefetcher are
+ * left alone.
+ */
+void MipcCache::WriteBack(LL addr)
+{
+   CacheLine *c;
+   int idx;
+
+   _nwbIn++;
+   c = _core->GetLine(addr);
+   if (c)
+      _core->Touch(c);
+   else
+   {
+      c = _core->Victim(addr);
+      Evict(c, addr, FALSE);
+      _core->SetTags(c, addr);
+      idx = c - _core->GetLinesFromIndex(0);
+      _pfBit[idx] = FALSE;
+      _pfReady[idx] = SIM_TIME;
+   }
+   c->dirty = 1;
+}
+
+void MipcCache::Prefetch(LL addr)
+{
+   if (_core->GetLine(addr))
+      return;
+   _pfIssued++;
+   Fill(addr, FALSE, TRUE, 0);
+}
+
+int MipcCache::Access(LL addr, Bool write, unsigned int pc, Bool demand)
+{
+   LL out[PF_MAX_DEGREE];
+   CacheLine *c;
+   int i, n, idx, wait;
+   Bool miss;
+
+   _nacc++;
+   c = _core->GetLine(addr);
+   if (c)
+   {
+      wait = 0;
+      miss = FALSE;
+      _core->Touch(c);
+      if (write)
+         c->dirty = 1;
+      idx = c - _core->GetLinesFromIndex(0);
+      if (_pfBit[idx])
+      {
+         // first use of a prefetched line; late if it is still in flight
+         _pfBit[idx] = FALSE;
+         _pfUseful++;
+         if (_pfReady[idx] > SIM_TIME)
+         {
+            _pfLate++;
+            wait = (int)(_pfReady[idx] - SIM_TIME);
+         }
+         miss = TRUE; // keeps a next-line/stream prefetcher running ahead
+      }
+   }
+   else
+   {
+      _nmiss++;
+      if (_pfVictim[PF_FILTER(addr)] == _core->GetBaseAddr(addr))
+      {
+         _pfPollution++;
+         _pfVictim[PF_FILTER(addr)] = -1;
+      }
+      wait = Fill(addr, write, FALSE, pc);
+      miss = TRUE;
+   }
+   _stallCycles += wait;
+
+   if (_pf && demand)
+   {
+      n = _pf->Observe(pc, addr, miss, out);
+      for (i = 0; i < n; i++)
+         Prefetch(out[i]);
+   }
+   return wait;
+}
+
+// Tag and replacement state only: Mem holds the data
+void MipcCache::Checkpoint(FILE *fp, Bool save)
+{
+   CacheLine *c = _core->GetLinesFromIndex(0);
+   unsigned valid, dirty;
+   int i, n = _nlines;
+
+   CKPT_IO(fp, save, n);
+   Assert(n == _nlines, "Checkpoint has a different cache geometry");
+   for (i = 0; i < _nlines; i++)
+   {
+      valid = c[i].valid;
+      dirty = c[i].dirty;
+      CKPT_IO(fp, save, valid);
+      CKPT_IO(fp, save, dirty);
+      CKPT_IO(fp, save, c[i].tag);
+      c[i].valid = valid;
+      c[i].dirty = dirty;
+      _core->SyncTags(&c[i]);
+   }
+   ckpt_io(fp, save, _pfBit, _nlines * sizeof(Bool));
+   ckpt_io(fp, save, _pfReady, _nlines * sizeof(LL));
+   ckpt_io(fp, save, _pfVictim, _nlines * sizeof(LL));
+   _core->CheckpointRepl(fp, save);
+   CKPT_IO(fp, save, _nacc);
+   CKPT_IO(fp, save, _nmiss);
+   CKPT_IO(fp, save, _nwb);
+   CKPT_IO(fp, save, _nwbIn);
+   CKPT_IO(fp, save, _stallCycles);
+   CKPT_IO(fp, save, _pfIssued);
+   CKPT_IO(fp, save, _pfUseful);
+   CKPT_IO(fp, save, _pfLate);
+   CKPT_IO(fp, save, _pfUseless);
+   CKPT_IO(fp, save, _pfPollution);
+   if (_pf)
+      _pf->Checkpoint(fp, save);
+}
@@ -0,0 +1,74 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "mips.h"
+#include "cachecore.h"
+
+/*
+ * Timing model of one cache level on top of CacheCore.
+ *
+ * Only tags, dirty bits and replacement state are kept; Mem still holds
+ * every value, so the pipeline keeps using it for the data.  Caches are
+ * write-back/write-allocate, and <name>.Replacement picks the policy
+ * (see replace.h).  Access() returns the cycles the request
+ * waits beyond this level's hit time; a miss costs the next level's
+ * latency plus whatever that level waits itself, or Mipc.MemLatency
+ * below the last level.  Dirty victims are written to the next level
+ * off the critical path (write buffer) through WriteBack(), which only
+ * updates that level's tags and dirty bits: write-backs are counted
+ * apart from its demand accesses and misses, and do not fetch the line
+ * from further down since they supply all of it.
+ *
+ * An optional Prefetcher (see prefetch.h) watches the demand stream.
+ * Prefetched lines are tagged until their first use:
+ *   accuracy   = useful / issued
+ *   coverage   = useful / (useful + misses)
+ *   late       = useful prefetches still in flight when first used
+ *   pollution  = demand misses on lines a prefetch had evicted
+ */
+class Prefetcher;
+
+// direct-mapped filter of lines evicted by prefetches
+#define PF_FILTER(a) ((int)(((a) >> _core->GetIndSA()) & (_nlines - 1)))
+
+class MipcCache
+{
+public:
+   MipcCache(char *name, MipcCache *next, int latency, int memLatency);
+   ~MipcCache();
+
+   // demand=FALSE for prefetch fills from the level above: they do not
+   // train the prefetcher
+   int Access(LL addr, Bool write, unsigned int pc = 0, Bool demand = TRUE);
+   void WriteBack(LL addr); // dirty line evicted by the level above
+   LL LineAddr(LL addr) { return _core->GetBaseAddr(addr); }
+   char *ReplName(void) { return _core->ReplName(); }
+   void Reset(void); // invalidate and clear the counters
+   void Checkpoint(FILE *fp, Bool save); // tags, LRU, prefetch state, counters
+
+   char *_name;
+   int _latency; // hit time, cycles
+
+   LL _nacc, _nmiss, _nwb;
+   LL _nwbIn; // write-backs received from the level above
+   LL _stallCycles; // cycles requests waited on misses of this level
+
+   Prefetcher *_pf; // NULL: no prefetching
+   LL _pfIssued, _pfUseful, _pfLate, _pfUseless, _pfPollution;
+
+private:
+   int Fill(LL addr, Bool write, Bool prefetch, unsigned int pc);
+   void Evict(CacheLine *c, LL addr, Bool prefetch);
+   void Prefetch(LL addr);
+
+   CacheCore *_core;
+   MipcCache *_next; // NULL: main memory
+   int _memLatency;
+
+   int _nlines;   // lines in the whole cache
+   Bool *_pfBit;  // per line: prefetched, not used yet
+   LL *_pfReady;  // per line: cycle the fill completes
+   LL *_pfVictim; // pollution filter
+};
+
+#endif /* __CACHE_H__ */
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include "checker.h"
+
+Checker::Checker(Mipc *mc)
+{
+   _mc = mc;
+   _gold = new Mipc(new Mem(), TRUE);
+   _nchecked = 0;
+   _nstores = 0;
+   Sync();
+}
+
+Checker::~Checker(void) {}
+
+/*
+ * Bring the golden model to the pipeline's architectural state (used at
+ * start-up and after fast-forwarding)
+ */
+void Checker::Sync(void)
+{
+   int i;
+
+   _gold->_mem->CopyFrom(_mc->_mem);
+
+   for (i = 0; i < 32; i++)
+      _gold->_gpr[i] = _mc->_gpr[i];
+   for (i = 0; i < 16; i++)
+      _gold->_fpr[i] = _mc->_fpr[i];
+   _gold->_hi = _mc->_hi;
+   _gold->_lo = _mc->_lo;
+
+   _pc = _mc->_pc;
+   _npc = _pc + 4;
+}
+
+void Checker::MirrorStore(LL addr)
+{
+   addr &= ~(LL)0x7;
+   _gold->_mem->Write(addr, _mc->_mem->Read(addr));
+}
+
+void Checker::Retire(PipeReg *r)
+{
+   unsigned d, v;
+   int i;
+
+   if (r->_pc != _pc)
+      Diverge(r, "PC", _pc, r->_pc);
+
+   if (r->_isSyscall)
+   {
+      // already emulated by the pipeline, just take its results
+      for (i = 0; i < 32; i++)
+         _gold->_gpr[i] = _mc->_gpr[i];
+      _pc = _npc;
+      _npc = _pc + 4;
+      _nchecked++;
+      return;
+   }
+
+   if (!_gold->StepOne(_pc, _npc))
+      Diverge(r, "legal instruction", 1, 0);
+
+   d = r->_decodedDST;
+   if (r->_writeREG)
+   {
+      if (d != 0 && _gold->_gpr[d] != r->_opResultLo)
+         Diverge(r, "register write", _gold->_gpr[d], r->_opResultLo);
+   }
+   else if (r->_writeFREG)
+   {
+      v = _gold->_fpr[d >> 1].l[FP_TWIDDLE ^ (d & 1)];
+      if (v != r->_opResultLo)
+         Diverge(r, "fp register write", v, r->_opResultLo);
+   }
+   else
+   {
+      if (r->_loWPort && _gold->_lo != r->_opResultLo)
+         Diverge(r, "lo write", _gold->_lo, r->_opResultLo);
+      if (r->_hiWPort && _gold->_hi != r->_opResultHi)
+         Diverge(r, "hi write", _gold->_hi, r->_opResultHi);
+   }
+
+   if (r->_memControl && !r->_writeREG && !r->_writeFREG)
+      _stores[_nstores++] = *r;
+
+   _nchecked++;
+}
+
+void Checker::EndGroup(void)
+{
+   LL addr;
+   int k;
+
+   // the pipeline has not run a younger MEM stage yet
+   for (k = 0; k < _nstores; k++)
+   {
+      addr = _stores[k]._memory_addr_reg & ~(LL)0x7;
+      if (_gold->_mem->Read(addr) != _mc->_mem->Read(addr))
+      {
+         printf("Checker: store to %#llx: expected %#llx, got %#llx\n", addr,
+                _gold->_mem->Read(addr), _mc->_mem->Read(addr));
+         Diverge(&_stores[k], "memory write", (unsigned)_gold->_mem->Read(addr), (unsigned)_mc->_mem->Read(addr));
+      }
+   }
+   _nstores = 0;
+}
+
+void Checker::DumpLatch(char *name, PipeReg *r)
+{
+   if (r->_isNOP)
+   {
+      printf("  %-10s (bubble)\n", name); // the rest of the slot is stale
+      return;
+   }
+   printf("  %-10s pc %08x ins %08x dst %u src %d/%d res %08x/%08x addr %08x\n",
+          name, r->_pc, r->_ins,
+          r->_decodedDST, r->_decodedSRC1, r->_decodedSRC2,
+          r->_opResultHi, r->_opResultLo, r->_memory_addr_reg);
+}
+
+void Checker::Diverge(PipeReg *r, char *what, unsigned expected, unsigned got)
+{
+   int k;
+
+   printf("\nChecker: divergence at cycle %llu after %llu good instructions\n", SIM_TIME, _nchecked);
+   printf("Checker: ins %#x at PC %#x: %s expected %#x, got %#x\n", r->_ins, r->_pc, what, expected, got);
+
+   printf("Pipeline state:\n");
+   for (k = 0; k < _mc->_issueWidth; k++)
+      DumpLatch("IF/ID", &_mc->IF_ID_CUR[k]);
+   for (k = 0; k < _mc->_issueWidth; k++)
+      DumpLatch("ID/EX", &_mc->ID_EX_CUR[k]);
+   for (k = 0; k < _mc->_issueWidth; k++)
+      DumpLatch("EX/MEM", &_mc->EX_MEM_CUR[k]);
+   for (k = 0; k < _mc->_issueWidth; k++)
+      DumpLatch("MEM/WB", &_mc->MEM_WB_CUR[k]);
+   DumpLatch("retiring", r);
+   printf("Register state (pipeline):\n");
+   _mc->dumpregs();
+
+   _mc->MipcDumpstats();
+   Log::CloseLog();
+   exit(1);
+}
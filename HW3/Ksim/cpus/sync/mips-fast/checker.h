@@ -0,0 +1,45 @@
+#ifndef __CHECKER_H__
+#define __CHECKER_H__
+
+#include "mips.h"
+
+/*
+ * Lockstep golden-model checker.
+ *
+ * A second, never-scheduled Mipc, built with only its architectural
+ * state (Mipc::FunctionalSetup), runs functionally beside the pipeline
+ * and is stepped once per instruction retired in WB.  The retired PC,
+ * the value written to the destination register and the memory dword
+ * written by a store are compared against it; the first mismatch stops
+ * the simulation with a dump of the pipeline.  Syscalls are not rerun by
+ * the golden model: their register results are copied over and their
+ * memory writes are mirrored through MipcSysCall.  Stores are compared
+ * once the whole issue group has retired, since MEM has already performed
+ * every store of the group by then.
+ */
+class Checker
+{
+public:
+   Checker(Mipc *mc);
+   ~Checker();
+
+   void Sync(void);          // copy the full architectural state from _mc
+   void Retire(PipeReg *r);  // called by WB for every real instruction
+   void EndGroup(void);      // called by WB after the last slot
+   void MirrorStore(LL addr); // a syscall wrote this dword
+
+   LL _nchecked;
+
+private:
+   void Diverge(PipeReg *r, char *what, unsigned expected, unsigned got);
+   void DumpLatch(char *name, PipeReg *r);
+
+   Mipc *_mc;   // pipelined model
+   Mipc *_gold; // functional model
+   unsigned int _pc, _npc;
+
+   PipeReg _stores[MAX_ISSUE_WIDTH]; // stores retired in this group
+   int _nstores;
+};
+
+#endif /* __CHECKER_H__ */
@@ -0,0 +1,308 @@
+#include "mips.h"
+#include "bpred.h"
+#include "cache.h"
+#include "checkpoint.h"
+
+/*
+ * Binary checkpoints of a detailed run (Mipc.Checkpoint, Mipc.Restore).
+ *
+ * One is taken at the end of a cycle, once every stage has done its
+ * negedge work: fetch runs last in each phase, so no stage is halfway
+ * through a cycle and the restored tasks all start at the top of their
+ * MainLoop.  A checkpoint file holds
+ *
+ *   header     CKPT_MAGIC, version, restart time, parent file name
+ *   memory     Mem::SaveState page records
+ *   Mipc       registers, latches, fetch state, counters, predictor, caches
+ *   stages     SaveState of every stage in _stages[]
+ *   syscalls   open files and offsets, syscall counters
+ *
+ * With Mipc.CheckpointInterval the second and later checkpoints hold
+ * only the pages written since the one before, which they name as their
+ * parent; restoring replays the chain from the first file.  The decode
+ * and translation caches are rebuilt rather than saved, and the function
+ * pointers in the latches are recovered by decoding again.  Data is in
+ * host byte order, and the configuration must match the saving run's.
+ */
+#define CKPT_MAGIC "KSIMCKPT"
+#define CKPT_MAGIC_LEN 8
+#define CKPT_VERSION 7
+#define CKPT_NAME 1024
+
+static void CkptHeader(FILE *fp, Bool save, char *file, LL *time, char *parent)
+{
+   char magic[CKPT_MAGIC_LEN];
+   int version = CKPT_VERSION, len;
+
+   memcpy(magic, CKPT_MAGIC, CKPT_MAGIC_LEN);
+   ckpt_io(fp, save, magic, CKPT_MAGIC_LEN);
+   CKPT_IO(fp, save, version);
+   if (memcmp(magic, CKPT_MAGIC, CKPT_MAGIC_LEN) || version != CKPT_VERSION)
+      fatal_error("%s is not a Mipc checkpoint (version %d)", file, CKPT_VERSION);
+   ckpt_io(fp, save, time, sizeof(LL));
+   len = save ? strlen(parent) : 0;
+   CKPT_IO(fp, save, len);
+   if (len < 0 || len >= CKPT_NAME)
+      fatal_error("Bad parent name in checkpoint %s", file);
+   ckpt_io(fp, save, parent, len);
+   parent[len] = '\0';
+}
+
+// a latch bank pointer, as the number of the bank it points to
+static void CkptBank(FILE *fp, Bool save, PipeReg **p, PipeReg (*bank)[MAX_ISSUE_WIDTH], int nbanks)
+{
+   int i = save ? (*p - bank[0]) / MAX_ISSUE_WIDTH : 0;
+
+   CKPT_IO(fp, save, i);
+   Assert(i >= 0 && i < nbanks, "Bad latch bank in checkpoint");
+   *p = bank[i];
+}
+
+// decode again for the EX/MEM function pointers; bubbles get none
+static void CkptOps(Mipc *mc, PipeReg *r)
+{
+   DecodedIns d;
+   int k;
+
+   for (k = 0; k < MAX_ISSUE_WIDTH; k++)
+      if (r[k]._isNOP || (!r[k]._opControl && !r[k]._memOp))
+      {
+         r[k]._opControl = NULL;
+         r[k]._memOp = NULL;
+      }
+      else
+      {
+         mc->DecodeStatic(r[k]._pc, r[k]._ins, &d);
+         r[k]._opControl = r[k]._opControl ? d._opControl : NULL;
+         r[k]._memOp = r[k]._memOp ? d._memOp : NULL;
+      }
+}
+
+void Mipc::SaveState(FILE *fp)
+{
+   Checkpoint(fp, TRUE);
+}
+
+void Mipc::RestoreState(FILE *fp, UnCheckPoint *uc)
+{
+   Checkpoint(fp, FALSE);
+}
+
+void Mipc::Checkpoint(FILE *fp, Bool save)
+{
+   int width = _issueWidth, size = sizeof(PipeReg);
+   Bool bpred = _bpred != NULL, caches = _l1i != NULL, l2 = _l2 != NULL;
+   unsigned k;
+
+   CKPT_IO(fp, save, width);
+   CKPT_IO(fp, save, size);
+   CKPT_IO(fp, save, bpred);
+   CKPT_IO(fp, save, caches);
+   CKPT_IO(fp, save, l2);
+   Assert(width == _issueWidth && size == sizeof(PipeReg), "Checkpoint from a different pipeline");
+   Assert(bpred == (_bpred != NULL) && caches == (_l1i != NULL) && l2 == (_l2 != NULL),
+          "Checkpoint from a different predictor or cache configuration");
+
+   // architectural state
+   CKPT_IO(fp, save, _gpr);
+   CKPT_IO(fp, save, _fpr);
+   CKPT_IO(fp, save, _hi);
+   CKPT_IO(fp, save, _lo);
+   CKPT_IO(fp, save, _pc);
+   CKPT_IO(fp, save, _boot);
+
+   // latches
+   CKPT_IO(fp, save, _fetchBank);
+   CKPT_IO(fp, save, _groupBank);
+   CkptBank(fp, save, &IF_ID_CUR, _fetchBank, 2);
+   CkptBank(fp, save, &IF_ID_NEW, _fetchBank, 2);
+   CkptBank(fp, save, &ID_EX_CUR, _groupBank, 4);
+   CkptBank(fp, save, &EX_MEM_CUR, _groupBank, 4);
+   CkptBank(fp, save, &MEM_WB_CUR, _groupBank, 4);
+   CkptBank(fp, save, &ID_EX_NEW, _groupBank, 4);
+
+   // fetch, hazard and timing state
+   CKPT_IO(fp, save, _waitForSyscall);
+   CKPT_IO(fp, save, _toStall);
+   CKPT_IO(fp, save, is_subreg);
+   CKPT_IO(fp, save, _branchInterlock);
+   CKPT_IO(fp, save, _fetchDelaySlot);
+   CKPT_IO(fp, save, _dsResolved);
+   CKPT_IO(fp, save, _predNPC);
+   CKPT_IO(fp, save, _fetchSeq);
+   CKPT_IO(fp, save, _syscallSeq);
+   CKPT_IO(fp, save, _squash);
+   CKPT_IO(fp, save, _squashSeq);
+   CKPT_IO(fp, save, _redirectPC);
+   CKPT_IO(fp, save, _memStall);
+   CKPT_IO(fp, save, _regReady);
+   CKPT_IO(fp, save, _fetchStall);
+   CKPT_IO(fp, save, _fetchFillPC);
+   CKPT_IO(fp, save, _fetchWhy);
+   CKPT_IO(fp, save, _mdBusy);
+   CKPT_IO(fp, save, _hiloReady);
+   CKPT_IO(fp, save, _issued);
+
+   // statistics
+   CKPT_IO(fp, save, _nfetched);
+   CKPT_IO(fp, save, _nretired);
+   CKPT_IO(fp, save, _nfastfwd);
+   CKPT_IO(fp, save, _nxblocks);
+   CKPT_IO(fp, save, _nxchained);
+   CKPT_IO(fp, save, _nxflush);
+   CKPT_IO(fp, save, _num_cond_br);
+   CKPT_IO(fp, save, _num_jal);
+   CKPT_IO(fp, save, _num_jr);
+   CKPT_IO(fp, save, _num_load);
+   CKPT_IO(fp, save, _num_store);
+   CKPT_IO(fp, save, _fpinst);
+   CKPT_IO(fp, save, _issueHist);
+   CKPT_IO(fp, save, _groupStalls);
+   CKPT_IO(fp, save, _memPortStalls);
+   CKPT_IO(fp, save, _multStalls);
+   CKPT_IO(fp, save, _hiloStalls);
+   CKPT_IO(fp, save, _mdBusyStalls);
+   CKPT_IO(fp, save, _num_interlock);
+   CKPT_IO(fp, save, _nbypass);
+   CKPT_IO(fp, save, _icacheStalls);
+   CKPT_IO(fp, save, _dcacheStalls);
+   CKPT_IO(fp, save, _mshrPrimary);
+   CKPT_IO(fp, save, _mshrMerged);
+   CKPT_IO(fp, save, _mshrFullStalls);
+   CKPT_IO(fp, save, _scoreboardStalls);
+   CKPT_IO(fp, save, _nmispred);
+   CKPT_IO(fp, save, _nsquashed);
+   CKPT_IO(fp, save, _squashCycles);
+   CKPT_IO(fp, save, _cpiStack);
+   CKPT_IO(fp, save, _dcache_lookups);
+   CKPT_IO(fp, save, _dcache_misses);
+
+   // sampling progress
+   CKPT_IO(fp, save, _samplePhase);
+   CKPT_IO(fp, save, _sampleEnd);
+   CKPT_IO(fp, save, _sampleCycle);
+   CKPT_IO(fp, save, _sampleInsn);
+   CKPT_IO(fp, save, _nsamples);
+   CKPT_IO(fp, save, _cpiSum);
+   CKPT_IO(fp, save, _cpiSumSq);
+
+   if (_bpred)
+      _bpred->Checkpoint(fp, save);
+   if (_l1i)
+   {
+      _l1i->Checkpoint(fp, save);
+      _l1d->Checkpoint(fp, save);
+      if (_l2)
+         _l2->Checkpoint(fp, save);
+   }
+
+   if (save)
+      return;
+
+   for (k = 0; k < 2; k++)
+      CkptOps(this, _fetchBank[k]);
+   for (k = 0; k < 4; k++)
+      CkptOps(this, _groupBank[k]);
+   IF_ID_NXT = &IF_ID_CUR[0];
+   ID_EX_NXT = &ID_EX_CUR[0];
+   EX_MEM_NXT = &EX_MEM_CUR[0];
+   MEM_WB_NXT = &MEM_WB_CUR[0];
+
+   for (k = 0; k <= _dcacheMask; k++)
+      _dcache[k]._valid = FALSE;
+   XlateFlush();
+}
+
+/*
+ * Called from MainLoop at negedge, after the last stage has finished
+ * the cycle; the restored run starts with the next posedge
+ */
+void Mipc::SaveCheckpoint(void)
+{
+   char file[CKPT_NAME];
+   LL time = etime.count + 1;
+   FILE *fp;
+   int k, delta;
+
+   for (k = 0; k < _nstages; k++)
+      Assert(_stages[k]->SimCore()->count > etime.count, "Checkpoint in the middle of a cycle");
+
+   if (_nckpt == 0)
+      snprintf(file, CKPT_NAME, "%s", ParamGetString("Mipc.CheckpointFile"));
+   else
+      snprintf(file, CKPT_NAME, "%s.%d", ParamGetString("Mipc.CheckpointFile"), _nckpt);
+   if (!(fp = fopen(file, "wb")))
+      fatal_error("Could not create checkpoint %s", file);
+
+   // later checkpoints only hold the pages written since the last one
+   delta = _ckptInterval > 0 && _ckptLast;
+   CkptHeader(fp, TRUE, file, &time, delta ? _ckptLast : (char *)"");
+   _mem->SaveState(fp, delta);
+   SaveState(fp);
+   for (k = 0; k < _nstages; k++)
+      _stages[k]->SaveState(fp);
+   _sys->SaveState(fp);
+   if (fclose(fp) != 0)
+      fatal_error("Error writing checkpoint %s", file);
+
+   _l.print("Checkpoint %s at cycle %llu, %llu instructions fetched", file, SIM_TIME + 1, _nfetched);
+
+   if (_ckptLast)
+      free(_ckptLast);
+   MALLOC(_ckptLast, char, strlen(file) + 1);
+   strcpy(_ckptLast, file);
+   _nckpt++;
+   _ckptNext = _ckptInterval > 0 ? _ckptNext + _ckptInterval : 0;
+
+   if (ParamGetBool("Mipc.CheckpointExit"))
+      _sim_exit = 1;
+}
+
+/*
+ * Read the header of "file" and rebuild its memory, parent first.  The
+ * returned file is positioned at the Mipc state.
+ */
+FILE *Mipc::OpenCheckpoint(char *file, LL *time)
+{
+   char parent[CKPT_NAME];
+   LL ptime;
+   FILE *fp;
+
+   if (!(fp = fopen(file, "rb")))
+      fatal_error("Could not open checkpoint %s", file);
+   CkptHeader(fp, FALSE, file, time, parent);
+   if (parent[0])
+   {
+      fclose(OpenCheckpoint(parent, &ptime));
+      Assert(ptime < *time, "Checkpoint is older than its parent");
+   }
+   _mem->RestoreState(fp);
+   return fp;
+}
+
+/*
+ * Called from main() once the stages exist and before their tasks are
+ * created, so the tasks start at the restored time
+ */
+void Mipc::RestoreCheckpoint(char *file)
+{
+   LL time;
+   FILE *fp;
+   int k;
+
+   _mem->Clear();
+   fp = OpenCheckpoint(file, &time);
+   RestoreState(fp, NULL);
+   for (k = 0; k < _nstages; k++)
+      _stages[k]->RestoreState(fp, NULL);
+   _sys->RestoreState(fp);
+   if (fgetc(fp) != EOF)
+      fatal_error("Trailing data in checkpoint %s", file);
+   fclose(fp);
+
+   etime.count = time;
+   _restored = TRUE;
+   if (_ckptNext && _ckptNext <= SIM_TIME)
+      _ckptNext = _ckptInterval > 0 ? _ckptNext + ((SIM_TIME - _ckptNext) / _ckptInterval + 1) * _ckptInterval : 0;
+   _l.print("Restored %s, detailed simulation resumes at cycle %llu", file, SIM_TIME);
+}
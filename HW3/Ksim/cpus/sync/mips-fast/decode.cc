@@ -1,278 +1,359 @@
 #include "decode.h"
+#include "trace.h"
+#include "checkpoint.h"
 
 Decode::Decode(Mipc *mc)
 {
    _mc = mc;
+   _mc->_stages[_mc->_nstages++] = this;
 }
 
 Decode::~Decode(void) {}
 
-// TODO: Implement bypass logic
-#ifdef BYPASS_ENABLED
-Bool Decode::check_bypass(PipeReg &IF_ID_NXT)
+// _in/_out are picked up again at the next posedge
+void Decode::SaveState(FILE *fp)
 {
-   Bool toStall = FALSE;
+   CKPT_IO(fp, 1, _why);
+}
 
-   if (IF_ID_NXT._requiresFP)
-   {
-      // requires Floating Point Argument
-      if (IF_ID_NXT._regSRC1 != REG_DEFAULT)
-      {
+void Decode::RestoreState(FILE *fp, UnCheckPoint *uc)
+{
+   CKPT_IO(fp, 0, _why);
+}
 
-         // check whether the value required is being produced in EX stage as of now, if yes, then stall
-         if ((_mc->ID_EX_CUR._writeFREG && (IF_ID_NXT._regSRC1 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            if (_mc->ID_EX_CUR._memControl)
-            { // if it is a load instructions, then do load interlock
-               toStall = TRUE;
-               _mc->_num_interlock++;
-            }
-            else
-               IF_ID_NXT._bypSRC1 = BYPASS_EX_EX;
-         }
-         // check whether the value required is being produced in MEM stage as of now, if yes, then stall
-         else if ((_mc->EX_MEM_CUR._writeFREG && (IF_ID_NXT._regSRC1 == _mc->EX_MEM_CUR._decodedDST)))
-         {
-#ifdef BYPASS_MEM_EX_ENABLED
-            IF_ID_NXT._bypSRC1 = BYPASS_MEM_EX;
-#else
-            toStall = TRUE;
-#endif
-         }
-      }
+// Does "r" write integer (fp=FALSE) or fp (fp=TRUE) register "reg"?
+#define WRITES(r, reg, fp) (!(r)._isNOP &&                                         \
+                            ((fp) ? ((r)._writeFREG && (r)._decodedDST == (reg)) \
+                                  : ((r)._writeREG && (r)._decodedDST == (reg))))
 
-      // Similarly check for SRC2
-      if (IF_ID_NXT._regSRC2 != REG_DEFAULT)
-      {
+/*
+ * Hazard unit.  A producer still in EX, MEM or WB as decode sees them
+ * (ID_EX_CUR, EX_MEM_CUR, MEM_WB_CUR) reaches this instruction's EX
+ * over the path in the table for its stage, if Mipc.Bypass enables it;
+ * otherwise decode stalls.  A load in EX has nothing to forward yet.
+ */
+#define HAZARD_STAGES 3
 
-         if ((_mc->ID_EX_CUR._writeFREG && (IF_ID_NXT._regSRC2 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            if (_mc->ID_EX_CUR._memControl)
-            { // if it is a load instructions, then do load interlock
-               toStall = TRUE;
-               _mc->_num_interlock++;
-            }
-            else
-               IF_ID_NXT._bypSRC2 = BYPASS_EX_EX;
-         }
-         else if ((_mc->EX_MEM_CUR._writeFREG && (IF_ID_NXT._regSRC2 == _mc->EX_MEM_CUR._decodedDST)))
-         {
-#ifdef BYPASS_MEM_EX_ENABLED
-            IF_ID_NXT._bypSRC2 = BYPASS_MEM_EX;
-#else
-            toStall = TRUE;
-#endif
-         }
-      }
-   }
-   else
-   {
-      // Integer Ins
-      if (IF_ID_NXT._regSRC1 != 0 && IF_ID_NXT._regSRC1 != REG_DEFAULT)
+Bool Decode::bypass_src(unsigned reg, Bool fp, unsigned *byp, unsigned *slot)
+{
+   static const unsigned path[HAZARD_STAGES] = {BYPASS_EX_EX, BYPASS_MEM_EX, BYPASS_WB_ID};
+   PipeReg *stage[HAZARD_STAGES] = {_mc->ID_EX_CUR, _mc->EX_MEM_CUR, _mc->MEM_WB_CUR};
+   int s, k;
+
+   // youngest producer first
+   for (s = 0; s < HAZARD_STAGES; s++)
+      for (k = _mc->_issueWidth - 1; k >= 0; k--)
       {
-         if ((_mc->ID_EX_CUR._writeREG && (IF_ID_NXT._regSRC1 == _mc->ID_EX_CUR._decodedDST)))
+         if (!WRITES(stage[s][k], reg, fp))
+            continue;
+         if (s == 0 && stage[s][k]._memControl)
          {
-            if (_mc->ID_EX_CUR._memControl)
-            { // if it is a load instructions, then do load interlock
-               toStall = TRUE;
+            // load interlock; one cycle if MEM->EX can pick it up next
+            if (_mc->_bypass & BYPASS_PATH(BYPASS_MEM_EX))
+            {
                _mc->_num_interlock++;
+               _why = CPI_LOADUSE;
             }
             else
-               IF_ID_NXT._bypSRC1 = BYPASS_EX_EX;
+               _why = CPI_RAW;
+            return TRUE;
          }
-         else if ((_mc->EX_MEM_CUR._writeREG && (IF_ID_NXT._regSRC1 == _mc->EX_MEM_CUR._decodedDST)))
+         if (!(_mc->_bypass & BYPASS_PATH(path[s])))
          {
-#ifdef BYPASS_MEM_EX_ENABLED
-            IF_ID_NXT._bypSRC1 = BYPASS_MEM_EX;
-#else
-            toStall = TRUE;
-#endif
+            _why = CPI_RAW;
+            return TRUE;
          }
+         *byp = path[s];
+         *slot = k;
+         return FALSE;
       }
+   return FALSE;
+}
+
+Bool Decode::check_bypass(PipeReg &IF_ID_NXT)
+{
+   static const unsigned path[2] = {BYPASS_EX_EX, BYPASS_MEM_EX};
+   PipeReg *stage[2] = {_mc->ID_EX_CUR, _mc->EX_MEM_CUR};
+   Bool fp = IF_ID_NXT._requiresFP;
+   int s, k;
+
+   IF_ID_NXT._bypSRC1 = BYPASS_NONE;
+   IF_ID_NXT._bypSRC2 = BYPASS_NONE;
+
+   if (IF_ID_NXT._regSRC1 != REG_DEFAULT && (fp || IF_ID_NXT._regSRC1 != 0) &&
+       bypass_src(IF_ID_NXT._regSRC1, fp, &IF_ID_NXT._bypSRC1, &IF_ID_NXT._bypSlot1))
+      return TRUE;
 
-      // Integer Ins
-      if (!_mc->is_subreg && IF_ID_NXT._regSRC2 != 0 && IF_ID_NXT._regSRC2 != REG_DEFAULT)
+   // lwl/lwr read their old rt value in MEM
+   if (IF_ID_NXT._regSRC2 != REG_DEFAULT && (fp || (IF_ID_NXT._regSRC2 != 0 && !_mc->is_subreg)) &&
+       bypass_src(IF_ID_NXT._regSRC2, fp, &IF_ID_NXT._bypSRC2, &IF_ID_NXT._bypSlot2))
+      return TRUE;
+
+   // mfhi/mflo read HI/LO in EX, after WB has written them
+   if (!IF_ID_NXT._hiWrite && !IF_ID_NXT._loWrite)
+      return FALSE;
+   for (s = 0; s < 2; s++)
+      for (k = _mc->_issueWidth - 1; k >= 0; k--)
       {
-         if ((_mc->ID_EX_CUR._writeREG && (IF_ID_NXT._regSRC2 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            if (_mc->ID_EX_CUR._memControl)
-            { // if it is a load instructions, then do load interlock
-               toStall = TRUE;
-               _mc->_num_interlock++;
-            }
-            else
-               IF_ID_NXT._bypSRC2 = BYPASS_EX_EX;
-         }
-         else if ((_mc->EX_MEM_CUR._writeREG && (IF_ID_NXT._regSRC2 == _mc->EX_MEM_CUR._decodedDST)))
+         if (stage[s][k]._isNOP ||
+             (!(IF_ID_NXT._loWrite && stage[s][k]._loWPort) && !(IF_ID_NXT._hiWrite && stage[s][k]._hiWPort)))
+            continue;
+         if (!(_mc->_bypass & BYPASS_PATH(path[s])))
          {
-#ifdef BYPASS_MEM_EX_ENABLED
-            IF_ID_NXT._bypSRC2 = BYPASS_MEM_EX;
-#else
-            toStall = TRUE;
-#endif
+            _why = CPI_HILO;
+            return TRUE;
          }
+         IF_ID_NXT._bypSRC1 = path[s];
+         IF_ID_NXT._bypSlot1 = k;
+         return FALSE;
       }
-   }
+   return FALSE;
+}
+
+/*
+ * Intra-group checks for the instruction in "slot" against the older
+ * instructions already issued this cycle (_in[0..slot-1]).  These all
+ * read registers at the same negedge and cannot forward to each other.
+ * Also enforces the structural limits.
+ */
+Bool Decode::check_group(PipeReg &IF_ID_NXT, int slot)
+{
+   Bool fp = IF_ID_NXT._requiresFP;
+   Bool isStore, storeFP;
+   int k, nmem, nmul;
+
+   isStore = IF_ID_NXT._memControl && !IF_ID_NXT._writeREG && !IF_ID_NXT._writeFREG;
+   storeFP = isStore && IF_ID_NXT._memOp == Mipc::mem_swc1;
 
-   // Check for hi/lo registers
-   if (IF_ID_NXT._loWrite)
+   nmem = IF_ID_NXT._memControl ? 1 : 0;
+   nmul = (IF_ID_NXT._hiWPort && IF_ID_NXT._loWPort) ? 1 : 0;
+
+   for (k = 0; k < slot; k++)
    {
-      if (_mc->ID_EX_CUR._loWPort)
-      {
-         IF_ID_NXT._bypSRC1 = BYPASS_EX_EX;
-      }
-      else if (_mc->EX_MEM_CUR._loWPort)
-      {
-#ifdef BYPASS_MEM_EX_ENABLED
-         IF_ID_NXT._bypSRC1 = BYPASS_MEM_EX;
-#else
-         toStall = TRUE;
-#endif
-      }
+      PipeReg &o = _in[k];
+
+      _why = CPI_RAW;
+      if (IF_ID_NXT._regSRC1 != REG_DEFAULT && (fp || IF_ID_NXT._regSRC1 != 0) &&
+          WRITES(o, IF_ID_NXT._regSRC1, fp))
+         return TRUE;
+      if (IF_ID_NXT._regSRC2 != REG_DEFAULT && (fp || IF_ID_NXT._regSRC2 != 0) &&
+          WRITES(o, IF_ID_NXT._regSRC2, fp))
+         return TRUE;
+      // store data is read from the register file in MEM
+      if (isStore && (storeFP || IF_ID_NXT._decodedDST != 0) &&
+          WRITES(o, IF_ID_NXT._decodedDST, storeFP))
+         return TRUE;
+      _why = CPI_HILO;
+      if ((IF_ID_NXT._loWrite && o._loWPort) || (IF_ID_NXT._hiWrite && o._hiWPort))
+         return TRUE;
+
+      if (o._memControl)
+         nmem++;
+      if (o._hiWPort && o._loWPort)
+         nmul++;
    }
 
-   if (IF_ID_NXT._hiWrite)
+   _why = CPI_STRUCT;
+   if (nmem > _mc->_memPorts)
    {
-      if (_mc->ID_EX_CUR._hiWPort)
-      {
-         IF_ID_NXT._bypSRC1 = BYPASS_EX_EX;
-      }
-      else if (_mc->EX_MEM_CUR._hiWPort)
-      {
-#ifdef BYPASS_MEM_EX_ENABLED
-         IF_ID_NXT._bypSRC1 = BYPASS_MEM_EX;
-#else
-         toStall = TRUE;
-#endif
-      }
+      _mc->_memPortStalls++;
+      return TRUE;
    }
-
-   return toStall;
+   if (nmul > _mc->_multipliers)
+   {
+      _mc->_multStalls++;
+      return TRUE;
+   }
+   return FALSE;
 }
-#else
-Bool Decode::check_stall(PipeReg &IF_ID_NXT)
+
+/*
+ * Operands of loads still waiting in an MSHR (Memory::dcache_access).
+ * _regReady holds the cycle each register becomes valid, integer
+ * registers first, then fp.
+ */
+#define NOT_READY(reg, fp) (_mc->_regReady[((fp) ? 32 : 0) + (reg)] > SIM_TIME)
+
+Bool Decode::check_scoreboard(PipeReg &IF_ID_NXT)
 {
-   Bool toStall = FALSE;
+   Bool fp = IF_ID_NXT._requiresFP;
+   Bool storeFP;
 
-   if (IF_ID_NXT._requiresFP)
+   _why = CPI_DCACHE;
+   if (IF_ID_NXT._regSRC1 != REG_DEFAULT && NOT_READY(IF_ID_NXT._regSRC1, fp))
+      return TRUE;
+   if (IF_ID_NXT._regSRC2 != REG_DEFAULT && NOT_READY(IF_ID_NXT._regSRC2, fp))
+      return TRUE;
+   if (IF_ID_NXT._memControl && !IF_ID_NXT._writeREG && !IF_ID_NXT._writeFREG)
    {
-      // requires Floating Point Argument
-      if (IF_ID_NXT._regSRC1 != REG_DEFAULT)
-      {
-
-         // check whether the value required is being produced in EX stage as of now, if yes, then stall
-         if ((_mc->ID_EX_CUR._writeFREG && (IF_ID_NXT._regSRC1 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
+      storeFP = IF_ID_NXT._memOp == Mipc::mem_swc1;
+      if (NOT_READY(IF_ID_NXT._decodedDST, storeFP))
+         return TRUE;
+   }
+   return FALSE;
+}
 
-         // check whether the value required is being produced in MEM stage as of now, if yes, then stall
-         if ((_mc->EX_MEM_CUR._writeFREG && (IF_ID_NXT._regSRC1 == _mc->EX_MEM_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
-      }
+/*
+ * HI/LO scoreboard (Mipc::MulDivStart).  mfhi/mflo wait for the result
+ * of the youngest mult/div; a HI/LO writer waits if it would finish
+ * before an older one still in flight, and a mult/div for a free unit.
+ * The pipeline hazards on HI/LO are still checked by check_bypass.
+ */
+Bool Decode::check_muldiv(PipeReg &IF_ID_NXT)
+{
+   int lat;
 
-      // Similarly check for SRC2
-      if (IF_ID_NXT._regSRC2 != REG_DEFAULT)
+   _why = CPI_HILO;
+   if (IF_ID_NXT._hiWrite || IF_ID_NXT._loWrite)
+   {
+      if (_mc->_hiloReady > SIM_TIME)
       {
-         if ((_mc->ID_EX_CUR._writeFREG && (IF_ID_NXT._regSRC2 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
-
-         if ((_mc->EX_MEM_CUR._writeFREG && (IF_ID_NXT._regSRC2 == _mc->EX_MEM_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
+         _mc->_hiloStalls++;
+         return TRUE;
       }
    }
-   else
+   else if (IF_ID_NXT._hiWPort || IF_ID_NXT._loWPort)
    {
-      // Integer Ins
-      if (IF_ID_NXT._regSRC1 != 0 && IF_ID_NXT._regSRC1 != REG_DEFAULT)
+      lat = 1;
+      if (IF_ID_NXT._hiWPort && IF_ID_NXT._loWPort)
+         lat = (IF_ID_NXT._opControl == Mipc::func_div || IF_ID_NXT._opControl == Mipc::func_divu)
+                   ? _mc->_divLatency
+                   : _mc->_mulLatency;
+      if (SIM_TIME + lat < _mc->_hiloReady)
       {
-         if ((_mc->ID_EX_CUR._writeREG && (IF_ID_NXT._regSRC1 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
-
-         if ((_mc->EX_MEM_CUR._writeREG && (IF_ID_NXT._regSRC1 == _mc->EX_MEM_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
+         _mc->_hiloStalls++;
+         return TRUE;
       }
-
-      // Integer Ins
-      if (IF_ID_NXT._regSRC2 != 0 && IF_ID_NXT._regSRC2 != REG_DEFAULT)
+      if (IF_ID_NXT._hiWPort && IF_ID_NXT._loWPort && !_mc->MulDivFree())
       {
-         if ((_mc->ID_EX_CUR._writeREG && (IF_ID_NXT._regSRC2 == _mc->ID_EX_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
-
-         if ((_mc->EX_MEM_CUR._writeREG && (IF_ID_NXT._regSRC2 == _mc->EX_MEM_CUR._decodedDST)))
-         {
-            toStall = TRUE;
-         }
+         _mc->_mdBusyStalls++;
+         return TRUE;
       }
    }
-
-   // Check for hi/lo registers
-   if (IF_ID_NXT._loWrite && (_mc->ID_EX_CUR._loWPort || _mc->EX_MEM_CUR._loWPort))
-      toStall = TRUE;
-   if (IF_ID_NXT._hiWrite && (_mc->ID_EX_CUR._hiWPort || _mc->EX_MEM_CUR._hiWPort))
-      toStall = TRUE;
-
-   return toStall;
+   return FALSE;
 }
-#endif
 
 void Decode::MainLoop(void)
 {
    unsigned int ins;
+   int k, issued, nsquashed;
+   Bool stall;
+
    while (1)
    {
       AWAIT_P_PHI0; // @posedge -- copy input and detect hazard
-
-      _mc->IF_ID_NXT = _mc->IF_ID_CUR;
-      ins = _mc->IF_ID_NXT._ins;
-
-#ifdef BYPASS_ENABLED
-      _mc->IF_ID_NXT._bypSRC1 = BYPASS_NONE;
-      _mc->IF_ID_NXT._bypSRC2 = BYPASS_NONE;
-#endif
-      // Call Dec with FALSE, to check if instruction.
-      _mc->Dec(ins, FALSE);
-      if (!_mc->IF_ID_NXT._isIllegalOp)
-      {
-#ifdef BYPASS_ENABLED
-         _mc->_toStall = check_bypass(_mc->IF_ID_NXT);
-#else
-         _mc->_toStall = check_stall(_mc->IF_ID_NXT);
-#endif
-      }
-      else
+      if (_mc->_memStall)
       {
-         _mc->_toStall = TRUE; // consider illegal op as NOP. for now i.e continue execution after it.
+         _mc->_cpiStack[CPI_DCACHE]++;
+         AWAIT_P_PHI1; // frozen behind a D-cache miss
+         continue;
       }
 
-      if (!_mc->_toStall && _mc->IF_ID_NXT._isSyscall)
+      // Issue the fetch group in order, up to the first instruction
+      // that has to wait.  The slots are decoded in place: fetch builds
+      // the next group in the other bank.
+      _in = _mc->IF_ID_CUR;
+      _out = _mc->ID_EX_NEW;
+      issued = 0;
+      for (k = 0; k < _mc->_issueWidth; k++)
       {
-         _mc->_waitForSyscall = TRUE;
+         if (_in[k]._isNOP)
+            break;
+
+         _mc->IF_ID_NXT = &_in[k];
+         ins = _in[k]._ins;
+
+         // Call Dec with FALSE, to check if instruction.
+         _mc->Dec(ins, FALSE);
+         if (!_in[k]._isIllegalOp)
+         {
+            stall = check_bypass(_in[k]);
+            if (!stall && _mc->_nmshr > 0 && check_scoreboard(_in[k]))
+            {
+               _mc->_scoreboardStalls++;
+               stall = TRUE;
+            }
+            if (!stall && k > 0 && check_group(_in[k], k))
+            {
+               _mc->_groupStalls++;
+               stall = TRUE;
+            }
+            if (!stall && check_muldiv(_in[k]))
+               stall = TRUE;
+         }
+         else
+         {
+            stall = TRUE; // consider illegal op as NOP. for now i.e continue execution after it.
+            _why = CPI_OTHER;
+         }
+         if (stall)
+         {
+            TRACE_STALL(_in[k], TRACE_WHY(_why));
+            break;
+         }
+
+         issued++;
+         if (_in[k]._hiWPort && _in[k]._loWPort)
+            _mc->MulDivStart(_in[k]._opControl);
+
+         if (_in[k]._isSyscall)
+         {
+            // nothing younger than a syscall issues with it
+            _mc->_waitForSyscall = TRUE;
+            _mc->_syscallSeq = _in[k]._seq;
+            break;
+         }
       }
+      _mc->_issued = issued;
+      _mc->_toStall = (issued == 0 && !_in[0]._isNOP);
+      _mc->_issueHist[issued]++;
+
+      // CPI stack: a cycle that issued nothing is charged to whatever
+      // held up the oldest instruction, or to why there was none
+      if (issued > 0)
+         _mc->_cpiStack[CPI_BASE]++;
+      else if (_in[0]._isNOP)
+         _mc->_cpiStack[_mc->_fetchWhy]++;
+      else
+         _mc->_cpiStack[_why]++;
 
       AWAIT_P_PHI1; // @negedge
 
-      if (_mc->_toStall)
-         _mc->ID_EX_CUR.clear(); // or ID_EX_CUR = NOP
-      else
+      nsquashed = 0;
+
+      // The issued slots are the one copy an instruction gets: from
+      // here to WB it stays in this ID/EX bank
+      for (k = 0; k < _mc->_issueWidth; k++)
       {
+         if (k >= issued)
+         {
+            _out[k]._isNOP = TRUE;
+            continue;
+         }
+         if (_mc->_squash && _in[k]._seq > _mc->_squashSeq)
+         {
+            // issued down the wrong path of a CTI now in EX
+            TRACE_SQUASH(_mc, _in[k]);
+            _out[k]._isNOP = TRUE;
+            _mc->_nfetched--;
+            _mc->_nsquashed++;
+            nsquashed++;
+            continue;
+         }
+         _out[k] = _in[k];
+         _mc->IF_ID_NXT = &_out[k];
+         ins = _out[k]._ins;
          _mc->Dec(ins, TRUE);
+         TRACE_STAGE(_out[k], Decode);
 #ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> Decoded ins %#x\n", SIM_TIME, ins);
+         fprintf(_mc->_debugLog, "<%llu> Decoded ins %#x in slot %d\n", SIM_TIME, ins, k);
 #endif
-         _mc->ID_EX_CUR = _mc->ID_EX_NXT;
+      }
+      if (issued > 0 && nsquashed == issued)
+      {
+         // the whole group was wrong path
+         _mc->_cpiStack[CPI_BASE]--;
+         _mc->_cpiStack[CPI_BRANCH]++;
       }
    }
 }
@@ -9,14 +9,17 @@ class Decode : public SimObject {
 public:
    Decode (Mipc*);
    ~Decode ();
-#ifdef BYPASS_ENABLED
    Bool check_bypass(PipeReg &IF_ID_NXT);
-#else 
-   Bool check_stall(PipeReg &IF_ID_NXT);
-#endif   
+   Bool bypass_src(unsigned reg, Bool fp, unsigned *byp, unsigned *slot);
+   Bool check_group(PipeReg &IF_ID_NXT, int slot);
+   Bool check_scoreboard(PipeReg &IF_ID_NXT);
+   Bool check_muldiv(PipeReg &IF_ID_NXT);
   
-   FAKE_SIM_TEMPLATE;
+   SAVE_SIM_TEMPLATE;
 
    Mipc *_mc;
+   PipeReg *_in;  // IF/ID bank sampled at posedge
+   PipeReg *_out; // ID/EX bank filled at negedge
+   int _why; // CPI_* bucket of the last check that stalled
 };
 #endif
@@ -1,6 +1,7 @@
 #include <math.h>
 #include "mips.h"
 #include "opcodes.h"
+#include "isa.h"
 #include <assert.h>
 #include "app_syscall.h"
 
@@ -13,27 +14,22 @@
  *------------------------------------------------------------------------
  */
 
-// Called twice: once for hazard checks (real=FALSE), once for reg read (real=TRUE)
-void Mipc::Dec(unsigned int ins, Bool real)
+/*
+ * Static part of the decode: everything that depends only on the
+ * instruction word and its PC.  Register values are not read here, the
+ * result is cached in the decode cache and replayed by Dec().
+ */
+void Mipc::DecodeStatic(unsigned int pc, unsigned int ins, DecodedIns *d)
 {
    MipsInsn i;
    i.data = ins;
 
-   signed int a1, a2;
-   unsigned int ar1, ar2, s1, s2, r1, r2, t1, t2;
-   LL addr;
-   unsigned int val;
-   LL value, mask;
-   int sa, j;
-   Word dummy;
-
-   unsigned int _pc = IF_ID_NXT._pc;
+   unsigned int _pc = pc;
    signed int _decodedSRC1 = 0, _decodedSRC2 = 0;
    unsigned _regSRC1 = REG_DEFAULT, _regSRC2 = REG_DEFAULT;
    Bool _requiresFP = FALSE;
    Bool _hiWrite = FALSE, _loWrite = FALSE;
    unsigned _decodedDST = 0;
-   unsigned _subregOperand = 0;
    Bool _memControl = FALSE;
    Bool _writeREG = FALSE, _writeFREG = FALSE;
    signed int _branchOffset = 0;
@@ -48,6 +44,12 @@ void Mipc::Dec(unsigned int ins, Bool real)
    void (*_opControl)(Mipc *, unsigned) = NULL;
    void (*_memOp)(Mipc *) = NULL;
 
+   unsigned _src1Sel = DEC_SRC_NONE, _src2Sel = DEC_SRC_NONE;
+   unsigned _src1Idx = 0, _src2Idx = 0;
+   Bool _isSubreg = FALSE;
+   Bool _jumpReg = FALSE;
+   Bool _isFP = FALSE;
+
 #define SIGN_EXTEND_BYTE(x) \
    do                       \
    {                        \
@@ -61,15 +63,15 @@ void Mipc::Dec(unsigned int ins, Bool real)
       x >>= 16;            \
    } while (0)
 
-   is_subreg = FALSE;
-
    switch (i.reg.op)
    {
    case 0:
       // SPECIAL (ALU format)
 
-      _decodedSRC1 = _gpr[i.reg.rs];
-      _decodedSRC2 = _gpr[i.reg.rt];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
+      _src2Sel = DEC_SRC_GPR;
+      _src2Idx = i.reg.rt;
       _regSRC1 = i.reg.rs;
       _regSRC2 = i.reg.rt;
       _decodedDST = i.reg.rd;
@@ -201,7 +203,7 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
       case 9: // jalr
          _opControl = func_jalr;
-         _btgt = _decodedSRC1;
+         _jumpReg = TRUE;
          _bdslot = 1;
          break;
 
@@ -209,7 +211,7 @@ void Mipc::Dec(unsigned int ins, Bool real)
          _opControl = func_jr;
          _writeREG = FALSE;
          _writeFREG = FALSE;
-         _btgt = _decodedSRC1;
+         _jumpReg = TRUE;
          _bdslot = 1;
          break;
 
@@ -238,7 +240,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 9: // addiu
       // ignore overflow: no exceptions
       _opControl = func_addi_addiu;
-      _decodedSRC1 = _gpr[i.imm.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.imm.rs;
       _decodedDST = i.imm.rt;
@@ -251,7 +254,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 0xc: // andi
       _opControl = func_andi;
-      _decodedSRC1 = _gpr[i.imm.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.imm.rs;
       _decodedDST = i.imm.rt;
@@ -275,7 +279,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 0xd: // ori
       _opControl = func_ori;
-      _decodedSRC1 = _gpr[i.imm.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
       _decodedSRC2 = i.imm.imm;
       _decodedDST = i.imm.rt;
       _regSRC1 = i.imm.rs;
@@ -288,7 +293,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 0xa: // slti
       _opControl = func_slti;
-      _decodedSRC1 = _gpr[i.imm.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
       _regSRC1 = i.imm.rs;
       _decodedSRC2 = i.imm.imm;
       _decodedDST = i.imm.rt;
@@ -301,7 +307,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 0xb: // sltiu
       _opControl = func_sltiu;
-      _decodedSRC1 = _gpr[i.imm.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
       _regSRC1 = i.imm.rs;
       _decodedSRC2 = i.imm.imm;
       _decodedDST = i.imm.rt;
@@ -314,7 +321,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 0xe: // xori
       _opControl = func_xori;
-      _decodedSRC1 = _gpr[i.imm.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.imm.rs;
       _decodedDST = i.imm.rt;
@@ -327,8 +335,10 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 4: // beq
       _opControl = func_beq;
-      _decodedSRC1 = _gpr[i.imm.rs];
-      _decodedSRC2 = _gpr[i.imm.rt];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.imm.rs;
+      _src2Sel = DEC_SRC_GPR;
+      _src2Idx = i.imm.rt;
       _regSRC1 = i.imm.rs;
       _regSRC2 = i.imm.rt;
       _branchOffset = i.imm.imm;
@@ -345,7 +355,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 1:
       // REGIMM
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _regSRC1 = i.reg.rs;
       _branchOffset = i.imm.imm;
       _writeREG = FALSE;
@@ -400,7 +411,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 7: // bgtz
       _opControl = func_bgtz;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _regSRC1 = i.reg.rs;
       _branchOffset = i.imm.imm;
       _writeREG = FALSE;
@@ -416,7 +428,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 6: // blez
       _opControl = func_blez;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _regSRC1 = i.reg.rs;
       _branchOffset = i.imm.imm;
       _writeREG = FALSE;
@@ -432,8 +445,10 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
    case 5: // bne
       _opControl = func_bne;
-      _decodedSRC1 = _gpr[i.reg.rs];
-      _decodedSRC2 = _gpr[i.reg.rt];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
+      _src2Sel = DEC_SRC_GPR;
+      _src2Idx = i.reg.rt;
       _regSRC1 = i.reg.rs;
       _regSRC2 = i.reg.rt;
       _branchOffset = i.imm.imm;
@@ -476,7 +491,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x20: // lb
       _opControl = func_lb;
       _memOp = mem_lb;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -490,7 +506,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x24: // lbu
       _opControl = func_lbu;
       _memOp = mem_lbu;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _regSRC1 = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _decodedDST = i.reg.rt;
@@ -504,7 +521,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x21: // lh
       _opControl = func_lh;
       _memOp = mem_lh;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _regSRC1 = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _decodedDST = i.reg.rt;
@@ -518,7 +536,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x25: // lhu
       _opControl = func_lhu;
       _memOp = mem_lhu;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _regSRC1 = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _decodedDST = i.reg.rt;
@@ -532,24 +551,25 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x22: // lwl
       _opControl = func_lwl;
       _memOp = mem_lwl;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _regSRC2 = i.reg.rt;
-      _subregOperand = _gpr[i.reg.rt];
       _decodedDST = i.reg.rt;
       _writeREG = TRUE;
       _writeFREG = FALSE;
       _hiWPort = FALSE;
       _loWPort = FALSE;
       _memControl = TRUE;
-      is_subreg = TRUE;
+      _isSubreg = TRUE;
       break;
 
    case 0x23: // lw
       _opControl = func_lw;
       _memOp = mem_lw;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -563,24 +583,25 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x26: // lwr
       _opControl = func_lwr;
       _memOp = mem_lwr;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _regSRC2 = i.reg.rt;
-      _subregOperand = _gpr[i.reg.rt];
       _decodedDST = i.reg.rt;
       _writeREG = TRUE;
       _writeFREG = FALSE;
       _hiWPort = FALSE;
       _loWPort = FALSE;
       _memControl = TRUE;
-      is_subreg = TRUE;
+      _isSubreg = TRUE;
       break;
 
    case 0x31: // lwc1
       _opControl = func_lwc1;
       _memOp = mem_lwc1;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -594,7 +615,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x39: // swc1
       _opControl = func_swc1;
       _memOp = mem_swc1;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -608,7 +630,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x28: // sb
       _opControl = func_sb;
       _memOp = mem_sb;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -622,7 +645,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x29: // sh  store half word
       _opControl = func_sh;
       _memOp = mem_sh;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -636,7 +660,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x2a: // swl
       _opControl = func_swl;
       _memOp = mem_swl;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -650,7 +675,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x2b: // sw
       _opControl = func_sw;
       _memOp = mem_sw;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -664,7 +690,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
    case 0x2e: // swr
       _opControl = func_swr;
       _memOp = mem_swr;
-      _decodedSRC1 = _gpr[i.reg.rs];
+      _src1Sel = DEC_SRC_GPR;
+      _src1Idx = i.reg.rs;
       _decodedSRC2 = i.imm.imm;
       _regSRC1 = i.reg.rs;
       _decodedDST = i.reg.rt;
@@ -676,13 +703,13 @@ void Mipc::Dec(unsigned int ins, Bool real)
       break;
 
    case 0x11: // floating-point
-      if (real)
-         _fpinst++; // y count 2 times ;]
+      _isFP = TRUE;
       switch (i.freg.fmt)
       {
       case 4: // mtc1
          _opControl = func_mtc1;
-         _decodedSRC1 = _gpr[i.freg.ft];
+         _src1Sel = DEC_SRC_GPR;
+         _src1Idx = i.freg.ft;
          _regSRC1 = i.freg.ft;
          _decodedDST = i.freg.fs;
          _writeREG = FALSE;
@@ -694,7 +721,8 @@ void Mipc::Dec(unsigned int ins, Bool real)
 
       case 0: // mfc1
          _opControl = func_mfc1;
-         _decodedSRC1 = _fpr[(i.freg.fs) >> 1].l[FP_TWIDDLE ^ ((i.freg.fs) & 1)];
+         _src1Sel = DEC_SRC_FPR;
+         _src1Idx = i.freg.fs;
          _regSRC1 = i.freg.ft;
          _decodedDST = i.freg.ft;
          _writeREG = TRUE;
@@ -724,28 +752,100 @@ void Mipc::Dec(unsigned int ins, Bool real)
       break;
    }
 
-   IF_ID_NXT._decodedSRC1 = _decodedSRC1;
-   IF_ID_NXT._decodedSRC2 = _decodedSRC2; // Reg fetch output (source values)
-   IF_ID_NXT._regSRC1 = _regSRC1;
-   IF_ID_NXT._regSRC2 = _regSRC2;
-   IF_ID_NXT._requiresFP = _requiresFP;
-   IF_ID_NXT._hiWrite = _hiWrite;
-   IF_ID_NXT._loWrite = _loWrite;
-   IF_ID_NXT._decodedDST = _decodedDST;       // Decoder output (dest reg no)
-   IF_ID_NXT._subregOperand = _subregOperand; // Needed for lwl and lwr
-   IF_ID_NXT._memControl = _memControl;       // Memory instruction?
-   IF_ID_NXT._writeREG = _writeREG;
-   IF_ID_NXT._writeFREG = _writeFREG; // WB control
-   IF_ID_NXT._branchOffset = _branchOffset;
-   IF_ID_NXT._hiWPort = _hiWPort;
-   IF_ID_NXT._loWPort = _loWPort;                 // WB control
-   IF_ID_NXT._decodedShiftAmt = _decodedShiftAmt; // Shift amount
-   IF_ID_NXT._bdslot = _bdslot;                   // 1 if the next ins is delay slot
-   IF_ID_NXT._btgt = _btgt;                       // branch target
-   IF_ID_NXT._isSyscall = _isSyscall;             // 1 if system call
-   IF_ID_NXT._isIllegalOp = _isIllegalOp;         // 1 if illegal opcode
-   IF_ID_NXT._opControl = _opControl;
-   IF_ID_NXT._memOp = _memOp;
+   d->_decodedSRC1 = _decodedSRC1;
+   d->_decodedSRC2 = _decodedSRC2; // Reg fetch output (source values)
+   d->_regSRC1 = _regSRC1;
+   d->_regSRC2 = _regSRC2;
+   d->_requiresFP = _requiresFP;
+   d->_hiWrite = _hiWrite;
+   d->_loWrite = _loWrite;
+   d->_decodedDST = _decodedDST;       // Decoder output (dest reg no)
+   d->_memControl = _memControl;       // Memory instruction?
+   d->_writeREG = _writeREG;
+   d->_writeFREG = _writeFREG; // WB control
+   d->_branchOffset = _branchOffset;
+   d->_hiWPort = _hiWPort;
+   d->_loWPort = _loWPort;                 // WB control
+   d->_decodedShiftAmt = _decodedShiftAmt; // Shift amount
+   d->_bdslot = _bdslot;                   // 1 if the next ins is delay slot
+   d->_btgt = _btgt;                       // branch target
+   d->_isSyscall = _isSyscall;             // 1 if system call
+   d->_isIllegalOp = _isIllegalOp;         // 1 if illegal opcode
+   d->_opControl = _opControl;
+   d->_memOp = _memOp;
+   d->_src1Sel = _src1Sel;
+   d->_src2Sel = _src2Sel;
+   d->_src1Idx = _src1Idx;
+   d->_src2Idx = _src2Idx;
+   d->_isSubreg = _isSubreg;
+   d->_jumpReg = _jumpReg;
+   d->_isFP = _isFP;
+   d->_pc = pc;
+   d->_ins = ins;
+   d->_valid = TRUE;
+}
+
+/*
+ * Called twice per instruction: once for hazard checks (real=FALSE), once
+ * for the register read (real=TRUE).  The static decode comes from the
+ * decode cache, keyed by PC and checked against the fetched instruction
+ * word, so only the operand values are read here on a hit.
+ */
+void Mipc::Dec(unsigned int ins, Bool real)
+{
+   DecodedIns *d;
+   unsigned int pc = IF_ID_NXT->_pc;
+
+   d = &_dcache[(pc >> 2) & _dcacheMask];
+   _dcache_lookups++;
+   if (!d->_valid || d->_pc != pc || d->_ins != ins)
+   {
+      DecodeStatic(pc, ins, d);
+      _dcache_misses++;
+   }
+   if (real && d->_isFP)
+      _fpinst++;
+
+   // Register fetch
+   switch (d->_src1Sel)
+   {
+   case DEC_SRC_GPR:
+      IF_ID_NXT->_decodedSRC1 = _gpr[d->_src1Idx];
+      break;
+   case DEC_SRC_FPR:
+      IF_ID_NXT->_decodedSRC1 = _fpr[(d->_src1Idx) >> 1].l[FP_TWIDDLE ^ ((d->_src1Idx) & 1)];
+      break;
+   default:
+      IF_ID_NXT->_decodedSRC1 = d->_decodedSRC1;
+      break;
+   }
+   if (d->_src2Sel == DEC_SRC_GPR)
+      IF_ID_NXT->_decodedSRC2 = _gpr[d->_src2Idx];
+   else
+      IF_ID_NXT->_decodedSRC2 = d->_decodedSRC2;
+
+   IF_ID_NXT->_subregOperand = d->_isSubreg ? _gpr[d->_regSRC2] : 0; // Needed for lwl and lwr
+   IF_ID_NXT->_btgt = d->_jumpReg ? (unsigned)IF_ID_NXT->_decodedSRC1 : d->_btgt;
+   is_subreg = d->_isSubreg;
+
+   IF_ID_NXT->_regSRC1 = d->_regSRC1;
+   IF_ID_NXT->_regSRC2 = d->_regSRC2;
+   IF_ID_NXT->_requiresFP = d->_requiresFP;
+   IF_ID_NXT->_hiWrite = d->_hiWrite;
+   IF_ID_NXT->_loWrite = d->_loWrite;
+   IF_ID_NXT->_decodedDST = d->_decodedDST;
+   IF_ID_NXT->_memControl = d->_memControl;
+   IF_ID_NXT->_writeREG = d->_writeREG;
+   IF_ID_NXT->_writeFREG = d->_writeFREG;
+   IF_ID_NXT->_branchOffset = d->_branchOffset;
+   IF_ID_NXT->_hiWPort = d->_hiWPort;
+   IF_ID_NXT->_loWPort = d->_loWPort;
+   IF_ID_NXT->_decodedShiftAmt = d->_decodedShiftAmt;
+   IF_ID_NXT->_bdslot = d->_bdslot;
+   IF_ID_NXT->_isSyscall = d->_isSyscall;
+   IF_ID_NXT->_isIllegalOp = d->_isIllegalOp;
+   IF_ID_NXT->_opControl = d->_opControl;
+   IF_ID_NXT->_memOp = d->_memOp;
 }
 
 /*
@@ -765,13 +865,13 @@ void Mipc::dumpregs(void)
       else
          printf("r%d: %08x (%ld)\n", i, _gpr[i], _gpr[i]);
    }
-   printf("taken: %d, bd: %d\n", MEM_WB_NXT._btaken, MEM_WB_NXT._bdslot);
-   printf("target: %08x\n", MEM_WB_NXT._btgt);
+   printf("taken: %d, bd: %d\n", MEM_WB_NXT->_btaken, MEM_WB_NXT->_bdslot);
+   printf("target: %08x\n", MEM_WB_NXT->_btgt);
 }
 
 void Mipc::func_add_addu(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2;
    // printf("Encountered unimplemented instruction: add or addu.\n");
    // printf("You need to fill in func_add_addu in exec_helper.cc to proceed forward.\n");
    // exit(0);
@@ -779,28 +879,28 @@ void Mipc::func_add_addu(Mipc *mc, unsigned ins)
 
 void Mipc::func_and(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 & mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 & mc->ID_EX_NXT->_decodedSRC2;
 }
 
 void Mipc::func_nor(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = ~(mc->ID_EX_NXT._decodedSRC1 | mc->ID_EX_NXT._decodedSRC2);
+   mc->ID_EX_NXT->_opResultLo = ~(mc->ID_EX_NXT->_decodedSRC1 | mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_or(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 | mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 | mc->ID_EX_NXT->_decodedSRC2;
 }
 
 void Mipc::func_sll(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC2 << mc->ID_EX_NXT._decodedShiftAmt;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC2 << mc->ID_EX_NXT->_decodedShiftAmt;
 }
 
 void Mipc::func_sllv(Mipc *mc, unsigned ins)
 {
 
-   mc->ID_EX_NXT._opResultLo = (unsigned)mc->ID_EX_NXT._decodedSRC2 << (mc->ID_EX_NXT._decodedSRC1 & 0x1f);
+   mc->ID_EX_NXT->_opResultLo = (unsigned)mc->ID_EX_NXT->_decodedSRC2 << (mc->ID_EX_NXT->_decodedSRC1 & 0x1f);
    // printf("Encountered unimplemented instruction: sllv.\n");
    // printf("You need to fill in func_sllv in exec_helper.cc to proceed forward.\n");
    // exit(0);
@@ -808,209 +908,123 @@ void Mipc::func_sllv(Mipc *mc, unsigned ins)
 
 void Mipc::func_slt(Mipc *mc, unsigned ins)
 {
-   if (mc->ID_EX_NXT._decodedSRC1 < mc->ID_EX_NXT._decodedSRC2)
+   if (mc->ID_EX_NXT->_decodedSRC1 < mc->ID_EX_NXT->_decodedSRC2)
    {
-      mc->ID_EX_NXT._opResultLo = 1;
+      mc->ID_EX_NXT->_opResultLo = 1;
    }
    else
    {
-      mc->ID_EX_NXT._opResultLo = 0;
+      mc->ID_EX_NXT->_opResultLo = 0;
    }
 }
 
 void Mipc::func_sltu(Mipc *mc, unsigned ins)
 {
-   if ((unsigned)mc->ID_EX_NXT._decodedSRC1 < (unsigned)mc->ID_EX_NXT._decodedSRC2)
+   if ((unsigned)mc->ID_EX_NXT->_decodedSRC1 < (unsigned)mc->ID_EX_NXT->_decodedSRC2)
    {
-      mc->ID_EX_NXT._opResultLo = 1;
+      mc->ID_EX_NXT->_opResultLo = 1;
    }
    else
    {
-      mc->ID_EX_NXT._opResultLo = 0;
+      mc->ID_EX_NXT->_opResultLo = 0;
    }
 }
 
 void Mipc::func_sra(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC2 >> mc->ID_EX_NXT._decodedShiftAmt;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC2 >> mc->ID_EX_NXT->_decodedShiftAmt;
 }
 
 void Mipc::func_srav(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC2 >> (mc->ID_EX_NXT._decodedSRC1 & 0x1f);
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC2 >> (mc->ID_EX_NXT->_decodedSRC1 & 0x1f);
 }
 
 void Mipc::func_srl(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = (unsigned)mc->ID_EX_NXT._decodedSRC2 >> mc->ID_EX_NXT._decodedShiftAmt;
+   mc->ID_EX_NXT->_opResultLo = (unsigned)mc->ID_EX_NXT->_decodedSRC2 >> mc->ID_EX_NXT->_decodedShiftAmt;
 }
 
 void Mipc::func_srlv(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = (unsigned)mc->ID_EX_NXT._decodedSRC2 >> (mc->ID_EX_NXT._decodedSRC1 & 0x1f);
+   mc->ID_EX_NXT->_opResultLo = (unsigned)mc->ID_EX_NXT->_decodedSRC2 >> (mc->ID_EX_NXT->_decodedSRC1 & 0x1f);
 }
 
 void Mipc::func_sub_subu(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = (unsigned)mc->ID_EX_NXT._decodedSRC1 - (unsigned)mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = (unsigned)mc->ID_EX_NXT->_decodedSRC1 - (unsigned)mc->ID_EX_NXT->_decodedSRC2;
 }
 
 void Mipc::func_xor(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 ^ mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 ^ mc->ID_EX_NXT->_decodedSRC2;
 }
 
 void Mipc::func_div(Mipc *mc, unsigned ins)
 {
-   if (mc->ID_EX_NXT._decodedSRC2 != 0)
-   {
-      mc->ID_EX_NXT._opResultHi = (unsigned)(mc->ID_EX_NXT._decodedSRC1 % mc->ID_EX_NXT._decodedSRC2);
-      mc->ID_EX_NXT._opResultLo = (unsigned)(mc->ID_EX_NXT._decodedSRC1 / mc->ID_EX_NXT._decodedSRC2);
-   }
-   else
-   {
-      mc->ID_EX_NXT._opResultHi = 0x7fffffff;
-      mc->ID_EX_NXT._opResultLo = 0x7fffffff;
-   }
+   ISA_DIV(mc->ID_EX_NXT->_opResultHi, mc->ID_EX_NXT->_opResultLo,
+           mc->ID_EX_NXT->_decodedSRC1, mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_divu(Mipc *mc, unsigned ins)
 {
-   if ((unsigned)mc->ID_EX_NXT._decodedSRC2 != 0)
-   {
-      mc->ID_EX_NXT._opResultHi = (unsigned)(mc->ID_EX_NXT._decodedSRC1) % (unsigned)(mc->ID_EX_NXT._decodedSRC2);
-      mc->ID_EX_NXT._opResultLo = (unsigned)(mc->ID_EX_NXT._decodedSRC1) / (unsigned)(mc->ID_EX_NXT._decodedSRC2);
-   }
-   else
-   {
-      mc->ID_EX_NXT._opResultHi = 0x7fffffff;
-      mc->ID_EX_NXT._opResultLo = 0x7fffffff;
-   }
+   ISA_DIVU(mc->ID_EX_NXT->_opResultHi, mc->ID_EX_NXT->_opResultLo,
+            mc->ID_EX_NXT->_decodedSRC1, mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_mfhi(Mipc *mc, unsigned ins)
 {
-#ifdef BYPASS_ENABLED
-   if (mc->ID_EX_NXT._bypSRC1 == BYPASS_EX_EX)
-   {
-      mc->ID_EX_NXT._opResultLo = mc->EX_MEM_NXTUR._opResultHi;
-   }
-#ifdef BYPASS_MEM_EX_ENABLED
-   else if (mc->ID_EX_NXT._bypSRC1 == BYPASS_MEM_EX)
-   {
-      mc->ID_EX_NXT._opResultLo = mc->MEM_WB_CUR._opResultHi;
-   }
-#endif
+   unsigned byp = mc->ID_EX_NXT->_bypSRC1;
+
+   if (byp == BYPASS_EX_EX || byp == BYPASS_MEM_EX)
+      mc->ID_EX_NXT->_opResultLo = mc->BypassLatch(byp)[mc->ID_EX_NXT->_bypSlot1]._opResultHi;
    else
-   {
-      mc->ID_EX_NXT._opResultLo = mc->_hi;
-   }
-#else
-   mc->ID_EX_NXT._opResultLo = mc->_hi;
-#endif
+      mc->ID_EX_NXT->_opResultLo = mc->_hi;
 }
 
 void Mipc::func_mflo(Mipc *mc, unsigned ins)
 {
-#ifdef BYPASS_ENABLED
-   if (mc->ID_EX_NXT._bypSRC1 == BYPASS_EX_EX)
-   {
-      mc->ID_EX_NXT._opResultLo = mc->EX_MEM_CUR._opResultLo;
-   }
-#ifdef BYPASS_MEM_EX_ENABLED
-   else if (mc->ID_EX_NXT._bypSRC1 == BYPASS_MEM_EX)
-   {
-      mc->ID_EX_NXT._opResultLo = mc->MEM_WB_CUR._opResultLo;
-   }
-#endif
-else
-{
-   mc->ID_EX_NXT._opResultLo = mc->_lo;
-}
-#else
-   mc->ID_EX_NXT._opResultLo = mc->_lo;
-#endif
+   unsigned byp = mc->ID_EX_NXT->_bypSRC1;
+
+   if (byp == BYPASS_EX_EX || byp == BYPASS_MEM_EX)
+      mc->ID_EX_NXT->_opResultLo = mc->BypassLatch(byp)[mc->ID_EX_NXT->_bypSlot1]._opResultLo;
+   else
+      mc->ID_EX_NXT->_opResultLo = mc->_lo;
 }
 
 void Mipc::func_mthi(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultHi = mc->ID_EX_NXT._decodedSRC1;
+   mc->ID_EX_NXT->_opResultHi = mc->ID_EX_NXT->_decodedSRC1;
 }
 
 void Mipc::func_mtlo(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1;
 }
 
 void Mipc::func_mult(Mipc *mc, unsigned ins)
 {
-   unsigned int ar1, ar2, s1, s2, r1, r2, t1, t2;
-
-   ar1 = mc->ID_EX_NXT._decodedSRC1;
-   ar2 = mc->ID_EX_NXT._decodedSRC2;
-   s1 = ar1 >> 31;
-   if (s1)
-      ar1 = 0x7fffffff & (~ar1 + 1);
-   s2 = ar2 >> 31;
-   if (s2)
-      ar2 = 0x7fffffff & (~ar2 + 1);
-
-   t1 = (ar1 & 0xffff) * (ar2 & 0xffff);
-   r1 = t1 & 0xffff; // bottom 16 bits
-
-   // compute next set of 16 bits
-   t1 = (ar1 & 0xffff) * (ar2 >> 16) + (t1 >> 16);
-   t2 = (ar2 & 0xffff) * (ar1 >> 16);
-
-   r1 = r1 | (((t1 + t2) & 0xffff) << 16); // bottom 32 bits
-   r2 = (ar1 >> 16) * (ar2 >> 16) + (t1 >> 16) + (t2 >> 16) +
-        (((t1 & 0xffff) + (t2 & 0xffff)) >> 16);
-
-   if (s1 ^ s2)
-   {
-      r1 = ~r1;
-      r2 = ~r2;
-      r1++;
-      if (r1 == 0)
-         r2++;
-   }
-   mc->ID_EX_NXT._opResultHi = r2;
-   mc->ID_EX_NXT._opResultLo = r1;
+   ISA_MULT(mc->ID_EX_NXT->_opResultHi, mc->ID_EX_NXT->_opResultLo,
+            mc->ID_EX_NXT->_decodedSRC1, mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_multu(Mipc *mc, unsigned ins)
 {
-   unsigned int ar1, ar2, s1, s2, r1, r2, t1, t2;
-
-   ar1 = mc->ID_EX_NXT._decodedSRC1;
-   ar2 = mc->ID_EX_NXT._decodedSRC2;
-
-   t1 = (ar1 & 0xffff) * (ar2 & 0xffff);
-   r1 = t1 & 0xffff; // bottom 16 bits
-
-   // compute next set of 16 bits
-   t1 = (ar1 & 0xffff) * (ar2 >> 16) + (t1 >> 16);
-   t2 = (ar2 & 0xffff) * (ar1 >> 16);
-
-   r1 = r1 | (((t1 + t2) & 0xffff) << 16); // bottom 32 bits
-   r2 = (ar1 >> 16) * (ar2 >> 16) + (t1 >> 16) + (t2 >> 16) +
-        (((t1 & 0xffff) + (t2 & 0xffff)) >> 16);
-
-   mc->ID_EX_NXT._opResultHi = r2;
-   mc->ID_EX_NXT._opResultLo = r1;
+   ISA_MULTU(mc->ID_EX_NXT->_opResultHi, mc->ID_EX_NXT->_opResultLo,
+             mc->ID_EX_NXT->_decodedSRC1, mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_jalr(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._btaken = 1;
+   mc->ID_EX_NXT->_btaken = 1;
    mc->_num_jal++;
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._pc + 8;
-   mc->ID_EX_NXT._btgt = mc->ID_EX_NXT._decodedSRC1;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_pc + 8;
+   mc->ID_EX_NXT->_btgt = mc->ID_EX_NXT->_decodedSRC1;
 }
 
 void Mipc::func_jr(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._btaken = 1;
+   mc->ID_EX_NXT->_btaken = 1;
    mc->_num_jr++;
 }
 
@@ -1026,8 +1040,8 @@ void Mipc::func_syscall(Mipc *mc, unsigned ins)
 void Mipc::func_addi_addiu(Mipc *mc, unsigned ins)
 {
    // rt = rs + immediate
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._opResultLo = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_opResultLo = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 
    // printf("Encountered unimplemented instruction: addi or addiu.\n");
    // printf("You need to fill in func_addi_addiu in exec_helper.cc to proceed forward.\n");
@@ -1036,12 +1050,12 @@ void Mipc::func_addi_addiu(Mipc *mc, unsigned ins)
 
 void Mipc::func_andi(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 & mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 & mc->ID_EX_NXT->_decodedSRC2;
 }
 
 void Mipc::func_lui(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC2 << 16;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC2 << 16;
    // printf("Encountered unimplemented instruction: lui.\n");
    // printf("You need to fill in func_lui in exec_helper.cc to proceed forward.\n");
    // exit(0);
@@ -1049,7 +1063,7 @@ void Mipc::func_lui(Mipc *mc, unsigned ins)
 
 void Mipc::func_ori(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 | mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 | mc->ID_EX_NXT->_decodedSRC2;
    // printf("Encountered unimplemented instruction: ori.\n");
    // printf("You need to fill in func_ori in exec_helper.cc to proceed forward.\n");
    // exit(0);
@@ -1057,39 +1071,39 @@ void Mipc::func_ori(Mipc *mc, unsigned ins)
 
 void Mipc::func_slti(Mipc *mc, unsigned ins)
 {
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   if (mc->ID_EX_NXT._decodedSRC1 < mc->ID_EX_NXT._decodedSRC2)
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   if (mc->ID_EX_NXT->_decodedSRC1 < mc->ID_EX_NXT->_decodedSRC2)
    {
-      mc->ID_EX_NXT._opResultLo = 1;
+      mc->ID_EX_NXT->_opResultLo = 1;
    }
    else
    {
-      mc->ID_EX_NXT._opResultLo = 0;
+      mc->ID_EX_NXT->_opResultLo = 0;
    }
 }
 
 void Mipc::func_sltiu(Mipc *mc, unsigned ins)
 {
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   if ((unsigned)mc->ID_EX_NXT._decodedSRC1 < (unsigned)mc->ID_EX_NXT._decodedSRC2)
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   if ((unsigned)mc->ID_EX_NXT->_decodedSRC1 < (unsigned)mc->ID_EX_NXT->_decodedSRC2)
    {
-      mc->ID_EX_NXT._opResultLo = 1;
+      mc->ID_EX_NXT->_opResultLo = 1;
    }
    else
    {
-      mc->ID_EX_NXT._opResultLo = 0;
+      mc->ID_EX_NXT->_opResultLo = 0;
    }
 }
 
 void Mipc::func_xori(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1 ^ mc->ID_EX_NXT._decodedSRC2;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1 ^ mc->ID_EX_NXT->_decodedSRC2;
 }
 
 void Mipc::func_beq(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = (mc->ID_EX_NXT._decodedSRC1 == mc->ID_EX_NXT._decodedSRC2);
+   mc->ID_EX_NXT->_btaken = (mc->ID_EX_NXT->_decodedSRC1 == mc->ID_EX_NXT->_decodedSRC2);
    // printf("Encountered unimplemented instruction: beq.\n");
    // printf("You need to fill in func_beq in exec_helper.cc to proceed forward.\n");
    // exit(0);
@@ -1098,57 +1112,57 @@ void Mipc::func_beq(Mipc *mc, unsigned ins)
 void Mipc::func_bgez(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = !(mc->ID_EX_NXT._decodedSRC1 >> 31);
+   mc->ID_EX_NXT->_btaken = !(mc->ID_EX_NXT->_decodedSRC1 >> 31);
 }
 
 void Mipc::func_bgezal(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = !(mc->ID_EX_NXT._decodedSRC1 >> 31);
-   mc->ID_EX_NXT._opResultLo = mc->_pc + 8;
+   mc->ID_EX_NXT->_btaken = !(mc->ID_EX_NXT->_decodedSRC1 >> 31);
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_pc + 8;
 }
 
 void Mipc::func_bltzal(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = (mc->ID_EX_NXT._decodedSRC1 >> 31);
-   mc->ID_EX_NXT._opResultLo = mc->_pc + 8;
+   mc->ID_EX_NXT->_btaken = (mc->ID_EX_NXT->_decodedSRC1 >> 31);
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_pc + 8;
 }
 
 void Mipc::func_bltz(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = (mc->ID_EX_NXT._decodedSRC1 >> 31);
+   mc->ID_EX_NXT->_btaken = (mc->ID_EX_NXT->_decodedSRC1 >> 31);
 }
 
 void Mipc::func_bgtz(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = (mc->ID_EX_NXT._decodedSRC1 > 0);
+   mc->ID_EX_NXT->_btaken = (mc->ID_EX_NXT->_decodedSRC1 > 0);
 }
 
 void Mipc::func_blez(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = (mc->ID_EX_NXT._decodedSRC1 <= 0);
+   mc->ID_EX_NXT->_btaken = (mc->ID_EX_NXT->_decodedSRC1 <= 0);
 }
 
 void Mipc::func_bne(Mipc *mc, unsigned ins)
 {
    mc->_num_cond_br++;
-   mc->ID_EX_NXT._btaken = (mc->ID_EX_NXT._decodedSRC1 != mc->ID_EX_NXT._decodedSRC2);
+   mc->ID_EX_NXT->_btaken = (mc->ID_EX_NXT->_decodedSRC1 != mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_j(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._btaken = 1;
+   mc->ID_EX_NXT->_btaken = 1;
 }
 
 void Mipc::func_jal(Mipc *mc, unsigned ins)
 {
    mc->_num_jal++;
-   mc->ID_EX_NXT._opResultLo = mc->_pc + 8;
-   mc->ID_EX_NXT._btaken = 1;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_pc + 8;
+   mc->ID_EX_NXT->_btaken = 1;
    // printf("Encountered unimplemented instruction: jal.\n");
    // printf("You need to fill in func_jal in exec_helper.cc to proceed forward.\n");
    // exit(0);
@@ -1159,15 +1173,15 @@ void Mipc::func_lb(Mipc *mc, unsigned ins)
    signed int a1;
 
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_lbu(Mipc *mc, unsigned ins)
 {
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_lh(Mipc *mc, unsigned ins)
@@ -1175,15 +1189,15 @@ void Mipc::func_lh(Mipc *mc, unsigned ins)
    signed int a1;
 
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_lhu(Mipc *mc, unsigned ins)
 {
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_lwl(Mipc *mc, unsigned ins)
@@ -1192,15 +1206,15 @@ void Mipc::func_lwl(Mipc *mc, unsigned ins)
    unsigned s1;
 
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_lw(Mipc *mc, unsigned ins)
 {
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 
    // printf("Encountered unimplemented instruction: lw.\n");
    // printf("You need to fill in func_lw in exec_helper.cc to proceed forward.\n");
@@ -1212,36 +1226,36 @@ void Mipc::func_lwr(Mipc *mc, unsigned ins)
    unsigned ar1, s1;
 
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_lwc1(Mipc *mc, unsigned ins)
 {
    mc->_num_load++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_swc1(Mipc *mc, unsigned ins)
 {
    mc->_num_store++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_sb(Mipc *mc, unsigned ins)
 {
    mc->_num_store++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_sh(Mipc *mc, unsigned ins)
 {
    mc->_num_store++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_swl(Mipc *mc, unsigned ins)
@@ -1249,15 +1263,15 @@ void Mipc::func_swl(Mipc *mc, unsigned ins)
    unsigned ar1, s1;
 
    mc->_num_store++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_sw(Mipc *mc, unsigned ins)
 {
    mc->_num_store++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_swr(Mipc *mc, unsigned ins)
@@ -1265,115 +1279,94 @@ void Mipc::func_swr(Mipc *mc, unsigned ins)
    unsigned ar1, s1;
 
    mc->_num_store++;
-   SIGN_EXTEND_IMM(mc->ID_EX_NXT._decodedSRC2);
-   mc->ID_EX_NXT._memory_addr_reg = (unsigned)(mc->ID_EX_NXT._decodedSRC1 + mc->ID_EX_NXT._decodedSRC2);
+   SIGN_EXTEND_IMM(mc->ID_EX_NXT->_decodedSRC2);
+   mc->ID_EX_NXT->_memory_addr_reg = (unsigned)(mc->ID_EX_NXT->_decodedSRC1 + mc->ID_EX_NXT->_decodedSRC2);
 }
 
 void Mipc::func_mtc1(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1;
 }
 
 void Mipc::func_mfc1(Mipc *mc, unsigned ins)
 {
-   mc->ID_EX_NXT._opResultLo = mc->ID_EX_NXT._decodedSRC1;
+   mc->ID_EX_NXT->_opResultLo = mc->ID_EX_NXT->_decodedSRC1;
 }
 
 void Mipc::mem_lb(Mipc *mc)
 {
-   signed int a1;
-
-   a1 = mc->_mem->BEGetByte(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
-   SIGN_EXTEND_BYTE(a1);
-   mc->EX_MEM_NXT._opResultLo = a1;
+   mc->EX_MEM_NXT->_opResultLo = ISA_LB(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_lbu(Mipc *mc)
 {
-   mc->EX_MEM_NXT._opResultLo = mc->_mem->BEGetByte(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
+   mc->EX_MEM_NXT->_opResultLo = ISA_LBU(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_lh(Mipc *mc)
 {
-   signed int a1;
-
-   a1 = mc->_mem->BEGetHalfWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
-   SIGN_EXTEND_IMM(a1);
-   mc->EX_MEM_NXT._opResultLo = a1;
+   mc->EX_MEM_NXT->_opResultLo = ISA_LH(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_lhu(Mipc *mc)
 {
-   mc->EX_MEM_NXT._opResultLo = mc->_mem->BEGetHalfWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
+   mc->EX_MEM_NXT->_opResultLo = ISA_LHU(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_lwl(Mipc *mc)
 {
-   signed int a1;
-   unsigned s1;
-
-   mc->EX_MEM_NXT._subregOperand = mc->_gpr[mc->EX_MEM_NXT._regSRC2];
-   a1 = mc->_mem->BEGetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
-   s1 = (mc->EX_MEM_NXT._memory_addr_reg & 3) << 3;
-   mc->EX_MEM_NXT._opResultLo = (a1 << s1) | (mc->EX_MEM_NXT._subregOperand & ~(~0UL << s1));
+   mc->EX_MEM_NXT->_subregOperand = mc->_gpr[mc->EX_MEM_NXT->_regSRC2];
+   mc->EX_MEM_NXT->_opResultLo = ISA_LWL(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->EX_MEM_NXT->_subregOperand);
 }
 
 void Mipc::mem_lw(Mipc *mc)
 {
-   mc->EX_MEM_NXT._opResultLo = mc->_mem->BEGetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
+   mc->EX_MEM_NXT->_opResultLo = ISA_LW(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_lwr(Mipc *mc)
 {
-   unsigned ar1, s1;
-
-   mc->EX_MEM_NXT._subregOperand = mc->_gpr[mc->EX_MEM_NXT._regSRC2];
-   ar1 = mc->_mem->BEGetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
-   s1 = (~mc->EX_MEM_NXT._memory_addr_reg & 3) << 3;
-   mc->EX_MEM_NXT._opResultLo = (ar1 >> s1) | (mc->EX_MEM_NXT._subregOperand & ~(~(unsigned)0 >> s1));
+   mc->EX_MEM_NXT->_subregOperand = mc->_gpr[mc->EX_MEM_NXT->_regSRC2];
+   mc->EX_MEM_NXT->_opResultLo = ISA_LWR(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->EX_MEM_NXT->_subregOperand);
 }
 
 void Mipc::mem_lwc1(Mipc *mc)
 {
-   mc->EX_MEM_NXT._opResultLo = mc->_mem->BEGetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
+   mc->EX_MEM_NXT->_opResultLo = ISA_LW(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_swc1(Mipc *mc)
 {
-   mc->_mem->Write(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7, mc->_mem->BESetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7), mc->_fpr[mc->EX_MEM_NXT._decodedDST >> 1].l[FP_TWIDDLE ^ (mc->EX_MEM_NXT._decodedDST & 1)]));
+   ISA_SW(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->_fpr[mc->EX_MEM_NXT->_decodedDST >> 1].l[FP_TWIDDLE ^ (mc->EX_MEM_NXT->_decodedDST & 1)]);
+   mc->CodeStore(mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_sb(Mipc *mc)
 {
-   mc->_mem->Write(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7, mc->_mem->BESetByte(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7), mc->_gpr[mc->EX_MEM_NXT._decodedDST] & 0xff));
+   ISA_SB(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->_gpr[mc->EX_MEM_NXT->_decodedDST]);
+   mc->CodeStore(mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_sh(Mipc *mc)
 {
-   mc->_mem->Write(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7, mc->_mem->BESetHalfWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7), mc->_gpr[mc->EX_MEM_NXT._decodedDST] & 0xffff));
+   ISA_SH(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->_gpr[mc->EX_MEM_NXT->_decodedDST]);
+   mc->CodeStore(mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_swl(Mipc *mc)
 {
-   unsigned ar1, s1;
-
-   ar1 = mc->_mem->BEGetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
-   s1 = (mc->EX_MEM_NXT._memory_addr_reg & 3) << 3;
-   ar1 = (mc->_gpr[mc->EX_MEM_NXT._decodedDST] >> s1) | (ar1 & ~(~(unsigned)0 >> s1));
-   mc->_mem->Write(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7, mc->_mem->BESetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7), ar1));
+   ISA_SWL(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->_gpr[mc->EX_MEM_NXT->_decodedDST]);
+   mc->CodeStore(mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_sw(Mipc *mc)
 {
-   mc->_mem->Write(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7, mc->_mem->BESetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7), mc->_gpr[mc->EX_MEM_NXT._decodedDST]));
+   ISA_SW(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->_gpr[mc->EX_MEM_NXT->_decodedDST]);
+   mc->CodeStore(mc->EX_MEM_NXT->_memory_addr_reg);
 }
 
 void Mipc::mem_swr(Mipc *mc)
 {
-   unsigned ar1, s1;
-
-   ar1 = mc->_mem->BEGetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7));
-   s1 = (~mc->EX_MEM_NXT._memory_addr_reg & 3) << 3;
-   ar1 = (mc->_gpr[mc->EX_MEM_NXT._decodedDST] << s1) | (ar1 & ~(~0UL << s1));
-   mc->_mem->Write(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7, mc->_mem->BESetWord(mc->EX_MEM_NXT._memory_addr_reg, mc->_mem->Read(mc->EX_MEM_NXT._memory_addr_reg & ~(LL)0x7), ar1));
+   ISA_SWR(mc->_mem, mc->EX_MEM_NXT->_memory_addr_reg, mc->_gpr[mc->EX_MEM_NXT->_decodedDST]);
+   mc->CodeStore(mc->EX_MEM_NXT->_memory_addr_reg);
 }
@@ -1,4 +1,6 @@
 #include "executor.h"
+#include "bpred.h"
+#include "trace.h"
 
 Exe::Exe(Mipc *mc)
 {
@@ -7,76 +9,121 @@ Exe::Exe(Mipc *mc)
 
 Exe::~Exe(void) {}
 
-#ifdef BYPASS_ENABLED
+/*
+ * Pick up operands forwarded from older instructions (see
+ * Decode::check_bypass).  mfhi/mflo take theirs in func_mfhi/func_mflo.
+ */
 void Exe::update_bypass(PipeReg &ID_EX_NXT)
 {
-   if (ID_EX_NXT._bypSRC1 == BYPASS_EX_EX)
-   {
-      ID_EX_NXT._decodedSRC1 = _mc->EX_MEM_CUR._opResultLo;
-   }
-#ifdef BYPASS_MEM_EX_ENABLED
-   else if (ID_EX_NXT._bypSRC1 == BYPASS_MEM_EX)
-   {
-      ID_EX_NXT._decodedSRC1 = _mc->MEM_WB_CUR._opResultLo;
-   }
-#endif
-   if (ID_EX_NXT._bypSRC2 == BYPASS_EX_EX)
-   {
-      ID_EX_NXT._decodedSRC2 = _mc->EX_MEM_CUR._opResultLo;
-   }
-#ifdef BYPASS_MEM_EX_ENABLED
-   else if (ID_EX_NXT._bypSRC2 == BYPASS_MEM_EX)
-   {
-      ID_EX_NXT._decodedSRC2 = _mc->MEM_WB_CUR._opResultLo;
-   }
-#endif
+   Bool hilo = ID_EX_NXT._hiWrite || ID_EX_NXT._loWrite;
+
+   _mc->_nbypass[ID_EX_NXT._bypSRC1]++;
+   _mc->_nbypass[ID_EX_NXT._bypSRC2]++;
+   if (!hilo && (ID_EX_NXT._bypSRC1 == BYPASS_EX_EX || ID_EX_NXT._bypSRC1 == BYPASS_MEM_EX))
+      ID_EX_NXT._decodedSRC1 = _mc->BypassLatch(ID_EX_NXT._bypSRC1)[ID_EX_NXT._bypSlot1]._opResultLo;
+   if (ID_EX_NXT._bypSRC2 == BYPASS_EX_EX || ID_EX_NXT._bypSRC2 == BYPASS_MEM_EX)
+      ID_EX_NXT._decodedSRC2 = _mc->BypassLatch(ID_EX_NXT._bypSRC2)[ID_EX_NXT._bypSlot2]._opResultLo;
+}
+
+/*
+ * Train the predictor with the outcome of a CTI and, if fetch went the
+ * wrong way after its delay slot, ask every stage to squash
+ */
+void Exe::resolve_branch(PipeReg &ID_EX_NXT)
+{
+   unsigned int npc = ID_EX_NXT._btaken ? ID_EX_NXT._btgt : ID_EX_NXT._pc + 8;
+
+   _mc->_bpred->Update(ID_EX_NXT._pc, ID_EX_NXT._ins, ID_EX_NXT._btaken, ID_EX_NXT._btgt, ID_EX_NXT._predHist);
+   if (npc == ID_EX_NXT._predNPC)
+      return;
+
+   _mc->_nmispred++;
+   _mc->_squashCycles += SIM_TIME - ID_EX_NXT._fetchCycle;
+   _mc->_squash = TRUE;
+   _mc->_squashSeq = ID_EX_NXT._seq + 1; // keep the delay slot
+   _mc->_redirectPC = npc;
 }
-#endif
 
 void Exe::MainLoop(void)
 {
    unsigned int ins;
-   Bool isSyscall, isIllegalOp;
+   int k, live;
 
    while (1)
    {
       AWAIT_P_PHI0; // @posedge
+      if (_mc->_memStall)
+      {
+         AWAIT_P_PHI1; // frozen behind a D-cache miss
+         continue;
+      }
 
-      _mc->ID_EX_NXT = _mc->ID_EX_CUR;
-      ins = _mc->ID_EX_NXT._ins;
-
-      if (!_mc->ID_EX_NXT._isSyscall && !_mc->ID_EX_NXT._isIllegalOp)
+      // results are written into the ID/EX bank itself, which becomes
+      // EX/MEM at negedge
+      _ex = _mc->ID_EX_CUR;
+      _mc->_squash = FALSE;
+      live = _mc->_issueWidth;
+      for (k = 0; k < _mc->_issueWidth; k++)
       {
-         if (_mc->ID_EX_NXT._opControl != NULL)
+         if (_ex[k]._isNOP)
+            continue;
+         if (_mc->_squash && _ex[k]._seq > _mc->_squashSeq)
          {
-#ifdef BYPASS_ENABLED
-            update_bypass(_mc->ID_EX_NXT);
-#endif
-            _mc->ID_EX_NXT._opControl(_mc, ins);
+            // younger than a mispredicted CTI's delay slot
+            TRACE_SQUASH(_mc, _ex[k]);
+            if (live > k)
+               live = k;
+            _mc->_nfetched--;
+            _mc->_nsquashed++;
+            continue;
          }
+         _mc->ID_EX_NXT = &_ex[k];
+         TRACE_STAGE(_ex[k], Ex);
+         ins = _ex[k]._ins;
+
+         if (!_ex[k]._isSyscall && !_ex[k]._isIllegalOp)
+         {
+            if (_ex[k]._opControl != NULL)
+            {
+               update_bypass(_ex[k]);
+               _ex[k]._opControl(_mc, ins);
+            }
 #ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> Executed ins %#x\n", SIM_TIME, ins);
+            fprintf(_mc->_debugLog, "<%llu> Executed ins %#x\n", SIM_TIME, ins);
 #endif
 
-         if (_mc->ID_EX_NXT._bdslot && _mc->ID_EX_NXT._btaken)
-         {
-            _mc->_pc = _mc->ID_EX_NXT._btgt;
+            if (_ex[k]._bdslot && _mc->_bpred)
+               resolve_branch(_ex[k]);
+            else if (_ex[k]._bdslot)
+            {
+               // branch resolved: fetch may go on past the delay slot,
+               // once it has fetched it (an I-cache miss can hold it up)
+               if (_mc->_fetchDelaySlot)
+               {
+                  _mc->_predNPC = _ex[k]._btaken ? _ex[k]._btgt : _ex[k]._pc + 8;
+                  _mc->_dsResolved = TRUE;
+               }
+               else if (_ex[k]._btaken)
+                  _mc->_pc = _ex[k]._btgt;
+               _mc->_branchInterlock = FALSE;
+            }
          }
-      }
-      else if (_mc->ID_EX_NXT._isSyscall)
-      {
+         else if (_ex[k]._isSyscall)
+         {
 #ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> Deferring execution of syscall ins %#x\n", SIM_TIME, ins);
+            fprintf(_mc->_debugLog, "<%llu> Deferring execution of syscall ins %#x\n", SIM_TIME, ins);
 #endif
-      }
-      else
-      {
+         }
+         else
+         {
 #ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> Illegal ins %#x in execution stage at PC %#x\n", SIM_TIME, ins, _mc->_pc);
+            fprintf(_mc->_debugLog, "<%llu> Illegal ins %#x in execution stage at PC %#x\n", SIM_TIME, ins, _mc->_pc);
 #endif
+         }
       }
 
-      AWAIT_P_PHI1; // @negedge -- copied to reg in negative cycle
-      _mc->EX_MEM_CUR = _mc->ID_EX_NXT;
+      AWAIT_P_PHI1; // @negedge -- squashed slots leave EX as bubbles
+      for (k = live; k < _mc->_issueWidth; k++)
+         _ex[k]._isNOP = TRUE;
    }
 }
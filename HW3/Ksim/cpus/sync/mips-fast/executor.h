@@ -10,11 +10,11 @@ class Exe : public SimObject
 public:
    Exe(Mipc *);
    ~Exe();
-#ifdef BYPASS_ENABLED
    void update_bypass(PipeReg &ID_EX_NXT);
-#endif
+   void resolve_branch(PipeReg &ID_EX_NXT);
    FAKE_SIM_TEMPLATE;
 
    Mipc *_mc;
+   PipeReg *_ex; // ID/EX bank being executed
 };
 #endif
@@ -0,0 +1,390 @@
+#include "mips.h"
+#include "opcodes.h"
+#include "bpred.h"
+#include "cache.h"
+#include "isa.h"
+
+/*------------------------------------------------------------------------
+ *
+ *  Functional (ISA-only) execution
+ *
+ *  Runs instructions directly on the architectural state (_gpr, _fpr,
+ *  _hi, _lo, _pc, _mem, _sys) with no pipeline latches, no hazard
+ *  checks and no clock.  Used to skip initialization phases before
+ *  handing off to the cycle-level pipeline.
+ *
+ *------------------------------------------------------------------------
+ */
+
+#define FF_FPR(r) (_fpr[(r) >> 1].l[FP_TWIDDLE ^ ((r) & 1)])
+
+/*
+ * Execute the instruction at "pc".  "npc" is the address that follows it
+ * (pc + 4, or a branch target when "pc" is a delay slot).  Both are
+ * advanced on return; returns FALSE, leaving them alone, on an illegal
+ * instruction.
+ */
+inline Bool Mipc::FuncExec(unsigned int &pc, unsigned int &npc)
+{
+   MipsInsn i;
+   unsigned int ins, addr, nnpc;
+   signed int a1;
+
+   ins = ISA_LW(_mem, pc);
+   i.data = ins;
+   nnpc = npc + 4;
+
+   switch (i.reg.op)
+   {
+   case 0: // SPECIAL
+      switch (i.reg.func)
+      {
+      case 0x20: // add
+      case 0x21: // addu
+         _gpr[i.reg.rd] = _gpr[i.reg.rs] + _gpr[i.reg.rt];
+         break;
+      case 0x24: // and
+         _gpr[i.reg.rd] = _gpr[i.reg.rs] & _gpr[i.reg.rt];
+         break;
+      case 0x27: // nor
+         _gpr[i.reg.rd] = ~(_gpr[i.reg.rs] | _gpr[i.reg.rt]);
+         break;
+      case 0x25: // or
+         _gpr[i.reg.rd] = _gpr[i.reg.rs] | _gpr[i.reg.rt];
+         break;
+      case 0: // sll
+         _gpr[i.reg.rd] = _gpr[i.reg.rt] << i.reg.sa;
+         break;
+      case 4: // sllv
+         _gpr[i.reg.rd] = _gpr[i.reg.rt] << (_gpr[i.reg.rs] & 0x1f);
+         break;
+      case 0x2a: // slt
+         _gpr[i.reg.rd] = ((signed int)_gpr[i.reg.rs] < (signed int)_gpr[i.reg.rt]);
+         break;
+      case 0x2b: // sltu
+         _gpr[i.reg.rd] = (_gpr[i.reg.rs] < _gpr[i.reg.rt]);
+         break;
+      case 0x3: // sra
+         _gpr[i.reg.rd] = (signed int)_gpr[i.reg.rt] >> i.reg.sa;
+         break;
+      case 0x7: // srav
+         _gpr[i.reg.rd] = (signed int)_gpr[i.reg.rt] >> (_gpr[i.reg.rs] & 0x1f);
+         break;
+      case 0x2: // srl
+         _gpr[i.reg.rd] = _gpr[i.reg.rt] >> i.reg.sa;
+         break;
+      case 0x6: // srlv
+         _gpr[i.reg.rd] = _gpr[i.reg.rt] >> (_gpr[i.reg.rs] & 0x1f);
+         break;
+      case 0x22: // sub
+      case 0x23: // subu
+         _gpr[i.reg.rd] = _gpr[i.reg.rs] - _gpr[i.reg.rt];
+         break;
+      case 0x26: // xor
+         _gpr[i.reg.rd] = _gpr[i.reg.rs] ^ _gpr[i.reg.rt];
+         break;
+      case 0x1a: // div
+         ISA_DIV(_hi, _lo, _gpr[i.reg.rs], _gpr[i.reg.rt]);
+         break;
+      case 0x1b: // divu
+         ISA_DIVU(_hi, _lo, _gpr[i.reg.rs], _gpr[i.reg.rt]);
+         break;
+      case 0x10: // mfhi
+         _gpr[i.reg.rd] = _hi;
+         break;
+      case 0x12: // mflo
+         _gpr[i.reg.rd] = _lo;
+         break;
+      case 0x11: // mthi
+         _hi = _gpr[i.reg.rs];
+         break;
+      case 0x13: // mtlo
+         _lo = _gpr[i.reg.rs];
+         break;
+      case 0x18: // mult
+         ISA_MULT(_hi, _lo, _gpr[i.reg.rs], _gpr[i.reg.rt]);
+         break;
+      case 0x19: // multu
+         ISA_MULTU(_hi, _lo, _gpr[i.reg.rs], _gpr[i.reg.rt]);
+         break;
+      case 9: // jalr
+         nnpc = _gpr[i.reg.rs];
+         _gpr[i.reg.rd] = pc + 8;
+         break;
+      case 8: // jr
+         nnpc = _gpr[i.reg.rs];
+         break;
+      case 0xd: // await/break
+         break;
+      case 0xc: // syscall
+         _pc = pc;
+         fake_syscall(ins);
+         break;
+      default:
+         return FALSE;
+      }
+      break;
+
+   case 8: // addi
+   case 9: // addiu
+      _gpr[i.imm.rt] = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      break;
+   case 0xc: // andi
+      _gpr[i.imm.rt] = _gpr[i.imm.rs] & i.imm.imm;
+      break;
+   case 0xf: // lui
+      _gpr[i.imm.rt] = i.imm.imm << 16;
+      break;
+   case 0xd: // ori
+      _gpr[i.imm.rt] = _gpr[i.imm.rs] | i.imm.imm;
+      break;
+   case 0xa: // slti
+      _gpr[i.imm.rt] = ((signed int)_gpr[i.imm.rs] < ISA_SEXT16(i.imm.imm));
+      break;
+   case 0xb: // sltiu
+      _gpr[i.imm.rt] = (_gpr[i.imm.rs] < (unsigned)ISA_SEXT16(i.imm.imm));
+      break;
+   case 0xe: // xori
+      _gpr[i.imm.rt] = _gpr[i.imm.rs] ^ i.imm.imm;
+      break;
+
+   case 4: // beq
+      if (_gpr[i.imm.rs] == _gpr[i.imm.rt])
+         nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+      break;
+   case 5: // bne
+      if (_gpr[i.imm.rs] != _gpr[i.imm.rt])
+         nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+      break;
+   case 7: // bgtz
+      if ((signed int)_gpr[i.imm.rs] > 0)
+         nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+      break;
+   case 6: // blez
+      if ((signed int)_gpr[i.imm.rs] <= 0)
+         nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+      break;
+   case 1: // REGIMM
+      a1 = (signed int)_gpr[i.imm.rs];
+      switch (i.imm.rt)
+      {
+      case 1: // bgez
+         if (a1 >= 0)
+            nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+         break;
+      case 0x11: // bgezal
+         _gpr[31] = pc + 8;
+         if (a1 >= 0)
+            nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+         break;
+      case 0x10: // bltzal
+         _gpr[31] = pc + 8;
+         if (a1 < 0)
+            nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+         break;
+      case 0: // bltz
+         if (a1 < 0)
+            nnpc = npc + (ISA_SEXT16(i.imm.imm) << 2);
+         break;
+      default:
+         return FALSE;
+      }
+      break;
+   case 2: // j
+      nnpc = (npc & 0xf0000000) | (i.tgt.tgt << 2);
+      break;
+   case 3: // jal
+      _gpr[31] = pc + 8;
+      nnpc = (npc & 0xf0000000) | (i.tgt.tgt << 2);
+      break;
+
+   case 0x20: // lb
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LB(_mem, addr);
+      break;
+   case 0x24: // lbu
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LBU(_mem, addr);
+      break;
+   case 0x21: // lh
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LH(_mem, addr);
+      break;
+   case 0x25: // lhu
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LHU(_mem, addr);
+      break;
+   case 0x22: // lwl
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LWL(_mem, addr, _gpr[i.imm.rt]);
+      break;
+   case 0x23: // lw
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LW(_mem, addr);
+      break;
+   case 0x26: // lwr
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      _gpr[i.imm.rt] = ISA_LWR(_mem, addr, _gpr[i.imm.rt]);
+      break;
+   case 0x31: // lwc1
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      FF_FPR(i.imm.rt) = ISA_LW(_mem, addr);
+      break;
+   case 0x39: // swc1
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      ISA_SW(_mem, addr, FF_FPR(i.imm.rt));
+      CodeStore(addr);
+      break;
+   case 0x28: // sb
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      ISA_SB(_mem, addr, _gpr[i.imm.rt]);
+      CodeStore(addr);
+      break;
+   case 0x29: // sh
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      ISA_SH(_mem, addr, _gpr[i.imm.rt]);
+      CodeStore(addr);
+      break;
+   case 0x2a: // swl
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      ISA_SWL(_mem, addr, _gpr[i.imm.rt]);
+      CodeStore(addr);
+      break;
+   case 0x2b: // sw
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      ISA_SW(_mem, addr, _gpr[i.imm.rt]);
+      CodeStore(addr);
+      break;
+   case 0x2e: // swr
+      addr = _gpr[i.imm.rs] + ISA_SEXT16(i.imm.imm);
+      ISA_SWR(_mem, addr, _gpr[i.imm.rt]);
+      CodeStore(addr);
+      break;
+
+   case 0x11: // floating-point
+      switch (i.freg.fmt)
+      {
+      case 4: // mtc1
+         FF_FPR(i.freg.fs) = _gpr[i.freg.ft];
+         break;
+      case 0: // mfc1
+         _gpr[i.freg.ft] = FF_FPR(i.freg.fs);
+         break;
+      default:
+         return FALSE;
+      }
+      break;
+
+   default:
+      return FALSE;
+   }
+
+   _gpr[0] = 0;
+   pc = npc;
+   npc = nnpc;
+   return TRUE;
+}
+
+/*
+ * Execute at most "ninsn" instructions (0 = no limit), stopping early
+ * when the next instruction to run is at "stopPC" (0 = none), when the
+ * program exits, or on an illegal instruction.  Only stops at an
+ * instruction boundary that is not a branch delay slot, so the pipeline
+ * can pick up from _pc with empty latches.  Returns the number of
+ * instructions executed.
+ */
+LL Mipc::FastForward(LL ninsn, unsigned int stopPC)
+{
+   unsigned int pc, npc;
+   LL count;
+
+   pc = _pc;
+   npc = pc + 4;
+   count = 0;
+
+   while (!_sim_exit)
+   {
+      // only hand off outside a delay slot
+      if (npc == pc + 4)
+      {
+         if (ninsn && count >= ninsn)
+            break;
+         if (stopPC && pc == stopPC)
+            break;
+      }
+
+      if (!FuncExec(pc, npc))
+      {
+         // leave the illegal instruction for the pipeline to report
+         if (npc != pc + 4)
+            printf("Fast-forward: illegal ins at PC %#x in a delay slot\n", pc);
+         break;
+      }
+      count++;
+   }
+
+   _pc = pc;
+   _nfastfwd += count;
+   return count;
+}
+
+/*
+ * FastForward between the samples of a sampled run (no stop PC): every
+ * instruction also goes through the L1I, loads and stores through the
+ * L1D, and CTIs train the branch predictor, so the next detailed window
+ * starts with warm structures.  The cache counters include these
+ * accesses.  Which instructions touch memory, and how, comes from the
+ * pipeline's own static decode (through the decode cache, which warms
+ * up on the way, but without counting in its statistics).
+ */
+LL Mipc::WarmForward(LL ninsn)
+{
+   DecodedIns *d;
+   unsigned int pc, npc, ins, cti;
+   LL count;
+
+   pc = _pc;
+   npc = pc + 4;
+   count = 0;
+
+   while (!_sim_exit)
+   {
+      if (npc == pc + 4 && count >= ninsn)
+         break;
+
+      ins = ISA_LW(_mem, pc);
+      d = &_dcache[(pc >> 2) & _dcacheMask];
+      if (!d->_valid || d->_pc != pc || d->_ins != ins)
+         DecodeStatic(pc, ins, d);
+      if (_l1i)
+      {
+         _l1i->Access(pc, FALSE, pc);
+         if (d->_memControl)
+            _l1d->Access(_gpr[d->_src1Idx] + ISA_SEXT16(d->_decodedSRC2),
+                         !d->_writeREG && !d->_writeFREG, pc); // store: writes no register
+      }
+
+      cti = pc;
+      if (!FuncExec(pc, npc))
+      {
+         if (npc != pc + 4)
+            printf("Fast-forward: illegal ins at PC %#x in a delay slot\n", pc);
+         break;
+      }
+      if (_bpred && IsCTI(ins))
+         _bpred->Update(cti, ins, npc != cti + 8, npc, _bpred->History()); // npc: after the delay slot
+      count++;
+   }
+
+   _pc = pc;
+   _nfastfwd += count;
+   return count;
+}
+
+/*
+ * Single step with an explicit pc/npc pair (used by the checker)
+ */
+Bool Mipc::StepOne(unsigned int &pc, unsigned int &npc)
+{
+   return FuncExec(pc, npc);
+}
@@ -0,0 +1,85 @@
+#ifndef __ISA_H__
+#define __ISA_H__
+
+/*
+ * Instruction semantics shared by the three ways Mipc executes code:
+ * the func_* and mem_* handlers of the pipeline (exec_helper.cc),
+ * FuncExec (fastfwd.cc) and the translated blocks (xlate.cc).  Each
+ * keeps its own operand plumbing; the memory accesses, sub-word merges
+ * and hi/lo arithmetic live here so that the three cannot drift apart.
+ * One-line ALU operations are left inline.
+ *
+ * "m" is the Mem, "a" an effective address, values are 32 bits.
+ * Stores do not call Mipc::CodeStore; the caller does.
+ */
+
+#define ISA_SEXT16(x) ((signed int)((unsigned)(x) << 16) >> 16)
+#define ISA_SEXT8(x) ((signed int)((unsigned)(x) << 24) >> 24)
+
+// the dword of Mem holding "a"
+#define ISA_READ(m, a) ((m)->Read((LL)(a) & ~(LL)0x7))
+#define ISA_WRITE(m, a, v) ((m)->Write((LL)(a) & ~(LL)0x7, (v)))
+
+// loads
+#define ISA_LB(m, a) ISA_SEXT8((m)->BEGetByte((a), ISA_READ(m, a)))
+#define ISA_LBU(m, a) ((unsigned)(m)->BEGetByte((a), ISA_READ(m, a)))
+#define ISA_LH(m, a) ISA_SEXT16((m)->BEGetHalfWord((a), ISA_READ(m, a)))
+#define ISA_LHU(m, a) ((unsigned)(m)->BEGetHalfWord((a), ISA_READ(m, a)))
+#define ISA_LW(m, a) ((unsigned)(m)->BEGetWord((a), ISA_READ(m, a)))
+
+// lwl/lwr merge memory into "old", the current value of rt
+#define ISA_LWL_SHIFT(a) (((a) & 3) << 3)
+#define ISA_LWR_SHIFT(a) ((~(a) & 3) << 3)
+#define ISA_LWL(m, a, old) \
+   ((ISA_LW(m, a) << ISA_LWL_SHIFT(a)) | ((unsigned)(old) & ~(~0U << ISA_LWL_SHIFT(a))))
+#define ISA_LWR(m, a, old) \
+   ((ISA_LW(m, a) >> ISA_LWR_SHIFT(a)) | ((unsigned)(old) & ~(~0U >> ISA_LWR_SHIFT(a))))
+
+// stores
+#define ISA_SB(m, a, v) ISA_WRITE(m, a, (m)->BESetByte((a), ISA_READ(m, a), (unsigned)(v) & 0xff))
+#define ISA_SH(m, a, v) ISA_WRITE(m, a, (m)->BESetHalfWord((a), ISA_READ(m, a), (unsigned)(v) & 0xffff))
+#define ISA_SW(m, a, v) ISA_WRITE(m, a, (m)->BESetWord((a), ISA_READ(m, a), (unsigned)(v)))
+#define ISA_SWL(m, a, v) \
+   ISA_SW(m, a, ((unsigned)(v) >> ISA_LWL_SHIFT(a)) | (ISA_LW(m, a) & ~(~0U >> ISA_LWL_SHIFT(a))))
+#define ISA_SWR(m, a, v) \
+   ISA_SW(m, a, ((unsigned)(v) << ISA_LWR_SHIFT(a)) | (ISA_LW(m, a) & ~(~0U << ISA_LWR_SHIFT(a))))
+
+// hi/lo; division by zero leaves 0x7fffffff in both
+#define ISA_MULT(hi, lo, x, y)                                                   \
+   do                                                                            \
+   {                                                                             \
+      long long _p = (long long)(signed int)(x) * (long long)(signed int)(y);    \
+      (hi) = (unsigned)((unsigned long long)_p >> 32);                           \
+      (lo) = (unsigned)_p;                                                       \
+   } while (0)
+#define ISA_MULTU(hi, lo, x, y)                                                  \
+   do                                                                            \
+   {                                                                             \
+      unsigned long long _p = (unsigned long long)(unsigned)(x) * (unsigned)(y); \
+      (hi) = (unsigned)(_p >> 32);                                               \
+      (lo) = (unsigned)_p;                                                       \
+   } while (0)
+#define ISA_DIV(hi, lo, x, y)                                   \
+   do                                                           \
+   {                                                            \
+      if ((signed int)(y) != 0)                                 \
+      {                                                         \
+         (hi) = (unsigned)((signed int)(x) % (signed int)(y));  \
+         (lo) = (unsigned)((signed int)(x) / (signed int)(y));  \
+      }                                                         \
+      else                                                      \
+         (hi) = (lo) = 0x7fffffff;                              \
+   } while (0)
+#define ISA_DIVU(hi, lo, x, y)                                  \
+   do                                                           \
+   {                                                            \
+      if ((unsigned)(y) != 0)                                   \
+      {                                                         \
+         (hi) = (unsigned)(x) % (unsigned)(y);                  \
+         (lo) = (unsigned)(x) / (unsigned)(y);                  \
+      }                                                         \
+      else                                                      \
+         (hi) = (lo) = 0x7fffffff;                              \
+   } while (0)
+
+#endif /* __ISA_H__ */
@@ -6,6 +6,7 @@
 #include "tasking.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 void cleanup(void)
 {
@@ -38,6 +39,7 @@ int main(int argc, char **argv)
    RegisterDefault("MemSystem.Type", "None");
    RegisterDefault("Log.StartDumpTime", 0);
    RegisterDefault("Mipc.PeriodicTimer", 100000);
+   Mipc::RegisterDefaults();
 
    /* fixup arguments */
    if (argc > 1)
@@ -87,6 +89,8 @@ int main(int argc, char **argv)
          fatal_error("Pathname `%s' too long!\n", argv[1]);
       }
       sprintf(buf, "%s.image", argv[1]);
+      if (access(buf, R_OK) != 0 && access(argv[1], R_OK) == 0)
+         sprintf(buf, "%s", argv[1]); // e.g. prog.ld, an executable Reboot loads directly
       OverrideConfig("Mipc.BootROM", buf);
       argc--;
       argv++;
@@ -108,6 +112,8 @@ int main(int argc, char **argv)
    exec = new Exe(processor_top);
    mem = new Memory(processor_top);
    wb = new Writeback(processor_top);
+   if (ParamGetString("Mipc.Restore")[0])
+      processor_top->RestoreCheckpoint(ParamGetString("Mipc.Restore"));
    SimCreateTask(processor_top, "FETCH");
    SimCreateTask(dec, "DECODE");
    SimCreateTask(exec, "EXE");
@@ -115,7 +121,7 @@ int main(int argc, char **argv)
    SimCreateTask(wb, "WB");
 
    /* there are arguments! */
-   if (argc > 0)
+   if (argc > 0 && !processor_top->_restored)
       processor_top->_sys->ArgumentSetup(argc, argv, ParamGetInt("Mipc.ArgvAddr"));
 
    simulate(cleanup);
@@ -1,39 +1,150 @@
 #include "memory.h"
+#include "cache.h"
+#include "trace.h"
+#include "checkpoint.h"
 
 Memory::Memory(Mipc *mc)
 {
+   int i;
+
    _mc = mc;
+   _mshr = NULL;
+   if (_mc->_nmshr > 0)
+   {
+      _mshr = new MSHR[_mc->_nmshr];
+      for (i = 0; i < _mc->_nmshr; i++)
+         _mshr[i]._ready = 0;
+   }
+   _mc->_stages[_mc->_nstages++] = this;
 }
 
 Memory::~Memory(void) {}
 
+void Memory::SaveState(FILE *fp)
+{
+   if (_mshr)
+      ckpt_io(fp, 1, _mshr, _mc->_nmshr * sizeof(MSHR));
+}
+
+void Memory::RestoreState(FILE *fp, UnCheckPoint *uc)
+{
+   if (_mshr)
+      ckpt_io(fp, 0, _mshr, _mc->_nmshr * sizeof(MSHR));
+}
+
+/*
+ * L1D timing for one memory instruction.  Without MSHRs a miss freezes
+ * the pipeline.  With them a miss (or a second access to a line already
+ * being filled) only marks a load's destination not ready until the
+ * fill completes; decode stalls its consumers.  A miss that finds every
+ * MSHR busy freezes the pipeline until the oldest fill is done, from
+ * the next cycle on (_stall).
+ */
+void Memory::dcache_access(PipeReg &EX_MEM_NXT)
+{
+   LL line, ready;
+   Bool store = !EX_MEM_NXT._writeREG && !EX_MEM_NXT._writeFREG;
+   int i, wait, slot;
+
+   if (!_mshr)
+   {
+      _mc->_memStall += _mc->_l1d->Access(EX_MEM_NXT._memory_addr_reg, store, EX_MEM_NXT._pc);
+      return;
+   }
+
+   line = _mc->_l1d->LineAddr(EX_MEM_NXT._memory_addr_reg);
+   slot = -1;
+   for (i = 0; i < _mc->_nmshr; i++)
+   {
+      if (_mshr[i]._ready > SIM_TIME && _mshr[i]._line == line)
+         break;
+      if (_mshr[i]._ready <= SIM_TIME && slot < 0)
+         slot = i;
+   }
+
+   if (i < _mc->_nmshr)
+   {
+      // secondary miss, wait for the same fill
+      _mc->_mshrMerged++;
+      ready = _mshr[i]._ready;
+   }
+   else
+   {
+      wait = _mc->_l1d->Access(EX_MEM_NXT._memory_addr_reg, store, EX_MEM_NXT._pc);
+      if (wait == 0)
+         return; // hit under miss
+      _mc->_mshrPrimary++;
+
+      if (slot < 0)
+      {
+         slot = 0;
+         for (i = 1; i < _mc->_nmshr; i++)
+            if (_mshr[i]._ready < _mshr[slot]._ready)
+               slot = i;
+         if (_mshr[slot]._ready - SIM_TIME > (LL)_stall)
+            _stall = (int)(_mshr[slot]._ready - SIM_TIME);
+         _mc->_mshrFullStalls++;
+      }
+      ready = SIM_TIME + _stall + wait;
+      _mshr[slot]._line = line;
+      _mshr[slot]._ready = ready;
+   }
+
+   // stores retire into the cache through the MSHR, nothing waits on them
+   if (!store)
+      _mc->_regReady[(EX_MEM_NXT._writeFREG ? 32 : 0) + EX_MEM_NXT._decodedDST] = ready;
+}
+
 void Memory::MainLoop(void)
 {
-   Bool memControl;
+   int k;
 
    while (1)
    {
       AWAIT_P_PHI0; // @posedge
+      if (_mc->_memStall)
+      {
+         AWAIT_P_PHI1; // frozen behind a D-cache miss
+         continue;
+      }
 
-      _mc->EX_MEM_NXT = _mc->EX_MEM_CUR;
-      memControl = _mc->EX_MEM_NXT._memControl;
+      _in = _mc->EX_MEM_CUR; // becomes MEM/WB at negedge
+
+      // With MSHRs the L1D is looked up as a load enters MEM, before
+      // decode (later in this phase) picks a MEM->EX bypass for its
+      // consumer: a miss has to hold that consumer up already
+      _stall = 0;
+      if (_mshr)
+         for (k = 0; k < _mc->_issueWidth; k++)
+            if (!_in[k]._isNOP && _in[k]._memControl)
+               dcache_access(_in[k]);
 
       AWAIT_P_PHI1; // @negedge
+      if (_stall > _mc->_memStall)
+         _mc->_memStall = _stall;
 
-      if (memControl)
+      // slots in program order, so younger stores land last
+      for (k = 0; k < _mc->_issueWidth; k++)
       {
-         _mc->EX_MEM_NXT._memOp(_mc);
+         if (_in[k]._isNOP)
+            continue;
+         _mc->EX_MEM_NXT = &_in[k];
+         TRACE_STAGE(_in[k], Mem);
+         if (_in[k]._memControl)
+         {
+            _in[k]._memOp(_mc);
+            if (_mc->_l1d && !_mshr)
+               dcache_access(_in[k]);
 #ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> Accessing memory at address %#x for ins %#x\n", SIM_TIME, _mc->EX_MEM_NXT._memory_addr_reg, _mc->EX_MEM_NXT._ins);
+            fprintf(_mc->_debugLog, "<%llu> Accessing memory at address %#x for ins %#x\n", SIM_TIME, _in[k]._memory_addr_reg, _in[k]._ins);
 #endif
-      }
-      else
-      {
+         }
+         else
+         {
 #ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> Memory has nothing to do for ins %#x\n", SIM_TIME, _mc->EX_MEM_NXT._ins);
+            fprintf(_mc->_debugLog, "<%llu> Memory has nothing to do for ins %#x\n", SIM_TIME, _in[k]._ins);
 #endif
+         }
       }
-
-      _mc->MEM_WB_CUR = _mc->MEM_WB_NXT;
    }
 }
@@ -5,13 +5,25 @@
 
 class Mipc;
 
+// One outstanding L1D line fill
+typedef struct
+{
+   LL _line;  // line address
+   LL _ready; // cycle the fill completes; free after that
+} MSHR;
+
 class Memory : public SimObject {
 public:
    Memory (Mipc*);
    ~Memory ();
   
-   FAKE_SIM_TEMPLATE;
+   void dcache_access(PipeReg &EX_MEM_NXT);
+
+   SAVE_SIM_TEMPLATE;
 
    Mipc *_mc;
+   PipeReg *_in; // EX/MEM bank sampled at posedge
+   MSHR *_mshr;  // Mipc.MSHRs entries, NULL if blocking
+   int _stall;   // MSHR-full freeze found this cycle
 };
 #endif
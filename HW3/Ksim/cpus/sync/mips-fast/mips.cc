@@ -1,16 +1,109 @@
 #include "mips.h"
+#include "xlate.h"
+#include "checker.h"
+#include "bpred.h"
+#include "cache.h"
+#include "prefetch.h"
+#include "trace.h"
 #include <assert.h>
+#include <string.h>
 #include "mips-irix5.h"
+#include "app_syscall.h"
+#include "image.h"
 
-Mipc::Mipc(Mem *m) : _l('M')
+Mipc::Mipc(Mem *m, Bool functional) : _l('M')
 {
+   unsigned n;
+
    _mem = m;
+   if (functional)
+   {
+      FunctionalSetup();
+      return;
+   }
+   if (ParamGetBool("Mipc.FlatMemory"))
+      _mem->Reserve(); // stays on the page table if the host cannot
    _sys = new MipcSysCall(this); // Allocate syscall layer
+   _checker = NULL;
+
+   if (strcmp(ParamGetString("Mipc.BranchPredictor"), "none"))
+      _bpred = new BranchPred(ParamGetString("Mipc.BranchPredictor"), ParamGetInt("Mipc.BPredEntries"),
+                              ParamGetInt("Mipc.BPredHistory"), ParamGetInt("Mipc.BTBEntries"));
+   else
+      _bpred = NULL;
+
+   _l1i = _l1d = _l2 = NULL;
+   if (ParamGetBool("Mipc.Caches"))
+   {
+      if (ParamGetBool("Mipc.UseL2"))
+         _l2 = new MipcCache("Mipc.L2", NULL, ParamGetInt("Mipc.L2.Latency"), ParamGetInt("Mipc.MemLatency"));
+      _l1i = new MipcCache("Mipc.L1I", _l2, 0, ParamGetInt("Mipc.MemLatency"));
+      _l1d = new MipcCache("Mipc.L1D", _l2, 0, ParamGetInt("Mipc.MemLatency"));
+   }
+   _nmshr = _l1d ? ParamGetInt("Mipc.MSHRs") : 0;
+   Assert(_nmshr >= 0, "Mipc.MSHRs must not be negative");
+
+   n = ParamGetInt("Mipc.DecodeCacheEntries");
+   Assert(n > 0 && (n & (n - 1)) == 0, "Mipc.DecodeCacheEntries must be a power of two");
+   _dcache = new DecodedIns[n];
+   _dcacheMask = n - 1;
+
+   n = ParamGetInt("Mipc.BlockCacheEntries");
+   Assert(n > 0 && (n & (n - 1)) == 0, "Mipc.BlockCacheEntries must be a power of two");
+   _xcache = new TransBlock[n];
+   _xcacheMask = n - 1;
+   for (unsigned i = 0; i < n; i++)
+      _xcache[i]._gen = 0;
+   _xlatePages = new unsigned[XLATE_PAGE_WORDS];
+   _xlateGen = 1;
+   _xlateEnabled = ParamGetBool("Mipc.FastForwardXlate");
+
+   _issueWidth = ParamGetInt("Mipc.IssueWidth");
+   Assert(_issueWidth >= 1 && _issueWidth <= MAX_ISSUE_WIDTH, "Mipc.IssueWidth out of range");
+   _memPorts = ParamGetInt("Mipc.MemPorts");
+   _multipliers = ParamGetInt("Mipc.Multipliers");
+   Assert(_memPorts >= 1 && _multipliers >= 1, "Mipc needs at least one memory port and multiplier");
+   Assert(_multipliers <= MAX_ISSUE_WIDTH, "Mipc.Multipliers out of range");
+   _mulLatency = ParamGetInt("Mipc.MulLatency");
+   _divLatency = ParamGetInt("Mipc.DivLatency");
+   Assert(_mulLatency >= 1 && _divLatency >= 1, "Mipc mult/div latencies must be at least one cycle");
+   _mdPipelined = ParamGetBool("Mipc.MulDivPipelined");
+   _bypass = ParseBypass(ParamGetString("Mipc.Bypass"));
+
+   _nstages = 0;
+   _ckptNext = 0;
+   _ckptInterval = ParamGetLL("Mipc.CheckpointInterval");
+   if (ParamGetBool("Mipc.Checkpoint"))
+      _ckptNext = ParamGetLL("Mipc.CheckpointAt") > 0 ? ParamGetLL("Mipc.CheckpointAt") : 1;
+   _nckpt = 0;
+   _ckptLast = NULL;
+   _restored = FALSE;
+
+   _samplePhase = SAMPLE_OFF;
+   _sampleUnit = ParamGetLL("Mipc.SampleUnit");
+   _sampleWarmup = ParamGetLL("Mipc.SampleWarmup");
+   _samplePeriod = ParamGetLL("Mipc.SamplePeriod");
+   _sampleWarming = ParamGetBool("Mipc.SampleWarming");
+   if (ParamGetBool("Mipc.Sample"))
+   {
+      Assert(_sampleUnit > 0 && _sampleWarmup + _sampleUnit <= _samplePeriod,
+             "Mipc.SamplePeriod must cover Mipc.SampleWarmup and Mipc.SampleUnit");
+      _samplePhase = SAMPLE_DRAIN; // start with the functional part
+   }
+   _sampleEnd = 0;
+   _sampleCycle = 0;
+   _sampleInsn = 0;
+   _nsamples = 0;
+   _cpiSum = 0.0;
+   _cpiSumSq = 0.0;
 
 #ifdef MIPC_DEBUG
    _debugLog = fopen("mipc.debug", "w");
    assert(_debugLog != NULL);
 #endif
+#ifdef MIPC_TRACE
+   _trace = new PipeTrace(ParamGetString("Mipc.TraceFile"));
+#endif
 
    Reboot(ParamGetString("Mipc.BootROM"));
 }
@@ -19,53 +112,343 @@ Mipc::~Mipc(void)
 {
 }
 
+/*
+ * Just the architectural state and what StepOne needs (the checker's
+ * golden model): no boot image, caches, predictor, decode or block
+ * cache, trace or checkpoints, and no Mipc.* parameters.  The owner
+ * fills in registers and memory.
+ */
+void Mipc::FunctionalSetup(void)
+{
+   _sys = new MipcSysCall(this);
+   _checker = NULL;
+   _bpred = NULL;
+   _l1i = _l1d = _l2 = NULL;
+   _nmshr = 0;
+   _dcache = NULL;
+   _dcacheMask = 0;
+   _xcache = NULL;
+   _xcacheMask = 0;
+   _xlatePages = new unsigned[XLATE_PAGE_WORDS];
+   _xlateGen = 1;
+   _xlateEnabled = FALSE;
+   XlateFlush();
+   _issueWidth = 1;
+   _nstages = 0;
+   _ckptNext = 0;
+   _ckptLast = NULL;
+   _restored = FALSE;
+   _samplePhase = SAMPLE_OFF;
+#ifdef MIPC_DEBUG
+   _debugLog = NULL;
+#endif
+#ifdef MIPC_TRACE
+   _trace = NULL;
+#endif
+   _boot = 0;
+   _sim_exit = 0;
+   _pc = 0;
+}
+
+/*
+ * Defaults for the Mipc.* parameters read by the constructor, shared
+ * by every core built on Mipc
+ */
+void Mipc::RegisterDefaults(void)
+{
+   RegisterDefault("Mipc.FastForward", 0ULL);
+   RegisterDefault("Mipc.FastForwardPC", 0);
+   RegisterDefault("Mipc.DecodeCacheEntries", 1024);
+   RegisterDefault("Mipc.FastForwardXlate", "Yes");
+   RegisterDefault("Mipc.BlockCacheEntries", 1024);
+   RegisterDefault("Mipc.Check", "No");
+   RegisterDefault("Mipc.FlatMemory", "Yes");
+   RegisterDefault("Mipc.IssueWidth", 1);
+   RegisterDefault("Mipc.MemPorts", 1);
+   RegisterDefault("Mipc.Multipliers", 1);
+   RegisterDefault("Mipc.MulLatency", 1);
+   RegisterDefault("Mipc.DivLatency", 1);
+   RegisterDefault("Mipc.MulDivPipelined", "Yes");
+   RegisterDefault("Mipc.Bypass", "wb");
+   RegisterDefault("Mipc.BranchPredictor", "none");
+   RegisterDefault("Mipc.BPredEntries", 4096);
+   RegisterDefault("Mipc.BPredHistory", 12);
+   RegisterDefault("Mipc.BTBEntries", 512);
+   RegisterDefault("Mipc.Caches", "No");
+   RegisterDefault("Mipc.UseL2", "No");
+   RegisterDefault("Mipc.L2.Latency", 10);
+   RegisterDefault("Mipc.MemLatency", 100);
+   RegisterDefault("Mipc.MSHRs", 0);
+   RegisterDefault("Mipc.Checkpoint", "No");
+   RegisterDefault("Mipc.CheckpointFile", "mipc.ckpt");
+   RegisterDefault("Mipc.CheckpointAt", 0ULL);
+   RegisterDefault("Mipc.CheckpointInterval", 0ULL);
+   RegisterDefault("Mipc.CheckpointExit", "No");
+   RegisterDefault("Mipc.Restore", "");
+   RegisterDefault("Mipc.Sample", "No");
+   RegisterDefault("Mipc.SampleUnit", 1000ULL);
+   RegisterDefault("Mipc.SampleWarmup", 2000ULL);
+   RegisterDefault("Mipc.SamplePeriod", 1000000ULL);
+   RegisterDefault("Mipc.SampleWarming", "Yes");
+   CacheCore::RegisterDefault("Mipc.L1I");
+   CacheCore::RegisterDefault("Mipc.L1D");
+   CacheCore::RegisterDefault("Mipc.L2");
+   Prefetcher::RegisterDefault("Mipc.L1I");
+   Prefetcher::RegisterDefault("Mipc.L1D");
+   Prefetcher::RegisterDefault("Mipc.L2");
+#ifdef MIPC_TRACE
+   RegisterDefault("Mipc.TraceFile", "mipc.trace");
+#endif
+}
+
+/*
+ * Mult/div units.  The result is computed in EX as before and written
+ * in WB; the latency only delays the instructions that read HI/LO.  A
+ * pipelined unit takes a new operation every cycle, otherwise it stays
+ * busy until its result is ready.
+ */
+Bool Mipc::MulDivFree(void)
+{
+   for (int k = 0; k < _multipliers; k++)
+      if (_mdBusy[k] <= SIM_TIME)
+         return TRUE;
+   return FALSE;
+}
+
+int Mipc::MulDivStart(void (*op)(Mipc *, unsigned))
+{
+   int lat = (op == func_div || op == func_divu) ? _divLatency : _mulLatency;
+
+   if (!_mdPipelined)
+      for (int k = 0; k < _multipliers; k++)
+         if (_mdBusy[k] <= SIM_TIME)
+         {
+            _mdBusy[k] = SIM_TIME + lat;
+            break;
+         }
+   if (_hiloReady < SIM_TIME + lat)
+      _hiloReady = SIM_TIME + lat;
+   return lat;
+}
+
+/*
+ * Mipc.Bypass: "none", "all", or a list of "ex" (EX->EX), "mem"
+ * (MEM->EX) and "wb" (WB->ID register file write-through), separated
+ * by commas or spaces
+ */
+unsigned Mipc::ParseBypass(char *spec)
+{
+   char buf[256], *tok;
+   unsigned paths = 0;
+
+   if (strlen(spec) >= sizeof(buf))
+      fatal_error("Mipc.Bypass too long");
+   strcpy(buf, spec);
+   for (tok = strtok(buf, ", "); tok; tok = strtok(NULL, ", "))
+   {
+      if (!strcmp(tok, "ex"))
+         paths |= BYPASS_PATH(BYPASS_EX_EX);
+      else if (!strcmp(tok, "mem"))
+         paths |= BYPASS_PATH(BYPASS_MEM_EX);
+      else if (!strcmp(tok, "wb"))
+         paths |= BYPASS_PATH(BYPASS_WB_ID);
+      else if (!strcmp(tok, "all"))
+         paths |= BYPASS_PATH(BYPASS_EX_EX) | BYPASS_PATH(BYPASS_MEM_EX) | BYPASS_PATH(BYPASS_WB_ID);
+      else if (strcmp(tok, "none"))
+         fatal_error("Unknown Mipc.Bypass path \"%s\"", tok);
+   }
+   return paths;
+}
+
+/*
+ * Branches and jumps, found at fetch so that fetch can stop after the
+ * delay slot until EX has resolved the branch
+ */
+Bool Mipc::IsCTI(unsigned int ins)
+{
+   unsigned int op = ins >> 26;
+
+   if (op == 0)
+      return (ins & 0x3f) == 8 || (ins & 0x3f) == 9; // jr, jalr
+   return op >= 1 && op <= 7;
+}
+
 void Mipc::MainLoop(void)
 {
    LL addr;
    unsigned int ins; // Local instruction register
+   int j, k, wait;
+   Bool frozen, fill;
 
    Assert(_boot, "Mipc::MainLoop() called without boot?");
 
-   _nfetched = 0;
+   // Skip ahead functionally, then hand off to the pipeline at _pc;
+   // a restored run carries on where its checkpoint left off
+   if (!_restored)
+   {
+      _nfetched = 0;
+      _nretired = 0;
+   }
+   if (!_restored && (ParamGetLL("Mipc.FastForward") || ParamGetInt("Mipc.FastForwardPC")))
+   {
+      if (_xlateEnabled)
+         XlateRun(ParamGetLL("Mipc.FastForward"), ParamGetInt("Mipc.FastForwardPC"));
+      else
+         FastForward(ParamGetLL("Mipc.FastForward"), ParamGetInt("Mipc.FastForwardPC"));
+      _l.print("Fast-forwarded %llu instructions, detailed simulation starts at PC %#x", _nfastfwd, _pc);
+   }
+
+   if (ParamGetBool("Mipc.Check"))
+   {
+      Assert(!_restored, "Mipc.Check needs an empty pipeline, it cannot start from a checkpoint");
+      _checker = new Checker(this);
+   }
 
    while (!_sim_exit)
    {
+      // end of a cycle: every stage is done with it
+      if (_ckptNext && IN_P_PHI1 && SIM_TIME + 1 >= _ckptNext)
+      {
+         SaveCheckpoint();
+         if (_sim_exit)
+            break;
+      }
+      if (_samplePhase != SAMPLE_OFF && IN_P_PHI1)
+      {
+         SampleStep();
+         if (_sim_exit)
+            break;
+      }
+
       AWAIT_P_PHI0; // @posedge
+      frozen = _memStall > 0;
       AWAIT_P_PHI1; // @negedge
 
-      if (_waitForSyscall)
+      if (frozen)
       {
-         IF_ID_CUR.clear();
+         // every stage waits for the D-cache
+         _memStall--;
+         _dcacheStalls++;
          continue;
       }
-      else if (_toStall)
+
+      fill = TRUE;
+      _fetchWhy = CPI_OTHER;
+      if (_fetchStall > 0)
       {
-         continue;
+         _fetchStall--;
+         _icacheStalls++;
+         fill = FALSE;
+         _fetchWhy = CPI_ICACHE;
       }
-#ifdef BRANCH_INTERLOCK
-      else if (_branchInterlock)
+
+      if (_squash)
       {
-         IF_ID_CUR.clear();
+         // EX found a mispredicted CTI: drop the wrong path still in
+         // IF/ID and restart at the right PC
+         for (k = _issued; k < _issueWidth; k++)
+            if (!IF_ID_CUR[k]._isNOP && IF_ID_CUR[k]._seq > _squashSeq)
+            {
+               TRACE_SQUASH(this, IF_ID_CUR[k]);
+               IF_ID_CUR[k]._isNOP = TRUE;
+               _nfetched--;
+               _nsquashed++;
+            }
+         if (_waitForSyscall && _syscallSeq > _squashSeq)
+            _waitForSyscall = FALSE;
+         if (_fetchDelaySlot && _fetchSeq < _squashSeq)
+            _predNPC = _redirectPC; // delay slot not fetched yet
+         else
+         {
+            _pc = _redirectPC;
+            _fetchDelaySlot = FALSE;
+         }
+         _fetchWhy = CPI_BRANCH;
+      }
+
+      if (_waitForSyscall)
+      {
+         // anything after the syscall is fetched again once it is done
+         for (k = _issued; k < _issueWidth; k++)
+            if (!IF_ID_CUR[k]._isNOP)
+            {
+               TRACE_SQUASH(this, IF_ID_CUR[k]);
+               _nfetched--;
+            }
+         for (k = 0; k < _issueWidth; k++)
+            IF_ID_NEW[k]._isNOP = TRUE;
+         _branchInterlock = FALSE;
+         _fetchDelaySlot = FALSE;
+         _dsResolved = FALSE;
+         _fetchWhy = CPI_SYSCALL;
+         AdvanceLatches();
          continue;
       }
-#endif
 
-      addr = _pc;
-      ins = _mem->BEGetWord(addr, _mem->Read(addr & ~(LL)0x7));
+      // keep what decode did not issue, in order, then refill the group
+      j = 0;
+      for (k = _issued; k < _issueWidth; k++)
+         if (!IF_ID_CUR[k]._isNOP)
+            IF_ID_NEW[j++] = IF_ID_CUR[k];
+
+      if (fill && _branchInterlock)
+         _fetchWhy = CPI_BRANCH;
+      if (_samplePhase == SAMPLE_DRAIN && !_fetchDelaySlot)
+         fill = FALSE; // the pipeline empties before functional warming
+      for (; fill && j < _issueWidth && !_branchInterlock; j++)
+      {
+         if (_l1i)
+         {
+            if (_pc == _fetchFillPC)
+               _fetchFillPC = 1; // line has just arrived
+            else if ((wait = _l1i->Access(_pc, FALSE, _pc)) > 0)
+            {
+               _fetchStall = wait;
+               _fetchFillPC = _pc;
+               _fetchWhy = CPI_ICACHE;
+               break;
+            }
+         }
+         addr = _pc;
+         ins = _mem->BEGetWord(addr, _mem->Read(addr & ~(LL)0x7));
 #ifdef MIPC_DEBUG
-      fprintf(_debugLog, "<%llu> Fetched ins %#x from PC %#x\n", SIM_TIME, ins, _pc);
+         fprintf(_debugLog, "<%llu> Fetched ins %#x from PC %#x\n", SIM_TIME, ins, _pc);
 #endif
-      IF_ID_CUR._pc = _pc;
-      IF_ID_CUR._ins = ins;
-      _nfetched++;
-      _pc += 4;
-      
-      // if (_pc == addr)
-      // { // Check if PC wasn't updated by EX
-      //    _pc += 4;
-      // }
+         IF_ID_NEW[j]._pc = _pc;
+         IF_ID_NEW[j]._ins = ins;
+         IF_ID_NEW[j]._isNOP = FALSE; // a real instruction, not a bubble
+         IF_ID_NEW[j]._seq = ++_fetchSeq;
+         IF_ID_NEW[j]._fetchCycle = SIM_TIME;
+         IF_ID_NEW[j]._predNPC = 0;
+         TRACE_FETCH(IF_ID_NEW[j]);
+         _nfetched++;
+         _pc += 4;
+
+         if (_fetchDelaySlot)
+         {
+            _fetchDelaySlot = FALSE;
+            if (_bpred || _dsResolved)
+               _pc = _predNPC;
+            else
+               _branchInterlock = TRUE;
+            _dsResolved = FALSE;
+         }
+         else if (IsCTI(ins))
+         {
+            _fetchDelaySlot = TRUE;
+            if (_bpred)
+            {
+               IF_ID_NEW[j]._predHist = _bpred->History();
+               IF_ID_NEW[j]._predNPC = _predNPC = _bpred->Predict(IF_ID_NEW[j]._pc, ins);
+            }
+         }
+      }
+      for (; j < _issueWidth; j++)
+         IF_ID_NEW[j]._isNOP = TRUE;
+      AdvanceLatches();
    }
 
+   TRACE_FLUSH(this);
    MipcDumpstats();
    Log::CloseLog();
 
@@ -88,10 +471,69 @@ void Mipc::MipcDumpstats()
    l.print("Number of instructions: %llu", _nfetched);
    l.print("Number of simulated cycles: %llu", SIM_TIME);
    l.print("CPI: %.2f", ((double)SIM_TIME) / _nfetched);
+   l.print("IPC: %.2f (issue width %d, %d memory port(s), %d multiplier(s))",
+           ((double)_nfetched) / SIM_TIME, _issueWidth, _memPorts, _multipliers);
+   for (int k = 0; k <= _issueWidth; k++)
+      l.print("Cycles issuing %d instruction(s): %llu", k, _issueHist[k]);
+   l.print("Issue stopped by group dependences: %llu, memory ports: %llu, multipliers: %llu",
+           _groupStalls, _memPortStalls, _multStalls);
+   LL cycles = 0;
+   for (int k = 0; k < CPI_NBUCKETS; k++)
+      cycles += _cpiStack[k];
+   if (cycles && _nfetched)
+   {
+      static char *bucket[CPI_NBUCKETS] = {"base", "load-use", "RAW", "HI/LO", "branch",
+                                           "syscall", "I-cache", "D-cache", "struct", "other"};
+      l.print("CPI stack (%llu cycles):", cycles);
+      for (int k = 0; k < CPI_NBUCKETS; k++)
+         l.print("  %-8s %.3f (%llu cycles, %.1f%%)", bucket[k], (double)_cpiStack[k] / _nfetched,
+                 _cpiStack[k], 100.0 * _cpiStack[k] / cycles);
+   }
+   l.print("Mult/div latency %d/%d cycles (%s), HI/LO wait stalls: %llu, busy unit stalls: %llu",
+           _mulLatency, _divLatency, _mdPipelined ? "pipelined" : "not pipelined", _hiloStalls, _mdBusyStalls);
+   l.print("Operands forwarded EX->EX: %llu, MEM->EX: %llu, written through WB->ID: %llu, load interlocks: %llu",
+           _nbypass[BYPASS_EX_EX], _nbypass[BYPASS_MEM_EX], _nbypass[BYPASS_WB_ID], _num_interlock);
+   if (_bpred)
+   {
+      l.print("Branch predictor: %s, predictions: %llu, mispredictions: %llu (%.2f%%), BTB misses: %llu",
+              _bpred->Name(), _bpred->_npred, _nmispred,
+              _bpred->_npred ? 100.0 * _nmispred / _bpred->_npred : 0.0, _bpred->_nbtbMiss);
+      l.print("Squashed instructions: %llu, squashed cycles: %llu", _nsquashed, _squashCycles);
+   }
+   if (_l1i)
+   {
+      MipcCache *c[3] = {_l1i, _l1d, _l2};
+      for (int k = 0; k < 3 && c[k]; k++)
+         l.print("%s (%s): %llu accesses, %llu misses (%.2f%% hits), %llu write-backs (%llu taken from above), %llu miss cycles",
+                 c[k]->_name, c[k]->ReplName(), c[k]->_nacc, c[k]->_nmiss,
+                 c[k]->_nacc ? 100.0 * (c[k]->_nacc - c[k]->_nmiss) / c[k]->_nacc : 0.0,
+                 c[k]->_nwb, c[k]->_nwbIn, c[k]->_stallCycles);
+      for (int k = 0; k < 3 && c[k]; k++)
+         if (c[k]->_pf)
+            l.print("%s prefetcher (%s): %llu issued, %llu useful (%.2f%% accurate, %.2f%% coverage), %llu late, %llu unused, %llu pollution misses",
+                    c[k]->_name, c[k]->_pf->_kind, c[k]->_pfIssued, c[k]->_pfUseful,
+                    c[k]->_pfIssued ? 100.0 * c[k]->_pfUseful / c[k]->_pfIssued : 0.0,
+                    (c[k]->_pfUseful + c[k]->_nmiss) ? 100.0 * c[k]->_pfUseful / (c[k]->_pfUseful + c[k]->_nmiss) : 0.0,
+                    c[k]->_pfLate, c[k]->_pfUseless, c[k]->_pfPollution);
+      l.print("Fetch stall cycles (I-cache): %llu, pipeline stall cycles (D-cache): %llu",
+              _icacheStalls, _dcacheStalls);
+      if (_nmshr)
+         l.print("L1D MSHRs: %d, primary misses: %llu, merged misses: %llu, MSHR-full misses: %llu, operand-wait stalls: %llu",
+                 _nmshr, _mshrPrimary, _mshrMerged, _mshrFullStalls, _scoreboardStalls);
+   }
+   if (_nfastfwd)
+      l.print("Number of fast-forwarded instructions: %llu", _nfastfwd);
+   if (_samplePhase != SAMPLE_OFF)
+      SampleReport(l);
+   if (_nxblocks)
+      l.print("Translated blocks: %llu, chained transitions: %llu, flushes: %llu", _nxblocks, _nxchained, _nxflush);
    l.print("Int Conditional Branches: %llu", _num_cond_br);
    l.print("Jump and Link: %llu", _num_jal);
    l.print("Jump Register: %llu", _num_jr);
    l.print("Number of fp instructions: %llu", _fpinst);
+   l.print("Decode cache lookups: %llu, misses: %llu", _dcache_lookups, _dcache_misses);
+   if (_checker)
+      l.print("Checker: %llu instructions verified", _checker->_nchecked);
    l.print("Number of loads: %llu", _num_load);
    l.print("Number of syscall emulated loads: %llu", _sys->_num_load);
    l.print("Number of stores: %llu", _num_store);
@@ -108,6 +550,51 @@ void Mipc::fake_syscall(unsigned int ins)
       _sim_exit = 1;
 }
 
+/*------------------------------------------------------------------------
+ *
+ *  Mipc::BootELF --
+ *
+ *   Load a MIPS executable directly (see Mem::ReadELF) and write the
+ *   boot code that mips-cc.pl would have assembled from Tools/bin/boot.s
+ *   at Mipc.BootPC: set $sp and $gp, make the SetArgs backdoor call,
+ *   call the entry point and exit(256) if it returns.
+ *
+ *------------------------------------------------------------------------
+ */
+#define BOOT_LUI(rt, imm) (0x3c000000 | ((rt) << 16) | ((imm) & 0xffff))
+#define BOOT_ORI(rt, imm) (0x34000000 | ((rt) << 21) | ((rt) << 16) | ((imm) & 0xffff))
+#define BOOT_LI(rt, imm) (0x24000000 | ((rt) << 16) | ((imm) & 0xffff))
+#define BOOT_SYSCALL 0x0000000c
+#define BOOT_JALR_AT 0x0020f809 // jalr $ra, $at
+
+void Mipc::BootELF(FILE *fp)
+{
+   LL entry, gp;
+   Byte code[4 * 18];
+   unsigned int ins[18] = {
+       BOOT_LUI(29, 0x7fff), BOOT_ORI(29, 0xae50), // initial stack pointer
+       0, 0,                                       // $gp
+       BOOT_LI(2, SYS_backdoor), BOOT_LI(4, BackDoor_SetArgs), BOOT_SYSCALL,
+       BOOT_LI(4, 0), BOOT_LI(2, 0),
+       0, 0, BOOT_JALR_AT, 0, // call entry point
+       BOOT_LI(2, SYS_exit), BOOT_LI(4, 256), BOOT_SYSCALL, 0, 0};
+
+   _mem->ReadELF(fp, &entry, &gp);
+   ins[2] = BOOT_LUI(28, gp >> 16);
+   ins[3] = BOOT_ORI(28, gp);
+   ins[9] = BOOT_LUI(1, entry >> 16);
+   ins[10] = BOOT_ORI(1, entry);
+   for (int i = 0; i < 18; i++)
+   {
+      code[4 * i] = ins[i] >> 24;
+      code[4 * i + 1] = ins[i] >> 16;
+      code[4 * i + 2] = ins[i] >> 8;
+      code[4 * i + 3] = ins[i];
+   }
+   _mem->WriteBlock((unsigned int)ParamGetInt("Mipc.BootPC"), code, sizeof(code));
+   _l.print("ELF entry point %#x, $gp %#x", (unsigned int)entry, (unsigned int)gp);
+}
+
 /*------------------------------------------------------------------------
  *
  *  Mipc::Reboot --
@@ -132,16 +619,31 @@ void Mipc::Reboot(char *image)
       {
          fatal_error("Could not open `%s' for booting host!", image);
       }
-      _mem->ReadImage(fp);
+      if (getc(fp) == ELF_MAGIC[0] && getc(fp) == ELF_MAGIC[1] && getc(fp) == ELF_MAGIC[2] && getc(fp) == ELF_MAGIC[3])
+      {
+         rewind(fp);
+         BootELF(fp);
+      }
+      else
+      {
+         rewind(fp);
+         _mem->ReadImage(fp);
+      }
       fclose(fp);
 
       // Reset state
       _waitForSyscall = FALSE;
       _toStall = FALSE;
       is_subreg = FALSE;
-#ifdef BRANCH_INTERLOCK
       _branchInterlock = FALSE;
-#endif
+      _fetchDelaySlot = FALSE;
+      _dsResolved = FALSE;
+      _issued = 0;
+      _fetchSeq = 0;
+      _squash = FALSE;
+      _memStall = 0;
+      _fetchStall = 0;
+      _fetchFillPC = 1;
 
       _num_load = 0;
       _num_store = 0;
@@ -149,16 +651,72 @@ void Mipc::Reboot(char *image)
       _num_cond_br = 0;
       _num_jal = 0;
       _num_jr = 0;
-      // _load_interlock_cycles = 0;
-
-      IF_ID_CUR.clear();
-      IF_ID_NXT.clear();
-      ID_EX_CUR.clear();
-      ID_EX_NXT.clear();
-      EX_MEM_CUR.clear();
-      EX_MEM_NXT.clear();
-      MEM_WB_CUR.clear();
-      MEM_WB_NXT.clear();
+      _nfastfwd = 0;
+      _nxblocks = 0;
+      _nxchained = 0;
+      XlateFlush();
+      _nxflush = 0;
+      _dcache_lookups = 0;
+      _dcache_misses = 0;
+      for (unsigned i = 0; i <= _dcacheMask; i++)
+         _dcache[i]._valid = FALSE;
+      for (int k = 0; k < CPI_NBUCKETS; k++)
+         _cpiStack[k] = 0;
+      _fetchWhy = CPI_OTHER;
+
+      for (int k = 0; k < MAX_ISSUE_WIDTH; k++)
+      {
+         for (int b = 0; b < 2; b++)
+            _fetchBank[b][k].clear();
+         for (int b = 0; b < 4; b++)
+            _groupBank[b][k].clear();
+      }
+      IF_ID_CUR = _fetchBank[0];
+      IF_ID_NEW = _fetchBank[1];
+      ID_EX_CUR = _groupBank[0];
+      EX_MEM_CUR = _groupBank[1];
+      MEM_WB_CUR = _groupBank[2];
+      ID_EX_NEW = _groupBank[3];
+      IF_ID_NXT = &IF_ID_CUR[0];
+      ID_EX_NXT = &ID_EX_CUR[0];
+      EX_MEM_NXT = &EX_MEM_CUR[0];
+      MEM_WB_NXT = &MEM_WB_CUR[0];
+
+      for (int k = 0; k <= MAX_ISSUE_WIDTH; k++)
+         _issueHist[k] = 0;
+      _groupStalls = 0;
+      _icacheStalls = 0;
+      _dcacheStalls = 0;
+      _mshrPrimary = 0;
+      _mshrMerged = 0;
+      _mshrFullStalls = 0;
+      _scoreboardStalls = 0;
+      memset(_regReady, 0, sizeof(_regReady));
+      if (_l1i)
+      {
+         _l1i->Reset();
+         _l1d->Reset();
+         if (_l2)
+            _l2->Reset();
+      }
+      _nmispred = 0;
+      _nsquashed = 0;
+      _squashCycles = 0;
+      if (_bpred)
+      {
+         _bpred->_npred = 0;
+         _bpred->_nbtbMiss = 0;
+      }
+      _memPortStalls = 0;
+      _multStalls = 0;
+      _hiloStalls = 0;
+      _mdBusyStalls = 0;
+      _hiloReady = 0;
+      for (int k = 0; k < MAX_ISSUE_WIDTH; k++)
+         _mdBusy[k] = 0;
+      _num_interlock = 0;
+      for (int k = 0; k < BYPASS_NPATHS; k++)
+         _nbypass[k] = 0;
 
       _sim_exit = 0;
       _pc = ParamGetInt("Mipc.BootPC"); // Boom! GO , boot at least ;|
@@ -175,6 +733,9 @@ void MipcSysCall::SetDWord(LL addr, LL data)
 {
 
    m->Write(addr, data);
+   _ms->CodeStore(addr);
+   if (_ms->_checker)
+      _ms->_checker->MirrorStore(addr);
    _num_store++;
 }
 
@@ -189,9 +750,42 @@ void MipcSysCall::SetWord(LL addr, Word data)
 {
 
    m->Write(addr & ~(LL)0x7, m->BESetWord(addr, m->Read(addr & ~(LL)0x7), data));
+   _ms->CodeStore(addr);
+   if (_ms->_checker)
+      _ms->_checker->MirrorStore(addr);
    _num_store++;
 }
 
+// Doublewords touched by a block access: what the syscall emulation
+// charges to _num_load/_num_store, one per Mem word as GetDWord does
+static inline LL BlockWords(LL addr, LL len)
+{
+   return ((addr + len - 1) >> 3) - (addr >> 3) + 1;
+}
+
+void MipcSysCall::ReadBlock(LL addr, void *buf, LL len)
+{
+   if (len <= 0)
+      return;
+   m->ReadBlock(addr, (Byte *)buf, len);
+   _num_load += BlockWords(addr, len);
+}
+
+void MipcSysCall::WriteBlock(LL addr, const void *buf, LL len)
+{
+   LL a;
+
+   if (len <= 0)
+      return;
+   m->WriteBlock(addr, (const Byte *)buf, len);
+   for (a = addr & ~(LL)0xfff; a < addr + len; a += 0x1000)
+      _ms->CodeStore(a);
+   if (_ms->_checker)
+      for (a = addr & ~(LL)0x7; a < addr + len; a += 8)
+         _ms->_checker->MirrorStore(a);
+   _num_store += BlockWords(addr, len);
+}
+
 void MipcSysCall::SetReg(int reg, LL val)
 {
    _ms->_gpr[reg] = val;
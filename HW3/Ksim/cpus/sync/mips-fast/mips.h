@@ -4,8 +4,13 @@
 #include "sim.h"
 
 class Mipc;
+class Checker;
+class BranchPred;
+class MipcCache;
+class PipeTrace;
 class MipcSysCall;
 class SysCall;
+struct TransBlock;
 
 typedef unsigned Bool;
 #define TRUE 1
@@ -17,19 +22,43 @@ typedef unsigned Bool;
 #define FP_TWIDDLE 1
 #endif
 
-// #define BYPASS_ENABLED 1        // Enable bypass paths
-#define BYPASS_MEM_EX_ENABLED 1 // Enable MEM->EX bypass path specifically
 #define REG_DEFAULT 10000 // Sentinel value for unused register source
 
-#define BYPASS_NONE 0x01
-#define BYPASS_EX_EX 0x02  // Forward from EX stage (result available end of EX)
-#define BYPASS_MEM_EX 0x04 // Forward from MEM stage (result available end of MEM)
+#define MAX_ISSUE_WIDTH 4 // upper bound for Mipc.IssueWidth
+
+// CPI stack: decode charges every cycle to exactly one bucket
+#define CPI_BASE 0    // issued at least one (right-path) instruction
+#define CPI_LOADUSE 1 // waited on a load result (load interlock)
+#define CPI_RAW 2     // waited on a producer that cannot forward
+#define CPI_HILO 3    // waited on HI/LO or a mult/div unit
+#define CPI_BRANCH 4  // nothing to issue behind a CTI, or wrong path
+#define CPI_SYSCALL 5 // nothing to issue, draining for a syscall
+#define CPI_ICACHE 6  // nothing to issue, I-cache miss
+#define CPI_DCACHE 7  // frozen on the D-cache, or operand in an MSHR
+#define CPI_STRUCT 8  // memory port or multiplier limit
+#define CPI_OTHER 9   // pipeline fill, illegal instructions
+#define CPI_NBUCKETS 10
+
+// Where EX takes an operand from (Mipc.Bypass enables the paths)
+#define BYPASS_NONE 0   // register file, read in decode
+#define BYPASS_EX_EX 1  // EX_MEM_CUR: producer was in EX (result available end of EX)
+#define BYPASS_MEM_EX 2 // MEM_WB_CUR: producer was in MEM (result available end of MEM)
+#define BYPASS_WB_ID 3  // register file: WB writes it before decode reads it
+#define BYPASS_NPATHS 4
+#define BYPASS_PATH(p) (1U << (p))
+
+// Sampled simulation (Mipc.Sample): what the pipeline is doing
+#define SAMPLE_OFF 0     // not sampling, detailed throughout
+#define SAMPLE_WARMUP 1  // detailed, not measured
+#define SAMPLE_MEASURE 2 // detailed, measured
+#define SAMPLE_DRAIN 3   // fetch stopped; functional warming once empty
 
 #include "mem.h"
 #include "../../common/syscall.h"
 #include "queue.h"
 
 // #define MIPC_DEBUG 1
+// #define MIPC_TRACE 1 // pipeline event trace, see trace.h
 
 typedef struct
 {
@@ -38,6 +67,14 @@ typedef struct
    Bool _isSyscall;   // System call detected
    Bool _isIllegalOp; // Illegal opcode
    Bool _isNOP;       // NOP
+   LL _seq;           // fetch order, 0 for a bubble
+   LL _fetchCycle;
+   unsigned int _predNPC; // CTI: predicted PC after the delay slot
+   unsigned _predHist;    // CTI: predictor history it was predicted with
+#ifdef MIPC_TRACE
+   LL _trDecode, _trEx, _trMem; // cycle each stage took it
+   unsigned _trStall, _trFlags; // decode wait cycles and TRACE_* reasons
+#endif
 
    // Decode (ID) stage
    unsigned _decodedDST;                  // Destination register
@@ -52,9 +89,8 @@ typedef struct
    unsigned _subregOperand;  // for lwl, lwr
    signed int _branchOffset; // Branch offset
 
-#ifdef BYPASS_ENABLED
-   unsigned _bypSRC1, _bypSRC2;
-#endif
+   unsigned _bypSRC1, _bypSRC2;   // BYPASS_* path of each operand
+   unsigned _bypSlot1, _bypSlot2; // issue slot of the producer
 
    // Execute (EX) stage
    int _bdslot;
@@ -72,13 +108,24 @@ typedef struct
    void clear();
 } PipeReg;
 
-void PipeReg::clear()
+inline void PipeReg::clear()
 {
    _pc = 0;
    _ins = 0; // NOP instruction
    _isSyscall = FALSE;
    _isIllegalOp = FALSE;
    _isNOP = TRUE; // Default to NOP
+   _seq = 0;
+   _fetchCycle = 0;
+   _predNPC = 0;
+   _predHist = 0;
+#ifdef MIPC_TRACE
+   _trDecode = 0;
+   _trEx = 0;
+   _trMem = 0;
+   _trStall = 0;
+   _trFlags = 0;
+#endif
 
    _decodedDST = 0;
    _decodedSRC1 = 0;
@@ -92,10 +139,10 @@ void PipeReg::clear()
    _memControl = FALSE;
    _subregOperand = 0;
    _branchOffset = 0;
-#ifdef BYPASS_ENABLED
    _bypSRC1 = BYPASS_NONE;
    _bypSRC2 = BYPASS_NONE;
-#endif
+   _bypSlot1 = 0;
+   _bypSlot2 = 0;
 
    _btgt = 0xdeadbeef; // Use a recognizable invalid address
    _btaken = 0;
@@ -113,29 +160,139 @@ void PipeReg::clear()
    _memOp = NULL;
 }
 
+#define XLATE_PAGE_WORDS (1 << 15) // one bit per 4 KB page of a 32-bit space
+
+// Where Dec() reads an operand value from
+#define DEC_SRC_NONE 0 // static value (immediate or unused)
+#define DEC_SRC_GPR 1  // _gpr[idx]
+#define DEC_SRC_FPR 2  // single-precision half of _fpr
+
+// Static decode of one instruction, cached by PC (see Mipc::Dec)
+typedef struct
+{
+   unsigned int _pc;  // tag
+   unsigned int _ins; // tag: instruction word the entry was decoded from
+   Bool _valid;
+
+   unsigned _src1Sel, _src2Sel; // DEC_SRC_*
+   unsigned _src1Idx, _src2Idx;
+   signed int _decodedSRC1, _decodedSRC2; // static operand values (immediates)
+   unsigned _regSRC1, _regSRC2;           // hazard check registers
+   unsigned _decodedDST;
+   unsigned _decodedShiftAmt;
+   signed int _branchOffset;
+   unsigned int _btgt; // static branch target
+   int _bdslot;
+
+   Bool _requiresFP;
+   Bool _hiWrite, _loWrite;
+   Bool _memControl;
+   Bool _hiWPort, _loWPort;
+   Bool _writeREG, _writeFREG;
+   Bool _isSyscall, _isIllegalOp;
+   Bool _isSubreg; // lwl/lwr: old rt value needed
+   Bool _jumpReg;  // jr/jalr: target is SRC1
+   Bool _isFP;
+
+   void (*_opControl)(Mipc *, unsigned);
+   void (*_memOp)(Mipc *);
+} DecodedIns;
+
 class Mipc : public SimObject
 {
 public:
-   Mipc(Mem *m);
+   Mipc(Mem *m, Bool functional = FALSE); // functional: see FunctionalSetup
    ~Mipc();
 
-   FAKE_SIM_TEMPLATE;
+   SAVE_SIM_TEMPLATE;
 
    MipcSysCall *_sys; // Emulated system call layer
 
    void dumpregs(void); // Dumps current register state
 
+   static void RegisterDefaults(void);
+   static Bool IsCTI(unsigned int ins); // branch or jump
+   Bool MulDivFree(void);
+   static unsigned ParseBypass(char *spec);
+   int MulDivStart(void (*op)(Mipc *, unsigned)); // returns the latency
+
    void Reboot(char *image = NULL);
    // Restart processor.
    // "image" = file name for new memory
    // image if any.
+   void BootELF(FILE *fp); // Load an executable, write boot code at Mipc.BootPC
+   void FunctionalSetup(void); // golden-model Mipc, no pipeline
+
+   // Binary checkpoints (Mipc.Checkpoint*, Mipc.Restore), see ckpt.cc
+   void Checkpoint(FILE *fp, Bool save); // registers, latches, counters, predictor, caches
+   void SaveCheckpoint(void);            // at a cycle boundary, from MainLoop
+   void RestoreCheckpoint(char *file);   // before the tasks are created
+   FILE *OpenCheckpoint(char *file, LL *time); // header and memory, parents first
+
+   // Sampled simulation (Mipc.Sample*), see sample.cc
+   void SampleStep(void);     // from MainLoop at the end of every cycle
+   Bool PipeEmpty(void);      // nothing in flight, fetch not waiting
+   void SampleReport(Log &l); // CPI estimate and confidence
 
    void MipcDumpstats();                // Prints simulation statistics
    void Dec(unsigned int ins, Bool real);          // Decoder function
+   void DecodeStatic(unsigned int pc, unsigned int ins, DecodedIns *d);
    void fake_syscall(unsigned int ins); // System call interface
-
-   PipeReg IF_ID_CUR, ID_EX_CUR, EX_MEM_CUR, MEM_WB_CUR;
-   PipeReg IF_ID_NXT, ID_EX_NXT, EX_MEM_NXT, MEM_WB_NXT;
+   LL FastForward(LL ninsn, unsigned int stopPC); // Functional execution, no pipeline
+   Bool StepOne(unsigned int &pc, unsigned int &npc); // One functional instruction
+   inline Bool FuncExec(unsigned int &pc, unsigned int &npc);
+   LL XlateRun(LL ninsn, unsigned int stopPC);    // Same, from translated blocks
+   LL WarmForward(LL ninsn); // Same, also training caches and branch predictor
+   void XlateBlock(unsigned int pc, TransBlock *b, void **optab);
+   void XlateFlush(void);
+
+   // Every store to simulated memory goes through here so that
+   // translated blocks never outlive the code they were built from
+   void CodeStore(unsigned int addr)
+   {
+      if (_xlatePages[addr >> 17] & (1U << ((addr >> 12) & 31)))
+         XlateFlush();
+   }
+
+   // One latch per issue slot, slot 0 oldest.  Latches are banks that
+   // the stages pass around by pointer rather than copy: fetch builds
+   // the next IF/ID in the spare of two banks, and a group decode
+   // issues stays in one of four banks while it moves through EX, MEM
+   // and WB (AdvanceLatches).  A bubble is a slot with _isNOP set;
+   // nothing else in it is meaningful.  The NXT pointers are the slot
+   // a stage is working on.
+   PipeReg _fetchBank[2][MAX_ISSUE_WIDTH];
+   PipeReg _groupBank[4][MAX_ISSUE_WIDTH];
+   PipeReg *IF_ID_CUR, *IF_ID_NEW; // decode reads CUR, fetch fills NEW
+   PipeReg *ID_EX_CUR, *EX_MEM_CUR, *MEM_WB_CUR;
+   PipeReg *ID_EX_NEW; // decode fills it at negedge
+   PipeReg *IF_ID_NXT, *ID_EX_NXT, *EX_MEM_NXT, *MEM_WB_NXT;
+
+   void AdvanceLatches(void)
+   {
+      PipeReg *t = MEM_WB_CUR;
+
+      MEM_WB_CUR = EX_MEM_CUR;
+      EX_MEM_CUR = ID_EX_CUR;
+      ID_EX_CUR = ID_EX_NEW;
+      ID_EX_NEW = t;
+      t = IF_ID_CUR;
+      IF_ID_CUR = IF_ID_NEW;
+      IF_ID_NEW = t;
+   }
+
+   int _issueWidth;  // instructions fetched/issued per cycle
+   int _memPorts;    // memory instructions per group
+   int _multipliers; // mult/div instructions per group
+   int _mulLatency, _divLatency; // cycles until HI/LO hold the result
+   Bool _mdPipelined;            // a unit accepts a new mult/div every cycle
+   LL _mdBusy[MAX_ISSUE_WIDTH];  // non-pipelined: cycle each unit is free
+   LL _hiloReady;                // cycle the youngest mult/div result is ready
+   int _issued;      // slots decode issued this cycle
+   unsigned _bypass; // enabled forwarding paths, BYPASS_PATH() bits
+
+   // latch EX forwards an operand from
+   PipeReg *BypassLatch(unsigned path) { return path == BYPASS_EX_EX ? EX_MEM_CUR : MEM_WB_CUR; }
 
    unsigned int _gpr[32]; // general-purpose integer registers
 
@@ -151,30 +308,98 @@ public:
    // unsigned int _lastbdslot;			// branch delay state
    unsigned int _boot; // boot code loaded?
 
+   DecodedIns *_dcache; // decoded-instruction cache, direct mapped on PC
+   unsigned _dcacheMask;
+
+   TransBlock *_xcache; // translated blocks, direct mapped on PC
+   unsigned _xcacheMask;
+   unsigned *_xlatePages; // pages holding translated code
+   unsigned _xlateGen;    // bumped on flush, invalidates all blocks
+   Bool _xlateEnabled;
+
    Bool _waitForSyscall;
    Bool _toStall;
    Bool is_subreg;
-#ifdef BRANCH_INTERLOCK
-   Bool _branchInterlock;
-#endif
+   Bool _branchInterlock; // fetched a branch and its delay slot, wait for EX
+   Bool _fetchDelaySlot;  // fetched a branch, the delay slot comes next
+   Bool _dsResolved;      // EX resolved that branch first: go to _predNPC
+
+   BranchPred *_bpred;     // NULL: fetch waits for EX (_branchInterlock)
+   unsigned int _predNPC;  // where fetch goes after the pending delay slot
+   LL _fetchSeq;           // last _seq handed out by fetch
+   LL _syscallSeq;         // _seq of the syscall decode is waiting on
+   Bool _squash;           // EX found a misprediction this cycle:
+   LL _squashSeq;          // ... drop everything younger than this
+   unsigned int _redirectPC; // ... and fetch from here
+
+   MipcCache *_l1i, *_l1d, *_l2; // NULL: single-cycle memory
+   int _memStall;            // cycles the pipeline stays frozen for MEM
+   int _nmshr;               // L1D MSHRs, 0 for a blocking cache
+   LL _regReady[64];         // cycle a missed load's register is valid (gpr, fpr)
+   int _fetchStall;          // cycles fetch waits for the I-cache
+   unsigned int _fetchFillPC; // instruction whose line is being filled
+   int _fetchWhy;            // CPI_* bucket if fetch left IF/ID empty
 
    // Simulation statistics counters
 
-   LL _nfetched;
+   LL _nfetched;  // fetched, less squashed: retired once the pipe drains
+   LL _nretired;  // through WB; delimits the sample windows
+   LL _nfastfwd; // instructions run by FastForward/XlateRun
+   LL _nxblocks, _nxchained, _nxflush;
    LL _num_cond_br;
    LL _num_jal;
    LL _num_jr;
    LL _num_load;
    LL _num_store;
    LL _fpinst;
-   // LL _load_interlock_cycles;
+   LL _issueHist[MAX_ISSUE_WIDTH + 1]; // cycles by instructions issued
+   LL _groupStalls;   // issue stopped by a dependence inside the group
+   LL _memPortStalls; // ... by the memory port limit
+   LL _multStalls;    // ... by the multiplier limit
+   LL _hiloStalls;    // decode cycles waiting on a mult/div result
+   LL _mdBusyStalls;  // ... on a busy non-pipelined mult/div unit
+   LL _num_interlock;
+   LL _nbypass[BYPASS_NPATHS]; // operands EX took over each path
+   LL _icacheStalls; // cycles fetch waited on the I-cache
+   LL _dcacheStalls; // cycles the pipeline was frozen on the D-cache
+   LL _mshrPrimary, _mshrMerged; // L1D misses allocating / joining an MSHR
+   LL _mshrFullStalls;   // misses that found every MSHR busy
+   LL _scoreboardStalls; // decode cycles waiting on an MSHR fill
+   LL _nmispred;     // mispredicted CTIs
+   LL _nsquashed;    // wrong-path instructions discarded
+   LL _squashCycles; // fetch-to-resolve cycles of mispredicted CTIs
+   LL _cpiStack[CPI_NBUCKETS]; // cycles by CPI_* bucket
+   LL _dcache_lookups;
+   LL _dcache_misses;
+
+   int _samplePhase;          // SAMPLE_*
+   LL _sampleUnit;            // measured instructions per sample
+   LL _sampleWarmup;          // detailed instructions before each measurement
+   LL _samplePeriod;          // instructions from one sample to the next
+   Bool _sampleWarming;       // train caches and predictor between samples
+   LL _sampleEnd;             // _nretired that ends the detailed phase
+   LL _sampleCycle, _sampleInsn; // where the measurement started
+   LL _nsamples;
+   double _cpiSum, _cpiSumSq; // over the samples
+
+   SimObject *_stages[4]; // stages with state of their own, saved after Mipc
+   int _nstages;
+   LL _ckptNext;     // cycle of the next checkpoint, 0 for none
+   LL _ckptInterval; // cycles between checkpoints, 0 for just one
+   int _nckpt;       // checkpoints written
+   char *_ckptLast;  // file of the last one, parent of the next
+   Bool _restored;   // started from Mipc.Restore: no fast-forward
 
    Mem *_mem; // attached memory (not a cache)
+   Checker *_checker; // golden-model checker, or NULL
 
    Log _l;
    int _sim_exit; // 1 on normal termination
 
    FILE *_debugLog;
+#ifdef MIPC_TRACE
+   PipeTrace *_trace;
+#endif
 
    // EXE stage definitions
 
@@ -279,6 +504,9 @@ public:
    Word GetWord(LL addr);
    void SetWord(LL addr, Word data);
 
+   void ReadBlock(LL addr, void *buf, LL len);
+   void WriteBlock(LL addr, const void *buf, LL len);
+
    void SetReg(int reg, LL val);
    LL GetReg(int reg);
    LL GetTime(void);
@@ -0,0 +1,199 @@
+#include <string.h>
+#include "prefetch.h"
+#include "checkpoint.h"
+
+void Prefetcher::RegisterDefault(char *name)
+{
+   char buf[1024];
+
+   sprintf(buf, "%s.Prefetcher", name);
+   ::RegisterDefault(buf, "none");
+
+   sprintf(buf, "%s.PrefetchDegree", name);
+   ::RegisterDefault(buf, 1);
+
+   sprintf(buf, "%s.PrefetchTable", name);
+   ::RegisterDefault(buf, 64);
+}
+
+Prefetcher *Prefetcher::Create(char *name, int lineSize)
+{
+   char buf[1024];
+   char *kind;
+   int degree, table;
+   Prefetcher *p;
+
+   sprintf(buf, "%s.Prefetcher", name);
+   kind = ParamGetString(buf);
+   sprintf(buf, "%s.PrefetchDegree", name);
+   degree = ParamGetInt(buf);
+   sprintf(buf, "%s.PrefetchTable", name);
+   table = ParamGetInt(buf);
+
+   if (!strcmp(kind, "none"))
+      return NULL;
+
+   if (degree < 1 || degree > PF_MAX_DEGREE)
+      fatal_error("%s.PrefetchDegree must be between 1 and %d", name, PF_MAX_DEGREE);
+   if (table < 1 || (table & (table - 1)))
+      fatal_error("%s.PrefetchTable must be a power of two", name);
+
+   if (!strcmp(kind, "nextline"))
+      p = new NextLinePrefetcher(degree, lineSize);
+   else if (!strcmp(kind, "stride"))
+      p = new StridePrefetcher(degree, lineSize, table);
+   else if (!strcmp(kind, "stream"))
+      p = new StreamPrefetcher(degree, lineSize, table);
+   else
+   {
+      fatal_error("Unknown %s.Prefetcher \"%s\"", name, kind);
+      return NULL;
+   }
+
+   p->_kind = kind;
+   return p;
+}
+
+NextLinePrefetcher::NextLinePrefetcher(int degree, int lineSize)
+{
+   _degree = degree;
+   _lineSize = lineSize;
+}
+
+int NextLinePrefetcher::Observe(unsigned int pc, LL addr, Bool miss, LL *out)
+{
+   int i;
+
+   if (!miss)
+      return 0;
+   for (i = 0; i < _degree; i++)
+      out[i] = addr + (LL)(i + 1) * _lineSize;
+   return _degree;
+}
+
+StridePrefetcher::StridePrefetcher(int degree, int lineSize, int entries)
+{
+   int i;
+
+   _degree = degree;
+   _lineSize = lineSize;
+   _mask = entries - 1;
+   _table = new StrideEntry[entries];
+   for (i = 0; i < entries; i++)
+   {
+      _table[i]._pc = 0;
+      _table[i]._conf = 0;
+   }
+}
+
+int StridePrefetcher::Observe(unsigned int pc, LL addr, Bool miss, LL *out)
+{
+   StrideEntry *e = &_table[(pc >> 2) & _mask];
+   LL stride;
+   int i;
+
+   if (e->_pc != pc)
+   {
+      e->_pc = pc;
+      e->_last = addr;
+      e->_stride = 0;
+      e->_conf = 0;
+      return 0;
+   }
+
+   stride = addr - e->_last;
+   e->_last = addr;
+   if (stride == e->_stride && stride != 0)
+   {
+      if (e->_conf < 3)
+         e->_conf++;
+   }
+   else
+   {
+      if (e->_conf > 0)
+         e->_conf--;
+      if (e->_conf < 2)
+         e->_stride = stride;
+   }
+
+   if (e->_conf < 2)
+      return 0;
+   for (i = 0; i < _degree; i++)
+      out[i] = addr + (LL)(i + 1) * e->_stride;
+   return _degree;
+}
+
+void StridePrefetcher::Checkpoint(FILE *fp, Bool save)
+{
+   ckpt_io(fp, save, _table, (_mask + 1) * sizeof(StrideEntry));
+}
+
+StreamPrefetcher::StreamPrefetcher(int degree, int lineSize, int streams)
+{
+   int i;
+
+   _degree = degree;
+   _lineSize = lineSize;
+   _nstreams = streams;
+   _clock = 0;
+   _streams = new StreamEntry[streams];
+   for (i = 0; i < streams; i++)
+   {
+      _streams[i]._valid = FALSE;
+      _streams[i]._lru = 0;
+   }
+}
+
+int StreamPrefetcher::Observe(unsigned int pc, LL addr, Bool miss, LL *out)
+{
+   LL line = addr & ~(LL)(_lineSize - 1);
+   StreamEntry *s, *v;
+   int i, n;
+
+   // an access anywhere in the window [_next, _ahead) advances a stream
+   s = NULL;
+   for (i = 0; i < _nstreams; i++)
+      if (_streams[i]._valid && line >= _streams[i]._next && line < _streams[i]._ahead)
+      {
+         s = &_streams[i];
+         break;
+      }
+
+   if (!s)
+   {
+      if (!miss)
+         return 0;
+      v = &_streams[0];
+      for (i = 0; i < _nstreams; i++)
+      {
+         if (!_streams[i]._valid)
+         {
+            v = &_streams[i];
+            break;
+         }
+         if (_streams[i]._lru < v->_lru)
+            v = &_streams[i];
+      }
+      s = v;
+      s->_valid = TRUE;
+      s->_ahead = line + _lineSize;
+   }
+
+   s->_next = line + _lineSize;
+   s->_lru = ++_clock;
+
+   // keep _degree lines in flight ahead of the stream
+   n = 0;
+   while (s->_ahead < s->_next + (LL)_degree * _lineSize)
+   {
+      out[n++] = s->_ahead;
+      s->_ahead += _lineSize;
+   }
+   return n;
+}
+
+void StreamPrefetcher::Checkpoint(FILE *fp, Bool save)
+{
+   ckpt_io(fp, save, _streams, _nstreams * sizeof(StreamEntry));
+   CKPT_IO(fp, save, _clock);
+}
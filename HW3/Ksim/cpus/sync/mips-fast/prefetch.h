@@ -0,0 +1,89 @@
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+#include "mips.h"
+
+/*
+ * Hardware prefetchers for MipcCache (<cache>.Prefetcher).
+ *
+ *   nextline  on a miss, the next Degree lines
+ *   stride    per-PC table of last address and stride; once the same
+ *             stride is seen twice, Degree strides ahead
+ *   stream    Table stream trackers; a miss starts a stream, and each
+ *             access to the line a stream expects keeps Degree lines
+ *             in flight ahead of it
+ *
+ * Observe() sees every demand access of the cache it is attached to and
+ * returns the addresses to fetch; MipcCache does the fills and keeps the
+ * accuracy/coverage/timeliness/pollution counters.
+ */
+#define PF_MAX_DEGREE 8
+
+class Prefetcher
+{
+public:
+   virtual ~Prefetcher() {}
+
+   virtual int Observe(unsigned int pc, LL addr, Bool miss, LL *out) = 0;
+   virtual void Checkpoint(FILE *fp, Bool save) {} // training state, if any
+
+   // NULL for <name>.Prefetcher = "none"
+   static Prefetcher *Create(char *name, int lineSize);
+   static void RegisterDefault(char *name);
+
+   char *_kind;
+
+protected:
+   int _degree;
+   int _lineSize;
+};
+
+class NextLinePrefetcher : public Prefetcher
+{
+public:
+   NextLinePrefetcher(int degree, int lineSize);
+   int Observe(unsigned int pc, LL addr, Bool miss, LL *out);
+};
+
+typedef struct
+{
+   unsigned int _pc; // tag
+   LL _last;         // last address
+   LL _stride;
+   int _conf;        // 0..3, prefetch at 2 and above
+} StrideEntry;
+
+class StridePrefetcher : public Prefetcher
+{
+public:
+   StridePrefetcher(int degree, int lineSize, int entries);
+   int Observe(unsigned int pc, LL addr, Bool miss, LL *out);
+   void Checkpoint(FILE *fp, Bool save);
+
+private:
+   StrideEntry *_table;
+   unsigned _mask;
+};
+
+typedef struct
+{
+   LL _next;      // next line the stream expects
+   LL _ahead;     // next line to prefetch
+   unsigned _lru;
+   Bool _valid;
+} StreamEntry;
+
+class StreamPrefetcher : public Prefetcher
+{
+public:
+   StreamPrefetcher(int degree, int lineSize, int streams);
+   int Observe(unsigned int pc, LL addr, Bool miss, LL *out);
+   void Checkpoint(FILE *fp, Bool save);
+
+private:
+   StreamEntry *_streams;
+   int _nstreams;
+   unsigned _clock;
+};
+
+#endif /* __PREFETCH_H__ */
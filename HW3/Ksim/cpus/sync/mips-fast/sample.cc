@@ -0,0 +1,116 @@
+#include <math.h>
+#include <string.h>
+#include "mips.h"
+#include "checker.h"
+
+/*------------------------------------------------------------------------
+ *
+ *  Sampled simulation (Mipc.Sample)
+ *
+ *  Systematic sampling in the style of SMARTS: every Mipc.SamplePeriod
+ *  instructions the pipeline runs Mipc.SampleWarmup instructions in
+ *  detail to settle its latches and queues, then measures the CPI of
+ *  the next Mipc.SampleUnit.  In between, fetch stops, the pipeline
+ *  drains, and WarmForward runs the rest of the period functionally
+ *  while keeping the caches and branch predictor trained
+ *  (Mipc.SampleWarming = "No" skips that and uses the faster
+ *  translated fast-forward).  The clock does not move during the
+ *  functional part, so only detailed cycles are ever counted.
+ *
+ *  Windows are counted in retired instructions (_nretired), so a
+ *  sample's CPI covers exactly the instructions that completed in it,
+ *  whatever was in flight or squashed at its edges.
+ *
+ *  The samples give a mean CPI and, from their variance, a confidence
+ *  interval; SampleReport also says how many samples the same
+ *  variation would need for +/-3% at 99.7% confidence.
+ *
+ *------------------------------------------------------------------------
+ */
+
+Bool Mipc::PipeEmpty(void)
+{
+   int k;
+
+   if (_memStall || _fetchStall || _waitForSyscall || _branchInterlock || _fetchDelaySlot)
+      return FALSE;
+   for (k = 0; k < _issueWidth; k++)
+      if (!IF_ID_CUR[k]._isNOP || !ID_EX_CUR[k]._isNOP || !EX_MEM_CUR[k]._isNOP || !MEM_WB_CUR[k]._isNOP)
+         return FALSE;
+   return TRUE;
+}
+
+/*
+ * Called at negedge once fetch, the last stage, is done with the cycle
+ */
+void Mipc::SampleStep(void)
+{
+   LL n, insns;
+   double cpi;
+
+   switch (_samplePhase)
+   {
+   case SAMPLE_WARMUP:
+      if (_nretired < _sampleEnd)
+         return;
+      _samplePhase = SAMPLE_MEASURE;
+      _sampleEnd = _nretired + _sampleUnit;
+      _sampleCycle = SIM_TIME + 1;
+      _sampleInsn = _nretired;
+      return;
+
+   case SAMPLE_MEASURE:
+      if (_nretired < _sampleEnd)
+         return;
+      insns = _nretired - _sampleInsn;
+      cpi = (double)(SIM_TIME + 1 - _sampleCycle) / insns;
+      _nsamples++;
+      _cpiSum += cpi;
+      _cpiSumSq += cpi * cpi;
+      _samplePhase = SAMPLE_DRAIN; // fetch stops
+      return;
+
+   case SAMPLE_DRAIN:
+      if (!PipeEmpty())
+         return;
+      n = _samplePeriod - _sampleWarmup - _sampleUnit;
+      if (n > 0)
+      {
+         if (_sampleWarming)
+            WarmForward(n);
+         else if (_xlateEnabled)
+            XlateRun(n, 0);
+         else
+            FastForward(n, 0);
+      }
+      // functional execution finished everything it started
+      memset(_regReady, 0, sizeof(_regReady));
+      _fetchFillPC = 1;
+      if (_checker)
+         _checker->Sync();
+      _samplePhase = SAMPLE_WARMUP;
+      _sampleEnd = _nretired + _sampleWarmup;
+      return;
+   }
+}
+
+void Mipc::SampleReport(Log &l)
+{
+   double n = (double)_nsamples, mean, var, sd, need;
+   LL total = _nretired + _nfastfwd;
+
+   l.print("Sampling: %llu instruction(s) measured after %llu of warm-up, every %llu; %llu sample(s)",
+           _sampleUnit, _sampleWarmup, _samplePeriod, _nsamples);
+   if (_nsamples == 0)
+      return;
+
+   mean = _cpiSum / n;
+   var = _nsamples > 1 ? (_cpiSumSq - n * mean * mean) / (n - 1) : 0.0;
+   sd = var > 0.0 ? sqrt(var) : 0.0;
+   need = mean > 0.0 ? ceil(pow(3.0 * (sd / mean) / 0.03, 2)) : 0.0;
+
+   l.print("Sampled CPI: %.4f +/- %.4f (95%% confidence), +/- %.4f (99.7%%), coefficient of variation %.3f",
+           mean, 1.96 * sd / sqrt(n), 3.0 * sd / sqrt(n), mean > 0.0 ? sd / mean : 0.0);
+   l.print("Estimated cycles for all %llu instructions: %.0f", total, mean * total);
+   l.print("Samples needed for +/-3%% at 99.7%% confidence: %.0f", need);
+}
@@ -0,0 +1,54 @@
+#include "trace.h"
+
+#ifdef MIPC_TRACE
+
+PipeTrace::PipeTrace(char *file)
+{
+   _fp = fopen(file, "wb");
+   if (!_fp)
+      fatal_error("Cannot open trace file `%s'", file);
+   _buf = new TraceRec[TRACE_BUFFER];
+   _n = 0;
+   _nrec = 0;
+}
+
+PipeTrace::~PipeTrace(void)
+{
+   Flush();
+   fclose(_fp);
+   delete[] _buf;
+}
+
+void PipeTrace::Record(PipeReg *r, Bool squashed)
+{
+   TraceRec *t;
+
+   if (r->_isNOP)
+      return;
+
+   t = &_buf[_n++];
+   t->_seq = r->_seq;
+   t->_pc = r->_pc;
+   t->_ins = r->_ins;
+   t->_fetch = r->_fetchCycle;
+   t->_decode = r->_trDecode;
+   t->_ex = r->_trEx;
+   t->_mem = r->_trMem;
+   t->_done = SIM_TIME;
+   t->_stall = r->_trStall;
+   t->_flags = r->_trFlags | (squashed ? TRACE_SQUASHED : 0);
+   _nrec++;
+
+   if (_n == TRACE_BUFFER)
+      Flush();
+}
+
+void PipeTrace::Flush(void)
+{
+   if (_n && fwrite(_buf, sizeof(TraceRec), _n, _fp) != (size_t)_n)
+      fatal_error("Error writing the pipeline trace");
+   _n = 0;
+   fflush(_fp);
+}
+
+#endif /* MIPC_TRACE */
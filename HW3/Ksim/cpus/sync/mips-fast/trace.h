@@ -0,0 +1,72 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "mips.h"
+
+/*
+ * Pipeline event trace, built with -DMIPC_TRACE (or the #define in
+ * mips.h) and written to Mipc.TraceFile.
+ *
+ * Each instruction carries the cycle it entered every stage in its
+ * PipeReg; when it retires or is squashed one fixed-size TraceRec is
+ * appended to a buffer that is written out in large blocks.  Decode
+ * counts the cycles an instruction waited there and ORs in why (the
+ * CPI stack bucket it charged).
+ * trace2konata.pl turns the file into a Konata (or gem5 O3PipeView)
+ * log.  Without MIPC_TRACE the TRACE_* macros are empty.
+ */
+
+// TraceRec::_flags
+#define TRACE_SQUASHED 0x01     // discarded (wrong path, refetched after a syscall)
+#define TRACE_WHY(b) (2 << (b)) // waited in decode, CPI_* bucket b
+
+typedef struct
+{
+   LL _seq;
+   unsigned int _pc, _ins;
+   LL _fetch, _decode, _ex, _mem; // cycle entered, 0 = never
+   LL _done;                      // cycle retired or squashed
+   unsigned int _stall;           // cycles waited in decode
+   unsigned int _flags;           // TRACE_*
+} TraceRec; // 64 bytes, no padding
+
+#define TRACE_BUFFER 8192 // records per write
+
+#ifdef MIPC_TRACE
+
+class PipeTrace
+{
+public:
+   PipeTrace(char *file);
+   ~PipeTrace();
+
+   void Record(PipeReg *r, Bool squashed);
+   void Flush(void);
+
+   LL _nrec;
+
+private:
+   FILE *_fp;
+   TraceRec *_buf;
+   int _n;
+};
+
+#define TRACE_FETCH(r) ((r)._trDecode = (r)._trEx = (r)._trMem = 0, (r)._trStall = (r)._trFlags = 0)
+#define TRACE_STAGE(r, stage) ((r)._tr##stage = SIM_TIME)
+#define TRACE_STALL(r, why) ((r)._trStall++, (r)._trFlags |= (why))
+#define TRACE_RETIRE(mc, r) ((mc)->_trace->Record(&(r), FALSE))
+#define TRACE_SQUASH(mc, r) ((mc)->_trace->Record(&(r), TRUE))
+#define TRACE_FLUSH(mc) ((mc)->_trace->Flush())
+
+#else
+
+#define TRACE_FETCH(r)
+#define TRACE_STAGE(r, stage)
+#define TRACE_STALL(r, why)
+#define TRACE_RETIRE(mc, r)
+#define TRACE_SQUASH(mc, r)
+#define TRACE_FLUSH(mc)
+
+#endif /* MIPC_TRACE */
+
+#endif /* __TRACE_H__ */
@@ -0,0 +1,108 @@
+#!/usr/bin/perl
+#
+# Convert a pipeline trace (mipc.trace, built with MIPC_TRACE, see
+# trace.h) to a Konata log, or with -o3 to gem5's O3PipeView format
+# (view with o3-pipeview.py --cycle-time 1, or load it in Konata).
+#
+# usage: trace2konata.pl [-o3] <trace> [<output>]
+#
+
+$o3 = 0;
+if (@ARGV && $ARGV[0] eq "-o3") {
+  $o3 = 1;
+  shift @ARGV;
+}
+die ("usage: trace2konata.pl [-o3] <trace> [<output>]\n") unless (@ARGV == 1 || @ARGV == 2);
+
+# TraceRec: seq, pc, ins, fetch, decode, ex, mem, done, stall, flags
+$RECLEN = 64;
+$SQUASHED = 0x01;
+# flags bit b+1: decode stall charged to CPI stack bucket b (mips.h)
+@buckets = qw(base load-use raw hilo branch syscall icache dcache struct other);
+
+open (IN, "<$ARGV[0]") || die ("cannot open $ARGV[0]\n");
+binmode (IN);
+@recs = ();
+while (read (IN, $buf, $RECLEN) == $RECLEN) {
+  my @f = unpack ("q I I q q q q q I I", $buf);
+  push @recs, \@f;
+}
+close (IN);
+
+if (@ARGV == 2) {
+  open (OUT, ">$ARGV[1]") || die ("cannot open $ARGV[1]\n");
+} else {
+  open (OUT, ">&STDOUT");
+}
+
+# records are written at retire/squash; number instructions in fetch order
+@recs = sort { $a->[0] <=> $b->[0] } @recs;
+
+if ($o3) {
+  foreach $r (@recs) {
+    my ($seq, $pc, $ins, $fetch, $dec, $ex, $mem, $done, $stall, $flags) = @$r;
+    my $squashed = $flags & $SQUASHED;
+    my $complete = $mem ? $mem : $ex;
+    printf OUT ("O3PipeView:fetch:%d:0x%08x:0:%d:%08x\n", $fetch, $pc, $seq, $ins);
+    printf OUT ("O3PipeView:decode:%d\n", $dec);
+    printf OUT ("O3PipeView:rename:%d\n", $dec);
+    printf OUT ("O3PipeView:dispatch:%d\n", $dec);
+    printf OUT ("O3PipeView:issue:%d\n", $ex);
+    printf OUT ("O3PipeView:complete:%d\n", $complete);
+    printf OUT ("O3PipeView:retire:%d:store:0\n", $squashed ? 0 : $done);
+  }
+  close (OUT);
+  exit (0);
+}
+
+# Konata: collect (cycle, order, line) events, then emit them in time order
+@ev = ();
+$id = 0;
+$rid = 0;
+foreach $r (sort { $a->[7] <=> $b->[7] || $a->[0] <=> $b->[0] } @recs) {
+  $r->[10] = $r->[9] & $SQUASHED ? -1 : $rid++;
+}
+foreach $r (@recs) {
+  my ($seq, $pc, $ins, $fetch, $dec, $ex, $mem, $done, $stall, $flags) = @$r;
+  my $squashed = $flags & $SQUASHED;
+  my @why = ();
+  for ($b = 0; $b < @buckets; $b++) {
+    push @why, $buckets[$b] if ($flags & (2 << $b));
+  }
+
+  push @ev, [$fetch, $id, 0, "I\t$id\t$seq\t0"];
+  push @ev, [$fetch, $id, 1, sprintf ("L\t%d\t0\t%08x: %08x", $id, $pc, $ins)];
+  if ($stall) {
+    push @ev, [$fetch, $id, 2, "L\t$id\t1\tdecode stall $stall (" . join (",", @why) . ")"];
+  }
+
+  # each stage lasts until the next one it reached
+  my @st = (["F", $fetch], ["D", $dec], ["X", $ex], ["M", $mem]);
+  push @st, ["W", $done] unless ($squashed);
+  @st = ($st[0], grep { $_->[1] } @st[1 .. $#st]); # fetch may be cycle 0
+  my $end = $squashed ? $done : $done + 1;
+  for ($i = 0; $i < @st; $i++) {
+    my $t = $i + 1 < @st ? $st[$i + 1][1] : $end;
+    push @ev, [$st[$i][1], $id, 4, "S\t$id\t0\t$st[$i][0]"];
+    push @ev, [$t, $id, 3, "E\t$id\t0\t$st[$i][0]"];
+  }
+  if ($squashed) {
+    push @ev, [$end, $id, 5, "R\t$id\t0\t1"];
+  } else {
+    push @ev, [$end, $id, 5, "R\t$id\t$r->[10]\t0"];
+  }
+  $id++;
+}
+
+@ev = sort { $a->[0] <=> $b->[0] || $a->[2] <=> $b->[2] || $a->[1] <=> $b->[1] } @ev;
+print OUT ("Kanata\t0004\n");
+$now = @ev ? $ev[0][0] : 0;
+print OUT ("C=\t$now\n");
+foreach $e (@ev) {
+  if ($e->[0] > $now) {
+    print OUT ("C\t" . ($e->[0] - $now) . "\n");
+    $now = $e->[0];
+  }
+  print OUT ("$e->[3]\n");
+}
+close (OUT);
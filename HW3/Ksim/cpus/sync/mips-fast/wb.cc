@@ -1,4 +1,6 @@
 #include "wb.h"
+#include "checker.h"
+#include "trace.h"
 
 Writeback::Writeback(Mipc *mc)
 {
@@ -18,79 +20,99 @@ void Writeback::MainLoop(void)
    Bool isIllegalOp;
    unsigned decodedDST;
    unsigned opResultLo, opResultHi;
+   int k;
 
    while (1)
    {
       AWAIT_P_PHI0; // @posedge
-
-      _mc->MEM_WB_NXT = _mc->MEM_WB_CUR;
-
-      // Sample the important signals
-      writeReg = _mc->MEM_WB_NXT._writeREG;
-      writeFReg = _mc->MEM_WB_NXT._writeFREG;
-      loWPort = _mc->MEM_WB_NXT._loWPort;
-      hiWPort = _mc->MEM_WB_NXT._hiWPort;
-      decodedDST = _mc->MEM_WB_NXT._decodedDST;
-      opResultLo = _mc->MEM_WB_NXT._opResultLo;
-      opResultHi = _mc->MEM_WB_NXT._opResultHi;
-      isSyscall = _mc->MEM_WB_NXT._isSyscall;
-      isIllegalOp = _mc->MEM_WB_NXT._isIllegalOp;
-      ins = _mc->MEM_WB_NXT._ins;
-
-      if (isSyscall)
-      {
-#ifdef MIPC_DEBUG
-         fprintf(_mc->_debugLog, "<%llu> SYSCALL! Trapping to emulation layer at PC %#x\n", SIM_TIME, _mc->_pc);
-#endif
-         _mc->MEM_WB_NXT._opControl(_mc, ins);
-         _mc->_pc = _mc->MEM_WB_NXT._pc + 4;
-         _mc->_waitForSyscall = FALSE;
-      }
-      else if (isIllegalOp)
+      if (_mc->_memStall)
       {
-         printf("Illegal ins %#x at PC %#x. Terminating simulation!\n", ins, _mc->_pc);
-#ifdef MIPC_DEBUG
-         fclose(_mc->_debugLog);
-#endif
-         printf("Register state on termination:\n\n");
-         _mc->dumpregs();
-         exit(0);
+         AWAIT_P_PHI1; // frozen behind a D-cache miss
+         continue;
       }
-      else
+
+      // retire the group in program order
+      for (k = 0; k < _mc->_issueWidth; k++)
       {
-         if (writeReg)
+         if (_mc->MEM_WB_CUR[k]._isNOP)
+            continue;
+         _mc->MEM_WB_NXT = &_mc->MEM_WB_CUR[k];
+
+         // Sample the important signals
+         writeReg = _mc->MEM_WB_NXT->_writeREG;
+         writeFReg = _mc->MEM_WB_NXT->_writeFREG;
+         loWPort = _mc->MEM_WB_NXT->_loWPort;
+         hiWPort = _mc->MEM_WB_NXT->_hiWPort;
+         decodedDST = _mc->MEM_WB_NXT->_decodedDST;
+         opResultLo = _mc->MEM_WB_NXT->_opResultLo;
+         opResultHi = _mc->MEM_WB_NXT->_opResultHi;
+         isSyscall = _mc->MEM_WB_NXT->_isSyscall;
+         isIllegalOp = _mc->MEM_WB_NXT->_isIllegalOp;
+         ins = _mc->MEM_WB_NXT->_ins;
+
+         if (isSyscall)
          {
-            _mc->_gpr[decodedDST] = opResultLo;
 #ifdef MIPC_DEBUG
-            fprintf(_mc->_debugLog, "<%llu> Writing to reg %u, value: %#x\n", SIM_TIME, decodedDST, opResultLo);
+            fprintf(_mc->_debugLog, "<%llu> SYSCALL! Trapping to emulation layer at PC %#x\n", SIM_TIME, _mc->_pc);
 #endif
+            _mc->MEM_WB_NXT->_opControl(_mc, ins);
+            _mc->_pc = _mc->MEM_WB_NXT->_pc + 4;
+            _mc->_waitForSyscall = FALSE;
          }
-         else if (writeFReg)
+         else if (isIllegalOp)
          {
-            _mc->_fpr[(decodedDST) >> 1].l[FP_TWIDDLE ^ ((decodedDST) & 1)] = opResultLo;
+            printf("Illegal ins %#x at PC %#x. Terminating simulation!\n", ins, _mc->_pc);
 #ifdef MIPC_DEBUG
-            fprintf(_mc->_debugLog, "<%llu> Writing to freg %u, value: %#x\n", SIM_TIME, decodedDST >> 1, opResultLo);
+            fclose(_mc->_debugLog);
 #endif
+            printf("Register state on termination:\n\n");
+            _mc->dumpregs();
+            TRACE_FLUSH(_mc);
+            exit(0);
          }
-         else if (loWPort || hiWPort)
+         else
          {
-            if (loWPort)
+            if (writeReg)
             {
-               _mc->_lo = opResultLo;
+               _mc->_gpr[decodedDST] = opResultLo;
 #ifdef MIPC_DEBUG
-               fprintf(_mc->_debugLog, "<%llu> Writing to Lo, value: %#x\n", SIM_TIME, opResultLo);
+               fprintf(_mc->_debugLog, "<%llu> Writing to reg %u, value: %#x\n", SIM_TIME, decodedDST, opResultLo);
 #endif
             }
-            if (hiWPort)
+            else if (writeFReg)
             {
-               _mc->_hi = opResultHi;
+               _mc->_fpr[(decodedDST) >> 1].l[FP_TWIDDLE ^ ((decodedDST) & 1)] = opResultLo;
 #ifdef MIPC_DEBUG
-               fprintf(_mc->_debugLog, "<%llu> Writing to Hi, value: %#x\n", SIM_TIME, opResultHi);
+               fprintf(_mc->_debugLog, "<%llu> Writing to freg %u, value: %#x\n", SIM_TIME, decodedDST >> 1, opResultLo);
 #endif
             }
+            else if (loWPort || hiWPort)
+            {
+               if (loWPort)
+               {
+                  _mc->_lo = opResultLo;
+#ifdef MIPC_DEBUG
+                  fprintf(_mc->_debugLog, "<%llu> Writing to Lo, value: %#x\n", SIM_TIME, opResultLo);
+#endif
+               }
+               if (hiWPort)
+               {
+                  _mc->_hi = opResultHi;
+#ifdef MIPC_DEBUG
+                  fprintf(_mc->_debugLog, "<%llu> Writing to Hi, value: %#x\n", SIM_TIME, opResultHi);
+#endif
+               }
+            }
          }
+         _mc->_gpr[0] = 0;
+
+         if (_mc->_checker)
+            _mc->_checker->Retire(_mc->MEM_WB_NXT);
+         TRACE_RETIRE(_mc, *_mc->MEM_WB_NXT);
+         _mc->_nretired++;
       }
-      _mc->_gpr[0] = 0;
+      if (_mc->_checker)
+         _mc->_checker->EndGroup();
 
       AWAIT_P_PHI1; // @negedge
    }
@@ -0,0 +1,507 @@
+#include <string.h>
+#include "xlate.h"
+#include "opcodes.h"
+#include "isa.h"
+
+/*------------------------------------------------------------------------
+ *
+ *  Basic-block translation with direct-threaded dispatch
+ *
+ *  Same architectural effect as Mipc::FastForward, but each basic block
+ *  is decoded once (through DecodeStatic) into an array of TransOps and
+ *  then run with computed gotos.  Blocks are chained to their
+ *  successors, so a hot loop never goes back to the block cache.
+ *
+ *------------------------------------------------------------------------
+ */
+
+enum
+{
+   XOP_NOP,
+   XOP_ADD, XOP_AND, XOP_NOR, XOP_OR, XOP_SLL, XOP_SLLV, XOP_SLT, XOP_SLTU,
+   XOP_SRA, XOP_SRAV, XOP_SRL, XOP_SRLV, XOP_SUB, XOP_XOR,
+   XOP_DIV, XOP_DIVU, XOP_MFHI, XOP_MFLO, XOP_MTHI, XOP_MTLO, XOP_MULT, XOP_MULTU,
+   XOP_ADDI, XOP_ANDI, XOP_LUI, XOP_ORI, XOP_SLTI, XOP_SLTIU, XOP_XORI,
+   XOP_LB, XOP_LBU, XOP_LH, XOP_LHU, XOP_LWL, XOP_LW, XOP_LWR, XOP_LWC1,
+   XOP_SWC1, XOP_SB, XOP_SH, XOP_SWL, XOP_SW, XOP_SWR,
+   XOP_MTC1, XOP_MFC1,
+   XOP_BEQ, XOP_BNE, XOP_BGTZ, XOP_BLEZ, XOP_BGEZ, XOP_BLTZ, XOP_BGEZAL, XOP_BLTZAL,
+   XOP_J, XOP_JAL, XOP_JR, XOP_JALR,
+   XOP_SYSCALL,
+   XOP_END,
+   XOP_COUNT
+};
+
+// EX-stage handler -> translated op
+static struct
+{
+   void (*_handler)(Mipc *, unsigned);
+   int _xop;
+} xlate_map[] = {
+    {Mipc::func_add_addu, XOP_ADD}, {Mipc::func_and, XOP_AND}, {Mipc::func_nor, XOP_NOR},
+    {Mipc::func_or, XOP_OR}, {Mipc::func_sll, XOP_SLL}, {Mipc::func_sllv, XOP_SLLV},
+    {Mipc::func_slt, XOP_SLT}, {Mipc::func_sltu, XOP_SLTU}, {Mipc::func_sra, XOP_SRA},
+    {Mipc::func_srav, XOP_SRAV}, {Mipc::func_srl, XOP_SRL}, {Mipc::func_srlv, XOP_SRLV},
+    {Mipc::func_sub_subu, XOP_SUB}, {Mipc::func_xor, XOP_XOR}, {Mipc::func_div, XOP_DIV},
+    {Mipc::func_divu, XOP_DIVU}, {Mipc::func_mfhi, XOP_MFHI}, {Mipc::func_mflo, XOP_MFLO},
+    {Mipc::func_mthi, XOP_MTHI}, {Mipc::func_mtlo, XOP_MTLO}, {Mipc::func_mult, XOP_MULT},
+    {Mipc::func_multu, XOP_MULTU}, {Mipc::func_jalr, XOP_JALR}, {Mipc::func_jr, XOP_JR},
+    {Mipc::func_await_break, XOP_NOP}, {Mipc::func_syscall, XOP_SYSCALL},
+    {Mipc::func_addi_addiu, XOP_ADDI}, {Mipc::func_andi, XOP_ANDI}, {Mipc::func_lui, XOP_LUI},
+    {Mipc::func_ori, XOP_ORI}, {Mipc::func_slti, XOP_SLTI}, {Mipc::func_sltiu, XOP_SLTIU},
+    {Mipc::func_xori, XOP_XORI}, {Mipc::func_beq, XOP_BEQ}, {Mipc::func_bgez, XOP_BGEZ},
+    {Mipc::func_bgezal, XOP_BGEZAL}, {Mipc::func_bltzal, XOP_BLTZAL}, {Mipc::func_bltz, XOP_BLTZ},
+    {Mipc::func_bgtz, XOP_BGTZ}, {Mipc::func_blez, XOP_BLEZ}, {Mipc::func_bne, XOP_BNE},
+    {Mipc::func_j, XOP_J}, {Mipc::func_jal, XOP_JAL}, {Mipc::func_lb, XOP_LB},
+    {Mipc::func_lbu, XOP_LBU}, {Mipc::func_lh, XOP_LH}, {Mipc::func_lhu, XOP_LHU},
+    {Mipc::func_lwl, XOP_LWL}, {Mipc::func_lw, XOP_LW}, {Mipc::func_lwr, XOP_LWR},
+    {Mipc::func_lwc1, XOP_LWC1}, {Mipc::func_swc1, XOP_SWC1}, {Mipc::func_sb, XOP_SB},
+    {Mipc::func_sh, XOP_SH}, {Mipc::func_swl, XOP_SWL}, {Mipc::func_sw, XOP_SW},
+    {Mipc::func_swr, XOP_SWR}, {Mipc::func_mtc1, XOP_MTC1}, {Mipc::func_mfc1, XOP_MFC1},
+    {NULL, XOP_NOP}};
+
+#define X_FPR(r) (_fpr[(r) >> 1].l[FP_TWIDDLE ^ ((r) & 1)])
+
+/*
+ * Fill in one op from a static decode
+ */
+static void xlate_op(TransOp *op, DecodedIns *d, unsigned int pc, void **optab)
+{
+   int i, xop;
+
+   xop = XOP_NOP;
+   for (i = 0; xlate_map[i]._handler; i++)
+      if (xlate_map[i]._handler == d->_opControl)
+      {
+         xop = xlate_map[i]._xop;
+         break;
+      }
+
+   op->_d = d->_decodedDST;
+   op->_s = d->_src1Idx;
+   op->_t = d->_src2Idx;
+   op->_imm = d->_decodedSRC2;
+
+   switch (xop)
+   {
+   case XOP_SLL:
+   case XOP_SRA:
+   case XOP_SRL:
+      op->_imm = d->_decodedShiftAmt;
+      break;
+   case XOP_ADDI:
+   case XOP_SLTI:
+   case XOP_SLTIU:
+   case XOP_LB: case XOP_LBU: case XOP_LH: case XOP_LHU:
+   case XOP_LWL: case XOP_LW: case XOP_LWR: case XOP_LWC1:
+   case XOP_SWC1: case XOP_SB: case XOP_SH: case XOP_SWL: case XOP_SW: case XOP_SWR:
+      op->_imm = ISA_SEXT16(d->_decodedSRC2);
+      break;
+   case XOP_LUI:
+      op->_imm = (unsigned)d->_decodedSRC2 << 16;
+      break;
+   case XOP_JAL:
+   case XOP_JALR:
+   case XOP_BGEZAL:
+   case XOP_BLTZAL:
+      op->_imm = pc + 8; // link address
+      break;
+   case XOP_SYSCALL:
+      op->_imm = pc;
+      break;
+   }
+
+   // writes to $0 are dropped here instead of re-zeroing it every op
+   if (d->_writeREG && op->_d == 0)
+   {
+      if (xop == XOP_JALR)
+         xop = XOP_JR;
+      else if (xop != XOP_BGEZAL && xop != XOP_BLTZAL && xop != XOP_JAL)
+         xop = XOP_NOP;
+   }
+
+   op->_op = optab[xop];
+}
+
+/*
+ * Translate the block starting at "pc" into "b"
+ */
+void Mipc::XlateBlock(unsigned int pc, TransBlock *b, void **optab)
+{
+   DecodedIns d, ds;
+   unsigned int ins, a;
+   unsigned n;
+
+   b->_pc = pc;
+   b->_btgt = 0;
+   b->_gen = _xlateGen;
+   b->_chain[0] = NULL;
+   b->_chain[1] = NULL;
+
+   n = 0;
+   while (n < XLATE_MAX_INS)
+   {
+      a = pc + 4 * n;
+      ins = ISA_LW(_mem, a);
+      DecodeStatic(a, ins, &d);
+      if (d._isIllegalOp)
+         break;
+
+      if (d._bdslot)
+      {
+         // the branch and its delay slot always go together
+         if (n + 2 > XLATE_MAX_INS)
+            break;
+         ins = ISA_LW(_mem, a + 4);
+         DecodeStatic(a + 4, ins, &ds);
+         if (ds._isIllegalOp || ds._bdslot || ds._isSyscall)
+            break;
+         xlate_op(&b->_ops[n], &d, a, optab);
+         xlate_op(&b->_ops[n + 1], &ds, a + 4, optab);
+         b->_btgt = d._btgt;
+         n += 2;
+         break;
+      }
+
+      xlate_op(&b->_ops[n], &d, a, optab);
+      n++;
+      if (d._isSyscall)
+         break;
+   }
+
+   b->_nins = n;
+   b->_npc = pc + 4 * n;
+   b->_ops[n]._op = optab[XOP_END];
+
+   // remember which pages hold translated code
+   a = pc;
+   _xlatePages[a >> 17] |= 1U << ((a >> 12) & 31);
+   a = pc + 4 * n;
+   _xlatePages[a >> 17] |= 1U << ((a >> 12) & 31);
+
+   _nxblocks++;
+}
+
+/*
+ * Drop every translation
+ */
+void Mipc::XlateFlush(void)
+{
+   _xlateGen++;
+   memset(_xlatePages, 0, XLATE_PAGE_WORDS * sizeof(unsigned));
+   _nxflush++;
+}
+
+/*
+ * Translated counterpart of Mipc::FastForward, with the same stopping
+ * rules.  Blocks that would run past the instruction limit or that hold
+ * stopPC are single-stepped through FastForward instead.
+ */
+LL Mipc::XlateRun(LL ninsn, unsigned int stopPC)
+{
+   static void *optab[XOP_COUNT] = {
+       &&op_nop,
+       &&op_add, &&op_and, &&op_nor, &&op_or, &&op_sll, &&op_sllv, &&op_slt, &&op_sltu,
+       &&op_sra, &&op_srav, &&op_srl, &&op_srlv, &&op_sub, &&op_xor,
+       &&op_div, &&op_divu, &&op_mfhi, &&op_mflo, &&op_mthi, &&op_mtlo, &&op_mult, &&op_multu,
+       &&op_addi, &&op_andi, &&op_lui, &&op_ori, &&op_slti, &&op_sltiu, &&op_xori,
+       &&op_lb, &&op_lbu, &&op_lh, &&op_lhu, &&op_lwl, &&op_lw, &&op_lwr, &&op_lwc1,
+       &&op_swc1, &&op_sb, &&op_sh, &&op_swl, &&op_sw, &&op_swr,
+       &&op_mtc1, &&op_mfc1,
+       &&op_beq, &&op_bne, &&op_bgtz, &&op_blez, &&op_bgez, &&op_bltz, &&op_bgezal, &&op_bltzal,
+       &&op_j, &&op_jal, &&op_jr, &&op_jalr,
+       &&op_syscall,
+       &&op_end};
+
+   TransBlock *b, *nb;
+   TransOp *op;
+   unsigned int pc, addr, btgt;
+   int btaken, side;
+   LL count, xcount, n;
+
+   pc = _pc;
+   count = 0;  // all instructions, including single-stepped ones
+   xcount = 0; // instructions run from translated blocks
+   b = NULL;
+   side = 0;
+   _gpr[0] = 0;
+
+#define XNEXT \
+   op++;      \
+   goto *op->_op
+
+   while (!_sim_exit)
+   {
+      if (ninsn && count >= ninsn)
+         break;
+      if (stopPC && pc == stopPC)
+         break;
+
+      // follow the chain from the previous block, else look it up
+      nb = b ? b->_chain[side] : NULL;
+      if (nb && nb->_pc == pc && nb->_gen == _xlateGen)
+         _nxchained++;
+      else
+      {
+         nb = &_xcache[(pc >> 2) & _xcacheMask];
+         if (nb->_gen != _xlateGen || nb->_pc != pc)
+            XlateBlock(pc, nb, optab);
+         if (b && b->_gen == _xlateGen)
+            b->_chain[side] = nb;
+      }
+
+      if (nb->_nins == 0 || (ninsn && count + nb->_nins > ninsn) ||
+          (stopPC && stopPC - nb->_pc < 4 * nb->_nins))
+      {
+         n = nb->_nins ? nb->_nins : 1;
+         if (ninsn && ninsn - count < n)
+            n = ninsn - count;
+         _pc = pc;
+         n = FastForward(n, stopPC);
+         pc = _pc;
+         count += n;
+         b = NULL;
+         if (n == 0)
+            break;
+         continue;
+      }
+
+      b = nb;
+      btaken = 0;
+      btgt = b->_btgt;
+      op = b->_ops;
+      goto *op->_op;
+
+   op_nop:
+      XNEXT;
+   op_add:
+      _gpr[op->_d] = _gpr[op->_s] + _gpr[op->_t];
+      XNEXT;
+   op_and:
+      _gpr[op->_d] = _gpr[op->_s] & _gpr[op->_t];
+      XNEXT;
+   op_nor:
+      _gpr[op->_d] = ~(_gpr[op->_s] | _gpr[op->_t]);
+      XNEXT;
+   op_or:
+      _gpr[op->_d] = _gpr[op->_s] | _gpr[op->_t];
+      XNEXT;
+   op_sll:
+      _gpr[op->_d] = _gpr[op->_t] << op->_imm;
+      XNEXT;
+   op_sllv:
+      _gpr[op->_d] = _gpr[op->_t] << (_gpr[op->_s] & 0x1f);
+      XNEXT;
+   op_slt:
+      _gpr[op->_d] = ((signed int)_gpr[op->_s] < (signed int)_gpr[op->_t]);
+      XNEXT;
+   op_sltu:
+      _gpr[op->_d] = (_gpr[op->_s] < _gpr[op->_t]);
+      XNEXT;
+   op_sra:
+      _gpr[op->_d] = (signed int)_gpr[op->_t] >> op->_imm;
+      XNEXT;
+   op_srav:
+      _gpr[op->_d] = (signed int)_gpr[op->_t] >> (_gpr[op->_s] & 0x1f);
+      XNEXT;
+   op_srl:
+      _gpr[op->_d] = _gpr[op->_t] >> op->_imm;
+      XNEXT;
+   op_srlv:
+      _gpr[op->_d] = _gpr[op->_t] >> (_gpr[op->_s] & 0x1f);
+      XNEXT;
+   op_sub:
+      _gpr[op->_d] = _gpr[op->_s] - _gpr[op->_t];
+      XNEXT;
+   op_xor:
+      _gpr[op->_d] = _gpr[op->_s] ^ _gpr[op->_t];
+      XNEXT;
+   op_div:
+      ISA_DIV(_hi, _lo, _gpr[op->_s], _gpr[op->_t]);
+      XNEXT;
+   op_divu:
+      ISA_DIVU(_hi, _lo, _gpr[op->_s], _gpr[op->_t]);
+      XNEXT;
+   op_mfhi:
+      _gpr[op->_d] = _hi;
+      XNEXT;
+   op_mflo:
+      _gpr[op->_d] = _lo;
+      XNEXT;
+   op_mthi:
+      _hi = _gpr[op->_s];
+      XNEXT;
+   op_mtlo:
+      _lo = _gpr[op->_s];
+      XNEXT;
+   op_mult:
+      ISA_MULT(_hi, _lo, _gpr[op->_s], _gpr[op->_t]);
+      XNEXT;
+   op_multu:
+      ISA_MULTU(_hi, _lo, _gpr[op->_s], _gpr[op->_t]);
+      XNEXT;
+   op_addi:
+      _gpr[op->_d] = _gpr[op->_s] + op->_imm;
+      XNEXT;
+   op_andi:
+      _gpr[op->_d] = _gpr[op->_s] & op->_imm;
+      XNEXT;
+   op_lui:
+      _gpr[op->_d] = op->_imm;
+      XNEXT;
+   op_ori:
+      _gpr[op->_d] = _gpr[op->_s] | op->_imm;
+      XNEXT;
+   op_slti:
+      _gpr[op->_d] = ((signed int)_gpr[op->_s] < op->_imm);
+      XNEXT;
+   op_sltiu:
+      _gpr[op->_d] = (_gpr[op->_s] < (unsigned)op->_imm);
+      XNEXT;
+   op_xori:
+      _gpr[op->_d] = _gpr[op->_s] ^ op->_imm;
+      XNEXT;
+
+   op_lb:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LB(_mem, addr);
+      XNEXT;
+   op_lbu:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LBU(_mem, addr);
+      XNEXT;
+   op_lh:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LH(_mem, addr);
+      XNEXT;
+   op_lhu:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LHU(_mem, addr);
+      XNEXT;
+   op_lwl:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LWL(_mem, addr, _gpr[op->_d]);
+      XNEXT;
+   op_lw:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LW(_mem, addr);
+      XNEXT;
+   op_lwr:
+      addr = _gpr[op->_s] + op->_imm;
+      _gpr[op->_d] = ISA_LWR(_mem, addr, _gpr[op->_d]);
+      XNEXT;
+   op_lwc1:
+      addr = _gpr[op->_s] + op->_imm;
+      X_FPR(op->_d) = ISA_LW(_mem, addr);
+      XNEXT;
+
+      // stores use _d as the value register (rt), like the pipeline
+   op_swc1:
+      addr = _gpr[op->_s] + op->_imm;
+      ISA_SW(_mem, addr, X_FPR(op->_d));
+      goto store_done;
+   op_sb:
+      addr = _gpr[op->_s] + op->_imm;
+      ISA_SB(_mem, addr, _gpr[op->_d]);
+      goto store_done;
+   op_sh:
+      addr = _gpr[op->_s] + op->_imm;
+      ISA_SH(_mem, addr, _gpr[op->_d]);
+      goto store_done;
+   op_swl:
+      addr = _gpr[op->_s] + op->_imm;
+      ISA_SWL(_mem, addr, _gpr[op->_d]);
+      goto store_done;
+   op_sw:
+      addr = _gpr[op->_s] + op->_imm;
+      ISA_SW(_mem, addr, _gpr[op->_d]);
+      goto store_done;
+   op_swr:
+      addr = _gpr[op->_s] + op->_imm;
+      ISA_SWR(_mem, addr, _gpr[op->_d]);
+      goto store_done;
+   store_done:
+      CodeStore(addr);
+      if (b->_gen == _xlateGen)
+      {
+         XNEXT;
+      }
+      // self-modifying code: leave the block right after the store
+      n = op - b->_ops + 1;
+      if (n == b->_nins)
+         goto op_end;
+      xcount += n;
+      count += n;
+      pc = b->_pc + 4 * n;
+      b = NULL;
+      continue;
+
+   op_mtc1:
+      X_FPR(op->_d) = _gpr[op->_s];
+      XNEXT;
+   op_mfc1:
+      _gpr[op->_d] = X_FPR(op->_s);
+      XNEXT;
+
+   op_beq:
+      btaken = (_gpr[op->_s] == _gpr[op->_t]);
+      XNEXT;
+   op_bne:
+      btaken = (_gpr[op->_s] != _gpr[op->_t]);
+      XNEXT;
+   op_bgtz:
+      btaken = ((signed int)_gpr[op->_s] > 0);
+      XNEXT;
+   op_blez:
+      btaken = ((signed int)_gpr[op->_s] <= 0);
+      XNEXT;
+   op_bgez:
+      btaken = ((signed int)_gpr[op->_s] >= 0);
+      XNEXT;
+   op_bltz:
+      btaken = ((signed int)_gpr[op->_s] < 0);
+      XNEXT;
+   op_bgezal:
+      btaken = ((signed int)_gpr[op->_s] >= 0);
+      _gpr[31] = op->_imm;
+      XNEXT;
+   op_bltzal:
+      btaken = ((signed int)_gpr[op->_s] < 0);
+      _gpr[31] = op->_imm;
+      XNEXT;
+   op_j:
+      btaken = 1;
+      XNEXT;
+   op_jal:
+      btaken = 1;
+      _gpr[31] = op->_imm;
+      XNEXT;
+   op_jr:
+      btaken = 1;
+      btgt = _gpr[op->_s];
+      XNEXT;
+   op_jalr:
+      btaken = 1;
+      btgt = _gpr[op->_s];
+      _gpr[op->_d] = op->_imm;
+      XNEXT;
+
+   op_syscall:
+      _pc = op->_imm;
+      fake_syscall(op->_imm);
+      _gpr[0] = 0;
+      XNEXT;
+
+   op_end:
+      xcount += b->_nins;
+      count += b->_nins;
+      side = btaken;
+      pc = btaken ? btgt : b->_npc;
+   }
+
+#undef XNEXT
+
+   _pc = pc;
+   _nfastfwd += xcount;
+   return count;
+}
@@ -0,0 +1,39 @@
+#ifndef __XLATE_H__
+#define __XLATE_H__
+
+#include "mips.h"
+
+/*
+ * Basic-block translation for the functional path.
+ *
+ * A block is a straight-line run of instructions ending with a control
+ * transfer and its delay slot, a syscall, or XLATE_MAX_INS instructions.
+ * Each instruction becomes one TransOp holding the address of its handler
+ * label inside Mipc::XlateRun (direct-threaded dispatch) and its
+ * pre-extracted operands.  Blocks live in a direct-mapped cache on the
+ * block PC and remember their successors (chaining).
+ */
+
+#define XLATE_MAX_INS 32
+
+typedef struct
+{
+   void *_op; // handler label
+   unsigned _d, _s, _t;
+   signed int _imm;
+} TransOp;
+
+struct TransBlock
+{
+   unsigned int _pc;     // address of first instruction
+   unsigned int _npc;    // fall-through successor
+   unsigned int _btgt;   // static branch target, if any
+   unsigned _nins;       // instructions in the block
+   unsigned _gen;        // == Mipc::_xlateGen while valid
+
+   TransBlock *_chain[2]; // cached successors: [0] fall-through, [1] taken
+
+   TransOp _ops[XLATE_MAX_INS + 1]; // last op is always the block exit
+};
+
+#endif /* __XLATE_H__ */
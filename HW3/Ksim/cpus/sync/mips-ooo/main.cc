@@ -0,0 +1,119 @@
+#include "mips.h"
+#include "ooo.h"
+#include "tasking.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void cleanup(void)
+{
+   Log::CloseLog();
+}
+
+#define SIZE 256
+
+int main(int argc, char **argv)
+{
+   Mipc *processor_top;
+   Ooo *ooo;
+   Mem *m;
+   char buf[SIZE];
+   char *fname, *cname;
+   Bool l, c;
+
+   l = FALSE;
+   c = FALSE;
+
+   RegisterDefault("Mipc.BootROM", "mipc.image");
+   RegisterDefault("Mipc.BootPC", (int)0xbfc00000);
+   RegisterDefault("Mipc.ArgvAddr", (int)0xbfc00100);
+   RegisterDefault("Mipc.CacheLineToWatch", 0x1ULL);
+   RegisterDefault("Log.FileName", "mipc.log");
+   RegisterDefault("Log.Level", "");
+   RegisterDefault("MemSystem.Type", "None");
+   RegisterDefault("Log.StartDumpTime", 0);
+   RegisterDefault("Mipc.PeriodicTimer", 100000);
+   Mipc::RegisterDefaults();
+   RegisterDefault("Ooo.FetchQueue", 16);
+   RegisterDefault("Ooo.ROBSize", 64);
+   RegisterDefault("Ooo.RSSize", 32);
+   RegisterDefault("Ooo.LSQSize", 16);
+   RegisterDefault("Ooo.PhysRegs", 64);
+   RegisterDefault("Ooo.LoadLatency", 2);
+
+   /* fixup arguments */
+   if (argc > 1)
+   {
+      if (argv[1][0] == '-' && argv[1][1] == 'l')
+      {
+         l = TRUE;
+         argv++;
+         argc--;
+         MALLOC(fname, char, strlen(argv[1]) + 1);
+         sprintf(fname, "%s", argv[1]);
+         argc--;
+         argv++;
+      }
+   }
+
+   if (argc > 1)
+   {
+      if (argv[1][0] == '-' && argv[1][1] == 'c')
+      {
+         c = TRUE;
+         argv++;
+         argc--;
+         MALLOC(cname, char, strlen(argv[1]) + 1);
+         sprintf(cname, "%s", argv[1]);
+         argc--;
+         argv++;
+         printf("conf file name is %s\n", cname);
+      }
+   }
+
+   if (!c)
+   {
+      ReadConfigFile();
+   }
+   else
+   {
+      ReadConfigFile(cname);
+   }
+
+   logTimer = ParamGetLL("Log.StartDumpTime");
+
+   if (argc > 1)
+   {
+      if (strlen(argv[1]) > SIZE - sizeof(".image"))
+      {
+         fatal_error("Pathname `%s' too long!\n", argv[1]);
+      }
+      sprintf(buf, "%s.image", argv[1]);
+      if (access(buf, R_OK) != 0 && access(argv[1], R_OK) == 0)
+         sprintf(buf, "%s", argv[1]); // e.g. prog.ld, an executable Reboot loads directly
+      OverrideConfig("Mipc.BootROM", buf);
+      argc--;
+      argv++;
+   }
+
+   if (!l)
+   {
+      Log::OpenLog(ParamGetString("Log.FileName"));
+   }
+   else
+   {
+      Log::OpenLog(fname);
+   }
+
+   m = new Mem();
+
+   processor_top = new Mipc(m);
+   ooo = new Ooo(processor_top);
+   SimCreateTask(ooo, "OOO"); // Mipc's own pipeline is not scheduled
+
+   /* there are arguments! */
+   if (argc > 0)
+      processor_top->_sys->ArgumentSetup(argc, argv, ParamGetInt("Mipc.ArgvAddr"));
+
+   simulate(cleanup);
+}
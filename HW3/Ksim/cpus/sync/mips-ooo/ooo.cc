@@ -0,0 +1,596 @@
+#include "ooo.h"
+#include "checker.h"
+#include "bpred.h"
+#include "cache.h"
+#include "trace.h"
+
+#define OOO_NEVER 0x7fffffffffffffffLL // _pregReady of a pending result
+
+#define IS_SYSCALL(ins) (((ins) >> 26) == 0 && ((ins) & 0x3f) == 0xc)
+#define DWORD_OF(e) ((LL)(e)->_r._memory_addr_reg & ~(LL)0x7)
+
+Ooo::Ooo(Mipc *mc)
+{
+   _mc = mc;
+
+   _fqSize = ParamGetInt("Ooo.FetchQueue");
+   _robSize = ParamGetInt("Ooo.ROBSize");
+   _rsSize = ParamGetInt("Ooo.RSSize");
+   _lsqSize = ParamGetInt("Ooo.LSQSize");
+   _npreg = OOO_NARCH + ParamGetInt("Ooo.PhysRegs");
+   _loadLatency = ParamGetInt("Ooo.LoadLatency");
+
+   if (_fqSize < _mc->_issueWidth)
+      fatal_error("Ooo.FetchQueue must hold at least Mipc.IssueWidth instructions");
+   if (_robSize < 1 || _rsSize < 1 || _lsqSize < 1)
+      fatal_error("Ooo.ROBSize, Ooo.RSSize and Ooo.LSQSize must be positive");
+   if (_npreg < OOO_NARCH + 2)
+      fatal_error("Ooo.PhysRegs must be at least 2");
+   if (_loadLatency < 1)
+      fatal_error("Ooo.LoadLatency must be at least one cycle");
+
+   _fq = new PipeReg[_fqSize];
+   _rob = new RobEntry[_robSize];
+   _preg = new unsigned[_npreg];
+   _pregReady = new LL[_npreg];
+   _free = new int[_npreg];
+
+   _robFull = 0;
+   _rsFull = 0;
+   _lsqFull = 0;
+   _regFull = 0;
+   _lsqWait = 0;
+   _robOccupancy = 0;
+}
+
+Ooo::~Ooo(void)
+{
+   delete[] _fq;
+   delete[] _rob;
+   delete[] _preg;
+   delete[] _pregReady;
+   delete[] _free;
+}
+
+/*
+ * Architectural register "a" of Mipc: 0-31 gpr, 32-63 single fp halves,
+ * then hi and lo
+ */
+static unsigned arch_read(Mipc *mc, int a)
+{
+   if (a < 32)
+      return mc->_gpr[a];
+   if (a < 64)
+      return mc->_fpr[(a - 32) >> 1].l[FP_TWIDDLE ^ ((a - 32) & 1)];
+   return a == OOO_HI ? mc->_hi : mc->_lo;
+}
+
+static void arch_write(Mipc *mc, int a, unsigned v)
+{
+   if (a < 32)
+      mc->_gpr[a] = v;
+   else if (a < 64)
+      mc->_fpr[(a - 32) >> 1].l[FP_TWIDDLE ^ ((a - 32) & 1)] = v;
+   else if (a == OOO_HI)
+      mc->_hi = v;
+   else
+      mc->_lo = v;
+}
+
+// Empty machine, identity rename map over Mipc's registers
+void Ooo::Sync(void)
+{
+   int a, p;
+
+   for (a = 0; a < OOO_NARCH; a++)
+   {
+      _map[a] = a;
+      _cmap[a] = a;
+      _preg[a] = arch_read(_mc, a);
+      _pregReady[a] = 0;
+   }
+   _nfree = 0;
+   for (p = OOO_NARCH; p < _npreg; p++)
+      _free[_nfree++] = p;
+
+   _fqHead = 0;
+   _fqCount = 0;
+   _fetchHalt = FALSE;
+   _dsResolved = FALSE;
+   _robHead = 0;
+   _robCount = 0;
+   _rsUsed = 0;
+   _lsqUsed = 0;
+}
+
+void Ooo::MainLoop(void)
+{
+   Assert(_mc->_boot, "Ooo::MainLoop() called without boot?");
+
+   _mc->_nfetched = 0;
+   _mc->_nretired = 0;
+
+   // Skip ahead functionally, then hand off to the core at _pc
+   if (ParamGetLL("Mipc.FastForward") || ParamGetInt("Mipc.FastForwardPC"))
+   {
+      if (_mc->_xlateEnabled)
+         _mc->XlateRun(ParamGetLL("Mipc.FastForward"), ParamGetInt("Mipc.FastForwardPC"));
+      else
+         _mc->FastForward(ParamGetLL("Mipc.FastForward"), ParamGetInt("Mipc.FastForwardPC"));
+      _mc->_l.print("Fast-forwarded %llu instructions, detailed simulation starts at PC %#x", _mc->_nfastfwd, _mc->_pc);
+   }
+
+   if (ParamGetBool("Mipc.Check"))
+      _mc->_checker = new Checker(_mc);
+
+   Sync();
+
+   while (!_mc->_sim_exit)
+   {
+      AWAIT_P_PHI0; // @posedge
+      // back to front, so an instruction spends at least a cycle per step
+      Commit();
+      Issue();
+      Dispatch();
+      Fetch();
+      _robOccupancy += _robCount;
+      AWAIT_P_PHI1; // @negedge
+   }
+
+   TRACE_FLUSH(_mc);
+   _mc->MipcDumpstats();
+   OooDumpstats();
+   Log::CloseLog();
+   exit(0);
+}
+
+void Ooo::Fetch(void)
+{
+   unsigned int ins;
+   PipeReg *r;
+   int n, wait;
+
+   if (_mc->_fetchStall > 0)
+   {
+      _mc->_fetchStall--;
+      _mc->_icacheStalls++;
+      return;
+   }
+
+   for (n = 0; n < _mc->_issueWidth && _fqCount < _fqSize; n++)
+   {
+      if (_fetchHalt || _mc->_branchInterlock)
+         break;
+      if (_mc->_l1i)
+      {
+         if (_mc->_pc == _mc->_fetchFillPC)
+            _mc->_fetchFillPC = 1; // line has just arrived
+         else if ((wait = _mc->_l1i->Access(_mc->_pc, FALSE, _mc->_pc)) > 0)
+         {
+            _mc->_fetchStall = wait;
+            _mc->_fetchFillPC = _mc->_pc;
+            break;
+         }
+      }
+      ins = _mc->_mem->BEGetWord(_mc->_pc, _mc->_mem->Read(_mc->_pc & ~(LL)0x7));
+
+      r = &_fq[(_fqHead + _fqCount++) % _fqSize];
+      r->clear();
+      r->_pc = _mc->_pc;
+      r->_ins = ins;
+      r->_isNOP = FALSE;
+      r->_seq = ++_mc->_fetchSeq;
+      r->_fetchCycle = SIM_TIME;
+      _mc->_pc += 4;
+
+      if (_mc->_fetchDelaySlot)
+      {
+         _mc->_fetchDelaySlot = FALSE;
+         if (_mc->_bpred || _dsResolved)
+            _mc->_pc = _mc->_predNPC;
+         else
+            _mc->_branchInterlock = TRUE;
+         _dsResolved = FALSE;
+      }
+      else if (Mipc::IsCTI(ins))
+      {
+         _mc->_fetchDelaySlot = TRUE;
+         if (_mc->_bpred)
+         {
+            r->_predHist = _mc->_bpred->History();
+            r->_predNPC = _mc->_predNPC = _mc->_bpred->Predict(r->_pc, ins);
+         }
+      }
+
+      if (IS_SYSCALL(ins))
+      {
+         // the syscall may change anything; fetch again after it commits
+         _fetchHalt = TRUE;
+         _haltSeq = r->_seq;
+      }
+   }
+}
+
+void Ooo::Dispatch(void)
+{
+   PipeReg *f;
+   RobEntry *e;
+   DecodedIns *d;
+   int n, k, need, arch[2];
+   Bool mem;
+
+   for (n = 0; n < _mc->_issueWidth && _fqCount > 0; n++)
+   {
+      if (_robCount == _robSize)
+      {
+         _robFull++;
+         break;
+      }
+      if (_rsUsed == _rsSize)
+      {
+         _rsFull++;
+         break;
+      }
+
+      f = &_fq[_fqHead];
+      _mc->IF_ID_NXT = f;
+      _mc->Dec(f->_ins, FALSE);
+      d = &_mc->_dcache[(f->_pc >> 2) & _mc->_dcacheMask];
+      PipeReg &r = *f;
+
+      mem = r._memControl && !r._isIllegalOp;
+      if (mem && _lsqUsed == _lsqSize)
+      {
+         _lsqFull++;
+         break;
+      }
+
+      arch[0] = -1;
+      arch[1] = -1;
+      if (r._isSyscall || r._isIllegalOp)
+         ; // registers are written by the emulation layer, if at all
+      else if (r._writeREG)
+      {
+         if (r._decodedDST != 0)
+            arch[0] = r._decodedDST;
+      }
+      else if (r._writeFREG)
+         arch[0] = 32 + r._decodedDST;
+      else
+      {
+         if (r._loWPort)
+            arch[0] = OOO_LO;
+         if (r._hiWPort)
+            arch[1] = OOO_HI;
+      }
+      need = (arch[0] >= 0) + (arch[1] >= 0);
+      if (_nfree < need)
+      {
+         _regFull++;
+         break;
+      }
+
+      _mc->Dec(f->_ins, TRUE); // accepted: count it
+
+      e = Rob(_robCount++);
+      _fqHead = (_fqHead + 1) % _fqSize;
+      _fqCount--;
+
+      e->_r = r;
+      TRACE_STAGE(e->_r, Decode); // dispatch
+      e->_phase = OOO_WAIT;
+      e->_readyAt = 0;
+      e->_isLoad = mem && (r._writeREG || r._writeFREG);
+      e->_isStore = mem && !e->_isLoad;
+      e->_jumpReg = d->_jumpReg;
+      e->_serial = r._isSyscall || r._isIllegalOp || d->_isSubreg;
+
+      // sources through the map before the destinations are renamed
+      if (d->_src1Sel == DEC_SRC_GPR)
+         e->_src[0] = _map[d->_src1Idx];
+      else if (d->_src1Sel == DEC_SRC_FPR)
+         e->_src[0] = _map[32 + d->_src1Idx];
+      else
+         e->_src[0] = -1;
+      e->_src[1] = d->_src2Sel == DEC_SRC_GPR ? _map[d->_src2Idx] : -1;
+      if (r._hiWrite)
+         e->_src[2] = _map[OOO_HI];
+      else if (r._loWrite)
+         e->_src[2] = _map[OOO_LO];
+      else
+         e->_src[2] = -1;
+
+      for (k = 0; k < 2; k++)
+      {
+         e->_arch[k] = arch[k];
+         e->_dst[k] = -1;
+         if (arch[k] < 0)
+            continue;
+         e->_old[k] = _map[arch[k]];
+         e->_dst[k] = _free[--_nfree];
+         _pregReady[e->_dst[k]] = OOO_NEVER;
+         _map[arch[k]] = e->_dst[k];
+      }
+
+      _rsUsed++;
+      if (mem)
+         _lsqUsed++;
+   }
+}
+
+void Ooo::Issue(void)
+{
+   RobEntry *e;
+   int i, k, issued, ports, wait;
+   Bool ready;
+
+   issued = 0;
+   ports = 0;
+   for (i = 0; i < _robCount && issued < _mc->_issueWidth; i++)
+   {
+      e = Rob(i);
+      if (e->_phase == OOO_DONE || (e->_serial && i != 0))
+         continue;
+
+      if (e->_phase == OOO_WAIT)
+      {
+         ready = TRUE;
+         for (k = 0; k < 3; k++)
+            if (e->_src[k] >= 0 && _pregReady[e->_src[k]] > SIM_TIME)
+               ready = FALSE;
+         if (!ready)
+            continue;
+         if (e->_r._hiWPort && e->_r._loWPort && !_mc->MulDivFree())
+         {
+            _mc->_mdBusyStalls++;
+            continue;
+         }
+         _rsUsed--;
+         issued++;
+         Execute(e);
+      }
+      else if (ports < _mc->_memPorts && LoadMayGo(i))
+      {
+         // OOO_ADDR load: read memory through the D-cache
+         ports++;
+         _mc->EX_MEM_NXT = &e->_r;
+         e->_r._memOp(_mc);
+         TRACE_STAGE(e->_r, Mem);
+         wait = _mc->_l1d ? _mc->_l1d->Access(e->_r._memory_addr_reg, FALSE, e->_r._pc) : 0;
+         if (wait)
+            _mc->_dcacheStalls += wait;
+         Result(e, _loadLatency + wait);
+      }
+   }
+   _mc->_issueHist[issued]++;
+}
+
+void Ooo::Execute(RobEntry *e)
+{
+   unsigned hi, lo;
+
+   _mc->ID_EX_NXT = &e->_r;
+   if (e->_src[0] >= 0)
+      e->_r._decodedSRC1 = _preg[e->_src[0]];
+   if (e->_src[1] >= 0)
+      e->_r._decodedSRC2 = _preg[e->_src[1]];
+   if (e->_jumpReg)
+      e->_r._btgt = e->_r._decodedSRC1;
+   if (e->_serial)
+      e->_r._subregOperand = _mc->_gpr[e->_r._regSRC2]; // at the head: committed
+
+   if (!e->_r._isSyscall && !e->_r._isIllegalOp && e->_r._opControl)
+   {
+      // mfhi/mflo read Mipc's _hi/_lo: present the renamed value there
+      hi = _mc->_hi;
+      lo = _mc->_lo;
+      if (e->_src[2] >= 0)
+         _mc->_hi = _mc->_lo = _preg[e->_src[2]];
+      e->_r._opControl(_mc, e->_r._ins);
+      _mc->_hi = hi;
+      _mc->_lo = lo;
+   }
+   TRACE_STAGE(e->_r, Ex); // issue
+
+   if (e->_isLoad)
+      e->_phase = OOO_ADDR;
+   else if (e->_isStore)
+   {
+      // data is read from Mipc's registers when the store commits
+      e->_phase = OOO_DONE;
+      e->_readyAt = SIM_TIME + 1;
+   }
+   else if (e->_r._hiWPort && e->_r._loWPort)
+      Result(e, _mc->MulDivStart(e->_r._opControl));
+   else
+      Result(e, 1);
+
+   if (e->_r._bdslot)
+      Resolve(e);
+}
+
+void Ooo::Result(RobEntry *e, int latency)
+{
+   e->_phase = OOO_DONE;
+   e->_readyAt = SIM_TIME + latency;
+   if (e->_dst[0] >= 0)
+   {
+      _preg[e->_dst[0]] = e->_r._opResultLo;
+      _pregReady[e->_dst[0]] = e->_readyAt;
+   }
+   if (e->_dst[1] >= 0)
+   {
+      _preg[e->_dst[1]] = e->_r._opResultHi;
+      _pregReady[e->_dst[1]] = e->_readyAt;
+   }
+}
+
+/*
+ * A load may read memory once every older store has its address and
+ * none of them writes the same dword (no store-to-load forwarding: the
+ * load waits for the store to commit)
+ */
+Bool Ooo::LoadMayGo(int pos)
+{
+   LL dw = DWORD_OF(Rob(pos));
+   RobEntry *o;
+   int i;
+
+   for (i = 0; i < pos; i++)
+   {
+      o = Rob(i);
+      if (o->_isStore && (o->_phase == OOO_WAIT || DWORD_OF(o) == dw))
+      {
+         _lsqWait++;
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+void Ooo::Resolve(RobEntry *e)
+{
+   unsigned int npc;
+
+   npc = e->_r._btaken ? e->_r._btgt : e->_r._pc + 8;
+   if (_mc->_bpred)
+   {
+      // the tables are trained at commit, in program order and only by
+      // the right path
+      if (npc == e->_r._predNPC)
+         return;
+      _mc->_nmispred++;
+      _mc->_squashCycles += SIM_TIME - e->_r._fetchCycle;
+      Squash(e->_r._seq + 1); // keep the delay slot
+   }
+   else
+      _mc->_branchInterlock = FALSE;
+
+   // redirect fetch, after the delay slot if that is still to come
+   if (_mc->_fetchDelaySlot)
+   {
+      _mc->_predNPC = npc;
+      _dsResolved = TRUE;
+   }
+   else
+      _mc->_pc = npc;
+}
+
+// Drop everything younger than "seq", youngest first, undoing renames
+void Ooo::Squash(LL seq)
+{
+   RobEntry *e;
+   int k;
+
+   while (_robCount > 0)
+   {
+      e = Rob(_robCount - 1);
+      if (e->_r._seq <= seq)
+         break;
+      TRACE_SQUASH(_mc, e->_r);
+      for (k = 1; k >= 0; k--)
+         if (e->_dst[k] >= 0)
+         {
+            _map[e->_arch[k]] = e->_old[k];
+            _free[_nfree++] = e->_dst[k];
+         }
+      if (e->_phase == OOO_WAIT)
+         _rsUsed--;
+      if (e->_isLoad || e->_isStore)
+         _lsqUsed--;
+      _robCount--;
+      _mc->_nsquashed++;
+   }
+   while (_fqCount > 0 && _fq[(_fqHead + _fqCount - 1) % _fqSize]._seq > seq)
+   {
+      TRACE_SQUASH(_mc, _fq[(_fqHead + _fqCount - 1) % _fqSize]);
+      _fqCount--;
+      _mc->_nsquashed++;
+   }
+
+   if (_fetchHalt && _haltSeq > seq)
+      _fetchHalt = FALSE;
+   if (_mc->_fetchDelaySlot && _mc->_fetchSeq > seq)
+      _mc->_fetchDelaySlot = FALSE; // a wrong-path CTI
+   _dsResolved = FALSE;
+}
+
+void Ooo::Commit(void)
+{
+   RobEntry *e;
+   int n, k;
+
+   for (n = 0; n < _mc->_issueWidth && _robCount > 0; n++)
+   {
+      e = Rob(0);
+      if (e->_phase != OOO_DONE || e->_readyAt > SIM_TIME)
+         break;
+
+      if (e->_r._isIllegalOp)
+      {
+         printf("Illegal ins %#x at PC %#x. Terminating simulation!\n", e->_r._ins, e->_r._pc);
+         printf("Register state on termination:\n\n");
+         _mc->dumpregs();
+         TRACE_FLUSH(_mc);
+         exit(0);
+      }
+      else if (e->_r._isSyscall)
+      {
+         // nothing younger is in flight: hand the emulation layer Mipc's
+         // registers and pick up whatever it changed
+         _mc->_pc = e->_r._pc;
+         e->_r._opControl(_mc, e->_r._ins);
+         for (k = 1; k < 32; k++)
+            _preg[_map[k]] = _mc->_gpr[k];
+         _mc->_pc = e->_r._pc + 4;
+         _fetchHalt = FALSE;
+      }
+      else
+      {
+         if (e->_r._bdslot && _mc->_bpred)
+            _mc->_bpred->Update(e->_r._pc, e->_r._ins, e->_r._btaken, e->_r._btgt, e->_r._predHist);
+         if (e->_isStore)
+         {
+            _mc->EX_MEM_NXT = &e->_r;
+            e->_r._memOp(_mc);
+            if (_mc->_l1d)
+               _mc->_l1d->Access(e->_r._memory_addr_reg, TRUE, e->_r._pc); // write buffer
+         }
+         for (k = 0; k < 2; k++)
+            if (e->_dst[k] >= 0)
+            {
+               arch_write(_mc, e->_arch[k], _preg[e->_dst[k]]);
+               _cmap[e->_arch[k]] = e->_dst[k];
+               _free[_nfree++] = e->_old[k];
+            }
+      }
+      _mc->_gpr[0] = 0;
+      if (e->_isLoad || e->_isStore)
+         _lsqUsed--;
+
+      if (_mc->_checker)
+         _mc->_checker->Retire(&e->_r);
+      TRACE_RETIRE(_mc, e->_r);
+      _mc->_nfetched++;
+      _mc->_nretired++;
+
+      _robHead = (_robHead + 1) % _robSize;
+      _robCount--;
+   }
+   if (_mc->_checker)
+      _mc->_checker->EndGroup();
+}
+
+void Ooo::OooDumpstats(void)
+{
+   Log l('*');
+   l.startLogging = 0;
+
+   l.print("Out-of-order core: ROB %d, RS %d, LSQ %d, %d rename registers, fetch queue %d",
+           _robSize, _rsSize, _lsqSize, _npreg - OOO_NARCH, _fqSize);
+   l.print("Average ROB occupancy: %.2f", SIM_TIME ? (double)_robOccupancy / SIM_TIME : 0.0);
+   l.print("Dispatch stalls: ROB full %llu, RS full %llu, LSQ full %llu, no free register %llu",
+           _robFull, _rsFull, _lsqFull, _regFull);
+   l.print("Load issue attempts held back by older stores: %llu", _lsqWait);
+   l.print("");
+}
@@ -0,0 +1,103 @@
+#ifndef __OOO_H__
+#define __OOO_H__
+
+#include "mips.h"
+
+/*
+ * Out-of-order core on top of the mips-fast Mipc.
+ *
+ * Mipc supplies the architectural state, Dec(), the func_* and mem_*
+ * handlers, the syscall layer, the branch predictor and the caches; this
+ * task replaces its five pipeline stages with
+ *
+ *   fetch     Mipc.IssueWidth instructions into a fetch queue
+ *   dispatch  rename into a physical register file and enter the ROB,
+ *             taking a reservation station (and an LSQ entry for
+ *             memory instructions)
+ *   issue     oldest-first among ready instructions; loads compute
+ *             their address, then read memory once no older store
+ *             can overlap
+ *   commit    in order: update Mipc's registers, perform stores,
+ *             run syscalls, train the branch predictor
+ *
+ * Stores write memory at commit and syscalls run at commit with nothing
+ * younger in flight, so memory and syscalls see precise state.  lwl/lwr
+ * (which merge the old rt read by their mem_* handler) only execute at
+ * the ROB head.  A mispredicted CTI squashes everything after its delay
+ * slot and restores the rename map from the ROB.
+ */
+#define OOO_NARCH 66 // 32 gpr, 32 single fp halves, hi, lo
+#define OOO_HI 64
+#define OOO_LO 65
+
+// RobEntry::_phase
+#define OOO_WAIT 0 // in a reservation station
+#define OOO_ADDR 1 // memory instruction with its address, in the LSQ
+#define OOO_DONE 2 // executed, result valid at _readyAt
+
+typedef struct
+{
+   PipeReg _r; // decoded instruction, operands and results
+   int _phase;
+   int _src[3];  // physical registers read (src1, src2, hi/lo), -1 = none
+   int _dst[2];  // physical registers written ([1] is hi), -1 = none
+   int _arch[2]; // ... their architectural registers
+   int _old[2];  // ... and the mappings they replaced
+   LL _readyAt;
+   Bool _isLoad, _isStore;
+   Bool _jumpReg;
+   Bool _serial; // executes only at the ROB head
+} RobEntry;
+
+class Ooo : public SimObject
+{
+public:
+   Ooo(Mipc *mc);
+   ~Ooo();
+
+   FAKE_SIM_TEMPLATE;
+
+   Mipc *_mc;
+
+private:
+   void Sync(void);
+   void Fetch(void);
+   void Dispatch(void);
+   void Issue(void);
+   void Commit(void);
+   void Execute(RobEntry *e);
+   void Resolve(RobEntry *e);
+   void Squash(LL seq);
+   Bool LoadMayGo(int pos);
+   void Result(RobEntry *e, int latency);
+   void OooDumpstats(void);
+
+   RobEntry *Rob(int pos) { return &_rob[(_robHead + pos) % _robSize]; }
+
+   PipeReg *_fq; // fetch queue, circular
+   int _fqSize, _fqHead, _fqCount;
+   Bool _fetchHalt; // fetched a syscall, wait for it to commit
+   LL _haltSeq;
+   Bool _dsResolved; // CTI resolved before its delay slot was fetched
+
+   RobEntry *_rob; // reorder buffer, circular
+   int _robSize, _robHead, _robCount;
+   int _rsSize, _rsUsed;
+   int _lsqSize, _lsqUsed;
+
+   int _map[OOO_NARCH];  // speculative rename map
+   int _cmap[OOO_NARCH]; // committed rename map
+   int _npreg;
+   unsigned *_preg;
+   LL *_pregReady; // cycle the value is available
+   int *_free;     // free physical registers
+   int _nfree;
+
+   int _loadLatency;
+
+   LL _robFull, _rsFull, _lsqFull, _regFull; // dispatch stalls
+   LL _lsqWait;   // load issue attempts held back by an older store
+   LL _robOccupancy;
+};
+
+#endif /* __OOO_H__ */
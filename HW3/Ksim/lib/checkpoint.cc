@@ -258,3 +258,20 @@ void RestoreQueueState (FILE *fp, eventcount *ec, UnCheckPoint *uc)
   }
 }
 #endif
+
+
+/*
+ *   ckpt_io --
+ *
+ *     Copy plain data to or from a binary checkpoint.
+ *
+ */
+void ckpt_io (FILE *fp, int save, void *p, size_t n)
+{
+  if (save) {
+    if (fwrite (p, 1, n, fp) != n)
+      fatal_error ("Error writing checkpoint");
+  }
+  else if (fread (p, 1, n, fp) != n)
+    fatal_error ("Checkpoint file truncated");
+}
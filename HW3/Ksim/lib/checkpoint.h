@@ -122,4 +122,13 @@ void RestoreChannelState (FILE *fp, ch_t *c, UnCheckPoint *uc);
 
 #endif
 
+/*
+ *  Binary state.  ckpt_io() writes the n bytes at p when "save" is
+ *  set and reads them back otherwise, so one list of fields serves
+ *  both SaveState and RestoreState.  Data is in host byte order: a
+ *  binary checkpoint restores on the same kind of host only.
+ */
+void ckpt_io (FILE *fp, int save, void *p, size_t n);
+#define CKPT_IO(fp, save, x) ckpt_io ((fp), (save), (void *)&(x), sizeof (x))
+
 #endif /* __CHECKPOINT_H__ */
@@ -0,0 +1,75 @@
+/*-*-mode:c++-*-**********************************************************
+ *
+ *  Binary memory image format
+ *
+ *  Written by Tools/src/elf2image, read by Mem::ReadImage/MergeImage alongside
+ *  the text format.  Every field is big-endian:
+ *
+ *    header        IMAGE_HDR_SIZE bytes (ImageHeader)
+ *    segments      nseg * IMAGE_SEG_SIZE bytes (ImageSegment)
+ *    payload       raw bytes, as they appear in target memory
+ *
+ *  A segment is "filesz" payload bytes at "offset" in the file, loaded
+ *  at "addr", followed by "memsz - filesz" bytes of the 8-byte pattern
+ *  "fill" (zero for .bss).  "addr" and "memsz" need not be aligned.
+ *
+ *************************************************************************/
+#ifndef __IMAGE_H__
+#define __IMAGE_H__
+
+#define IMAGE_MAGIC "\177KSIMIMG"	/* 8 bytes */
+#define IMAGE_MAGIC_LEN 8
+#define IMAGE_VERSION 1
+
+typedef struct {
+  char magic[IMAGE_MAGIC_LEN];
+  unsigned int version;
+  unsigned int nseg;
+  unsigned long long entry;	/* program entry point, informational */
+} ImageHeader;
+
+typedef struct {
+  unsigned long long addr;
+  unsigned long long filesz;
+  unsigned long long memsz;
+  unsigned long long fill;
+  unsigned long long offset;
+} ImageSegment;
+
+/* on-disk sizes, independent of host padding */
+#define IMAGE_HDR_SIZE 24
+#define IMAGE_SEG_SIZE 40
+
+/* 32-bit big-endian MIPS ELF, read by elf2image and Mem::ReadELF */
+#define ELF_MAGIC "\177ELF"
+#define ELF_EHDR_SIZE 52
+#define ELF_PHDR_SIZE 32
+#define ELF_SHDR_SIZE 40
+#define ELF_SYM_SIZE 16
+#define ELFCLASS32 1
+#define ELFDATA2MSB 2
+#define EM_MIPS 8
+#define PT_LOAD 1
+#define SHT_SYMTAB 2
+#define SHT_NOBITS 8
+#define SHF_ALLOC 0x2
+
+/* big-endian field access */
+static inline unsigned long long image_get (const unsigned char *p, int n)
+{
+  unsigned long long v = 0;
+
+  while (n-- > 0)
+    v = (v << 8) | *p++;
+  return v;
+}
+
+static inline void image_put (unsigned char *p, int n, unsigned long long v)
+{
+  while (n-- > 0) {
+    p[n] = v & 0xff;
+    v >>= 8;
+  }
+}
+
+#endif /* __IMAGE_H__ */
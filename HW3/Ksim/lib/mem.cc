@@ -18,568 +18,563 @@
  *
  *************************************************************************/
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "mem.h"
+#include "image.h"
+#include "checkpoint.h"
 #include "misc.h"
 #include "sim.h"
 #include <assert.h>
 
-#ifdef SYNCHRONOUS
+#define MEM_L2_MASK ((1 << MEM_L2_BITS) - 1)
+#define MEM_VPN_NONE (~0ULL)
 
-#define CHUNK_SIZE 1024		 /*Ocean: 8192*/
-/*
-#define CHUNK_SIZE 16384*/
-
-#define CHUNK_THRESHOLD 16 /* gc threshold */
-
-static int adj_merge_size = CHUNK_SIZE;
-
-/*
-#define ADJ_LIMIT 1024*1024*32
-*/
-
-#define ADJ_LIMIT CHUNK_SIZE	 /*Ocean*/ 
-/*
-#define ADJ_LIMIT 1024*32*/
-
-#else 
+int Mem::Compare (Mem *m, int verbose)
+{
+  int j;
+  int count = 10;
+  LL addr;
+  LL *p, *q;
+
+  /* pages of this memory against the same pages of m */
+  addr = 0;
+  while ((p = _nextpage (&addr))) {
+    q = m->_page (addr, 0);
+    for (j=0; j < MEM_PAGE_WORDS; j++) {
+      if (p[j] == (q ? q[j] : MEM_BAD))
+	continue;
+      count--;
+      if (count == 0) goto err;
+      if (verbose) {
+	LL a = addr + ((LL)j << MEM_ALIGN);
+	LL v = q ? q[j] : MEM_BAD;
+	printf ("[0x%08x%08x]  0x%08x%08x  != 0x%08x%08x\n",
+		(unsigned int)(a >> 32), (unsigned int)(a & 0xffffffff),
+		(unsigned int)(p[j] >> 32), (unsigned int)(p[j] & 0xffffffff),
+		(unsigned int)(v >> 32), (unsigned int)(v & 0xffffffff));
+      }
+    }
+    addr += MEM_PAGE_SIZE;
+    if (addr == 0) break;
+  }
 
-#define CHUNK_SIZE 16384
-#define CHUNK_THRESHOLD 16 /* gc threshold */
-static int adj_merge_size = 16384;
-#define ADJ_LIMIT 1024*32
+  /* pages only m has must be empty */
+  addr = 0;
+  while ((q = m->_nextpage (&addr))) {
+    if (!_page (addr, 0)) {
+      for (j=0; j < MEM_PAGE_WORDS; j++)
+	if (q[j] != MEM_BAD)
+	  goto err;
+    }
+    addr += MEM_PAGE_SIZE;
+    if (addr == 0) break;
+  }
+  if (count != 10) goto err;
 
-#endif
+  return 1;
 
-#define DOUBLE_THRESHOLD (1024*1024*256)
+ err:
+  if (verbose) {
+    printf ("First mem: %d pages\n", _pagecount ());
+    printf ("Second mem: %d pages\n", m->_pagecount ());
+  }
+  return 0;
+}
 
-#ifndef MIN
-#define MIN(a,b) ((a) < (b) ? (a) : (b))
-#endif
 
-int Mem::Compare (Mem *m, int verbose)
+/*
+ * drop region i of the page table
+ */
+void Mem::_freeregion (int i)
 {
-    int i, j;
-    int count = 10;
-
-    chunk_gc (1);
-    m->chunk_gc (1);
-
-    if (m->_chunks != _chunks) {
-      goto err;
-    }
-    for (i=0; i < _chunks; i++) {
-      if (_mem_addr[i] != m->_mem_addr[i]) goto err;
-      if (_mem_len[i] == m->_mem_len[i]) continue;
-      if (_mem_len[i] < m->_mem_len[i]) {
-	for (j=_mem_len[i]; j < m->_mem_len[i]; j++)
-	  if (m->_mem[i][j] != MEM_BAD)
-	    goto err;
-      }
-      else {
-	for (j=m->_mem_len[i]; j < _mem_len[i]; j++)
-	  if (_mem[i][j] != MEM_BAD)
-	    goto err;
+  int j, k;
+
+  for (j=0; j < (1 << MEM_L1_BITS); j++) {
+    if (!_regions[i]->l1[j]) continue;
+    for (k=0; k < (1 << MEM_L2_BITS); k++)
+      if (_regions[i]->l1[j][k]) {
+	free (_regions[i]->l1[j][k]);
+	_npages--;
       }
-    }
-    for (i=0; i < _chunks; i++) {
-      for (j=0; j < MIN(_mem_len[i],m->_mem_len[i]); j++)
-	if (_mem[i][j] != m->_mem[i][j]) {
-	  count--;
-	  if (count == 0) goto err;
-	  if (verbose) {
-	    printf ("[0x%08x%08x]  0x%08x%08x  != 0x%08x%08x\n",
-		    (unsigned int)(((j+_mem_addr[i])<<MEM_ALIGN) >> 32),
-		    (unsigned int)(((j+_mem_addr[i])<<MEM_ALIGN) & 0xffffffff),
-		    (unsigned int) (_mem[i][j] >> 32),
-		    (unsigned int) (_mem[i][j] & 0xffffffff),
-		    (unsigned int) (m->_mem[i][j] >> 32),
-		    (unsigned int) (m->_mem[i][j] & 0xffffffff));
-	  }
-	}
-    }
-    if (count != 10) goto err;
-
-    return 1;
-
-  err:
-    if (verbose) {
-      printf ("First mem:\n");
-      for (i=0; i < _chunks; i++) {
-	printf ("\t*0x%08x%08x %lu\n",
-		(unsigned int)((_mem_addr[i]<<MEM_ALIGN) >> 32),
-		(unsigned int)((_mem_addr[i]<<MEM_ALIGN) & 0xffffffff),
-		_mem_len[i]);
-      }
-      printf ("Second mem:\n");
-      for (i=0; i < m->_chunks; i++) {
-	printf ("\t*0x%08x%08x %lu\n",
-		(unsigned int)((m->_mem_addr[i]<<MEM_ALIGN) >> 32),
-		(unsigned int)((m->_mem_addr[i]<<MEM_ALIGN) & 0xffffffff),
-		m->_mem_len[i]);
-      }
-    }
-    return 0;
-   }
-
+    free (_regions[i]->l1[j]);
+  }
+  free (_regions[i]);
+  for (j=i; j < _nregions-1; j++)
+    _regions[j] = _regions[j+1];
+  _nregions--;
+  _lastRegion = 0;
+}
 
 /*
  * free memory image
  */
 void Mem::freemem (void)
 {
-/*
   int i;
 
-  context_disable ();
-
-  if (_chunks > 0) {
-    for (i=0; i < _chunks; i++) {
-      if (_mem[i]) 
-        FREE (_mem[i]);
-    }
-    if (_mem) FREE (_mem);
-    if (_mem_len) FREE (_mem_len);
-    if (_mem_addr) FREE (_mem_addr);
-    _mem = NULL;
-    _mem_len = NULL;
-    _mem_addr = NULL;
-    _chunks = 0;
-    _numchunks = 0;
-    _last_chunk_collect = 0;
+  while (_nregions > 0)
+    _freeregion (_nregions-1);
+  if (_regions)
+    free (_regions);
+  _regions = NULL;
+  _maxregions = 0;
+  _lastRegion = 0;
+  _npages = 0;
+
+  for (i=0; i < MEM_TLB_SIZE; i++) {
+    _tlb[i].vpn = MEM_VPN_NONE;
+    _tlb[i].page = NULL;
+    _tlb[i].dirty = NULL;
   }
 
-  context_enable ();
-*/
+  if (_flat) {
+    /* hand the pages back; they read as zero again */
+    madvise ((void *)_flat, (size_t)_flatLimit, MADV_DONTNEED);
+    memset (_flatPages, 0, sizeof (unsigned int) * (_flatLimit >> (MEM_PAGE_BITS+5)));
+    memset (_flatDirty, 0, sizeof (unsigned int) * (_flatLimit >> (MEM_PAGE_BITS+5)));
+  }
 }
 
 Mem::~Mem (void)
 {
   freemem();
+  if (_flat) {
+    munmap ((void *)_flat, (size_t)_flatLimit);
+    free (_flatPages);
+    free (_flatDirty);
+  }
 }
 
 Mem::Mem (void)
 {
-  _chunks = 0;
-  _numchunks = 0;
-  _last_chunk_collect = 0;
-  _mem = NULL;
-  _mem_len = NULL;
-  _mem_addr = NULL;
-
-  _lastReadRow = -1;
-  _lastWriteRow = -1;
+  _regions = NULL;
+  _nregions = 0;
+  _maxregions = 0;
+  _flat = NULL;
+  _flatLimit = 0;
+  _flatPages = NULL;
+  _flatDirty = NULL;
+  freemem ();
 }
 
-static int foobar;
-
-#define DUMPCHUNKS(xyz)						\
-do {									\
-  int _x;								\
-  printf ("addr=%qx [%d] :: ", (xyz) << MEM_ALIGN, foobar);		\
-  for (_x=0; _x<_chunks; _x++) {						\
-    printf ("%d:[%qx, %qx] ", _x, _mem_addr[_x] << MEM_ALIGN, (_mem_addr[_x]+_mem_len[_x]-1)<<MEM_ALIGN);	\
-  }; printf ("\n");  						\
-} while (0)
-
-#ifdef DEBUG_INV
-#define CHECK_INV(p,f)						\
-   {								\
-     int _i;							\
-     for (_i=0; _i < _chunks; _i++) {				\
-       if (_i < _chunks-1) {					\
-	 if (_mem_addr[_i]+_mem_len[_i]-1 < _mem_addr[_i+1])	\
-	   continue;						\
-	 printf (p ": INVARIANT FAILED @ %d!\n", _i);		\
-	 break;							\
-       }							\
-     }								\
-     if (_i != _chunks) {					\
-        DUMPCHUNKS(f);						\
-     }								\
-   }
+/*
+ * Map the low MEM_FLAT_SIZE bytes as one array of words that the host
+ * allocates as they are touched.  Whatever is already in that range
+ * moves over.  Returns 0 (and leaves memory alone) if the host cannot
+ * reserve that much address space.
+ */
+int Mem::Reserve (void)
+{
+#if defined(MAP_NORESERVE) && defined(MAP_ANONYMOUS)
+  void *p;
+  LL addr;
+  LL *page;
+  int i;
+
+  if (_flat) return 1;
+  if (sizeof (void *) < 8) return 0;
+
+  p = mmap (NULL, (size_t)MEM_FLAT_SIZE, PROT_READ|PROT_WRITE,
+	    MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) return 0;
+  _flat = (LL *)p;
+  MALLOC (_flatPages, unsigned int, MEM_FLAT_SIZE >> (MEM_PAGE_BITS+5));
+  memset (_flatPages, 0, sizeof (unsigned int) * (MEM_FLAT_SIZE >> (MEM_PAGE_BITS+5)));
+  MALLOC (_flatDirty, unsigned int, MEM_FLAT_SIZE >> (MEM_PAGE_BITS+5));
+  memset (_flatDirty, 0, sizeof (unsigned int) * (MEM_FLAT_SIZE >> (MEM_PAGE_BITS+5)));
+
+  for (i=0; i < _nregions; i++)
+    if (_regions[i]->hi == 0) break;
+  if (i < _nregions) {
+    addr = 0;
+    while ((page = _nextpage (&addr)) && addr < MEM_FLAT_SIZE) {
+      memcpy (_flat + (addr >> MEM_ALIGN), page, MEM_PAGE_SIZE);
+      _flatPages[addr >> (MEM_PAGE_BITS+5)] |= MEM_DIRTY_BIT (addr);
+      _flatDirty[addr >> (MEM_PAGE_BITS+5)] |= MEM_DIRTY_BIT (addr);
+      addr += MEM_PAGE_SIZE;
+    }
+    _freeregion (i);
+  }
+  for (i=0; i < MEM_TLB_SIZE; i++)
+    _tlb[i].vpn = MEM_VPN_NONE;
+  _flatLimit = MEM_FLAT_SIZE;
+  return 1;
 #else
-#define CHECK_INV(p,f)
+  return 0;
 #endif
+}
 
 /*
- * add one more slot to memory array
+ * Make this memory a copy of m, page by page
  */
-void 
-Mem::get_more (int ch, long long num, int merging)
+void Mem::CopyFrom (Mem *m)
 {
-  long long newnum;
-  unsigned long long t;
-  if (num <= 0) return;
-  
-  CHECK_INV ("get_more", 0);
-
-  if (!merging) {
-    Assert ((ch == _chunks - 1) ||
-	    (_mem_len[ch] + num + _mem_addr[ch] - 1 < _mem_addr[ch+1]),
-	    "Overlap violation");
-
-    if (_mem_len[ch] < DOUBLE_THRESHOLD)
-      newnum = _mem_len[ch];
-    else 
-      newnum = CHUNK_SIZE;
-
-    if (newnum < num)
-      newnum = num;
-
-    if (ch < _chunks - 1) {
-      /* double if possible */
-      if (_mem_addr[ch] + _mem_len[ch] + newnum - 1 < _mem_addr[ch+1]) {
-	num = newnum;
-      }
-      else {
-	num = _mem_addr[ch+1] - _mem_addr[ch] - _mem_len[ch];
-      }
-    }
-    else {
-      num = newnum;
-    }
-    _mem_len[ch] += num;
-    REALLOC (_mem[ch], LL, _mem_len[ch]);
-    for (t=_mem_len[ch]-1;t>=_mem_len[ch]-num;t--) {
-       _mem[ch][t] = MEM_BAD;
-    }
-    CHECK_INV ("get_more1", 0);
-    return;
-  }
-  /* merging */
-  if (_mem_len[ch] == 0) {
-    _mem_len[ch] = num;
-    MALLOC (_mem[ch], LL, _mem_len[ch]);
-    for (t=0;t<=_mem_len[ch]-1;t++) {
-       _mem[ch][t] = MEM_BAD;
-    }
+  LL addr;
+  LL *p;
+
+  freemem ();
+  addr = 0;
+  while ((p = m->_nextpage (&addr))) {
+    memcpy (_page (addr, 1), p, MEM_PAGE_SIZE);
+    addr += MEM_PAGE_SIZE;
+    if (addr == 0) break;
   }
-  else {
-    _mem_len[ch] += num;
-    REALLOC (_mem[ch], LL, _mem_len[ch]);
-    for (t=_mem_len[ch]-1;t>=_mem_len[ch]-num;t--) {
-       _mem[ch][t] = MEM_BAD;
+}
+
+/*
+ * Binary checkpoint of the pages written since the last SaveState (of
+ * every page unless "delta"), as (address, page) records ended by
+ * MEM_CKPT_END.  Clears the dirty bits, so the next delta starts here.
+ */
+void Mem::SaveState (FILE *fp, int delta)
+{
+  LL addr, end;
+  LL *p;
+
+  addr = 0;
+  while ((p = _nextpage (&addr))) {
+    if (!delta || (*_dirtyword (addr) & MEM_DIRTY_BIT (addr))) {
+      ckpt_io (fp, 1, &addr, sizeof (LL));
+      ckpt_io (fp, 1, p, MEM_PAGE_SIZE);
     }
+    addr += MEM_PAGE_SIZE;
+    if (addr == 0) break;
   }
+  end = MEM_CKPT_END;
+  ckpt_io (fp, 1, &end, sizeof (LL));
+  _cleardirty ();
 }
 
 /*
- * create new chunk, at position "chunks-1"
- *
- * Return values:
- *
- *   1  => created a new chunk at array position "chunks-1"
- *   0  => resized array at position ch
+ * dirty bitmap word of the page holding addr, NULL if its 4 GB region
+ * has no page table
  */
-int Mem::create_new_chunk (LL addr, int ch)
+unsigned int *Mem::_dirtyword (LL addr)
 {
-  int i, gap;
-  static int last_create = -1;
+  int i;
 
-#if 0
-  printf ("Creating new chunk: 0x%llx @ %d, curcount = %d\n", addr,
-	  ch, chunks);
-#endif
+  if (addr < _flatLimit)
+    return &_flatDirty[addr >> (MEM_PAGE_BITS+5)];
+  for (i=0; i < _nregions; i++)
+    if (_regions[i]->hi == (addr >> 32))
+      return &_regions[i]->dirty[(unsigned int)addr >> (MEM_PAGE_BITS+5)];
+  return NULL;
+}
 
-  if (_chunks == _numchunks) {
-    if (_numchunks == 0) {
-      _numchunks = 4;
-      MALLOC (_mem, LL *, _numchunks);
-      MALLOC (_mem_len, LL, _numchunks);
-      MALLOC (_mem_addr, LL, _numchunks);
-    }
-    else {
-      _numchunks *= 2;
-      REALLOC (_mem, LL *, _numchunks);
-      REALLOC (_mem_len, LL, _numchunks);
-      REALLOC (_mem_addr, LL, _numchunks);
-    }
-  }
-  if (0 <= ch && ch < _chunks) {
-    /* the new chunk is right next to "ch" */
-    if (_mem_addr[ch] - addr >= CHUNK_SIZE) {
-      _mem_len[_chunks] = CHUNK_SIZE;
-    }
-    else {
-      /* next chunk is close by, we need to just adjust the size of
-	 the next chunk by CHUNK_SIZE *backward*
-      */
-      if (ch > 0) {
-	if (last_create == ch) {
-	  adj_merge_size *= 2;
-	  if (adj_merge_size > ADJ_LIMIT)
-	    adj_merge_size = ADJ_LIMIT;
-	}
-	last_create = ch;
-	
-	gap = _mem_addr[ch] - _mem_len[ch-1] - _mem_addr[ch-1];
-	gap = MIN (gap, adj_merge_size);
-	REALLOC (_mem[ch], LL, _mem_len[ch] + gap);
-	for (i=_mem_len[ch]-1; i >= 0; i--) {
-	  _mem[ch][i+gap] = _mem[ch][i];
-        }
-	for (i=0; i < gap; i++) {
-	  _mem[ch][i] = MEM_BAD;
-	}
-	_mem_addr[ch] = _mem_addr[ch] - gap;
-	_mem_len[ch] = _mem_len[ch] + gap;
-	return 0;
-      }
-      _mem_len[_chunks] = _mem_addr[ch] - addr;
-    }
-    Assert (_mem_len[_chunks] > 0, "What?");
-  }
-  else {
-    _mem_len[_chunks] = CHUNK_SIZE;
-  }
-  MALLOC (_mem[_chunks], LL, _mem_len[_chunks]);
-  _mem_addr[_chunks] = 0;
-  for (i=0;i<=_mem_len[_chunks]-1;i++) {
-     _mem[_chunks][i] = MEM_BAD;
-  }
-  _chunks++;
-  return 1;
+void Mem::_cleardirty (void)
+{
+  int i;
+
+  if (_flat)
+    memset (_flatDirty, 0, sizeof (unsigned int) * (_flatLimit >> (MEM_PAGE_BITS+5)));
+  for (i=0; i < _nregions; i++)
+    memset (_regions[i]->dirty, 0, sizeof (_regions[i]->dirty));
 }
 
-inline int Mem::_binsearch (LL addr)
+/*
+ * Apply the page records of one SaveState on top of this memory
+ */
+void Mem::RestoreState (FILE *fp)
 {
-  int i, j, m;
-  
-  if (_chunks == 0) return -1;
-  
-  i = 0; j = _chunks;
-
-  while ((i+1) != j) {
-    m = (i+j)/2;
-    if (_mem_addr[m] > addr)
-      j = m;
-    else
-      i = m;
-  }
-  foobar = i;
-  if ((_mem_addr[i] <= addr) && (addr < _mem_addr[i] + _mem_len[i]))
-    return i;
-  else {
-    return -1;
+  LL addr;
+
+  for (;;) {
+    ckpt_io (fp, 0, &addr, sizeof (LL));
+    if (addr == MEM_CKPT_END)
+      break;
+    if (addr & (MEM_PAGE_SIZE-1))
+      fatal_error ("Bad page address %#llx in checkpoint", addr);
+    ckpt_io (fp, 0, _page (addr, 1), MEM_PAGE_SIZE);
   }
 }
 
-
-int Mem::_binsearchw (LL addr)
+/*
+ * Store "len" bytes, in target (big-endian) order, starting at addr.
+ * Whole words go straight into the pages.
+ */
+void Mem::WriteBlock (LL addr, const Byte *buf, LL len)
 {
-  int i, j, m;
-  
-  if (_chunks == 0) return 0;
-  
-  i = 0; j = _chunks;
-
-  while ((i+1) != j) {
-    m = (i+j)/2;
-    if (addr < _mem_addr[m])
-      j = m;
-    else
-      i = m;
+  LL *p, v;
+  int j, k;
+
+  while (len > 0 && (addr & 7)) {
+    Write (addr, BESetByte (addr, Read (addr), *buf++));
+    addr++;
+    len--;
   }
-#if 0
-  foobar = i;
-#endif
-  if ((_mem_addr[i] <= addr) && (addr <= (_mem_addr[i] + _mem_len[i]))) {
-     if ((i > 0) && ((_mem_addr[i-1] + _mem_len[i-1]) == addr))
-      return i-1;
-    return i;
+  while (len >= 8) {
+    p = _page (addr, 1);
+    for (j = (addr >> MEM_ALIGN) & (MEM_PAGE_WORDS-1); j < MEM_PAGE_WORDS && len >= 8; j++) {
+      v = 0;
+      for (k=0; k < 8; k++)
+	v = (v << 8) | buf[k];
+      p[j] = v;
+      buf += 8;
+      addr += 8;
+      len -= 8;
+    }
   }
-  else {
-    /* not found */
-    if (addr < _mem_addr[0])
-      return 0;
-    else if (addr > _mem_addr[_chunks-1] + _mem_len[_chunks-1])
-      return _chunks;
-    else
-      return i+1;
+  while (len > 0) {
+    Write (addr, BESetByte (addr, Read (addr), *buf++));
+    addr++;
+    len--;
   }
 }
 
 /*
- * get value @ address addr
+ * Load "len" bytes, in target (big-endian) order, starting at addr.
+ * Unmapped memory reads as MEM_BAD.
  */
-LL 
-Mem::Read (LL addr)
+void Mem::ReadBlock (LL addr, Byte *buf, LL len)
 {
-  int i, w;
+  LL v;
+  int k;
 
-  addr >>= MEM_ALIGN;
-
-#if 0
-  for (i=0; i < _chunks; i++) {
-    if (_mem_addr[i] <= addr && addr < _mem_addr[i]+_mem_len[i]) {
-      w = _binsearch (addr);
-      if (w != i) {
-	printf (" ** READ: bin=%d, lin=%d **\n", w, i);
-	DUMPCHUNKS(addr);
-      }
-      return _mem[i][addr-_mem_addr[i]];
-    }
+  while (len > 0 && (addr & 7)) {
+    *buf++ = BEGetByte (addr, Read (addr));
+    addr++;
+    len--;
   }
-  if (_binsearch (addr) != -1) {
-    printf ("READ miss, bin=%d\n", foobar);
-    DUMPCHUNKS(addr);
-  }
-  return MEM_BAD;
-#endif
-  if ((_lastReadRow != -1) &&
-      (_mem_addr[_lastReadRow] <= addr) && 
-      (addr < _mem_addr[_lastReadRow]+_mem_len[_lastReadRow])) {
-     return _mem[_lastReadRow][addr-_mem_addr[_lastReadRow]];
+  while (len >= 8) {
+    v = Read (addr);
+    for (k=7; k >= 0; k--) {
+      buf[k] = v & 0xff;
+      v >>= 8;
+    }
+    buf += 8;
+    addr += 8;
+    len -= 8;
   }
-  w = _binsearch (addr);
-  _lastReadRow = w;
-  if (w == -1) {
-    return MEM_BAD;
+  while (len > 0) {
+    *buf++ = BEGetByte (addr, Read (addr));
+    addr++;
+    len--;
   }
-  else {
-    return _mem[w][addr-_mem_addr[w]];
+}
+
+/*
+ * fill [addr, end) with the big-endian 8-byte pattern
+ */
+void Mem::_fill (LL addr, LL end, LL pattern)
+{
+  while (addr < end) {
+    if ((addr & 7) == 0 && addr + 8 <= end) {
+      Write (addr, pattern);
+      addr += 8;
+    }
+    else {
+      Write (addr, BESetByte (addr, Read (addr), BEGetByte (addr, pattern)));
+      addr++;
+    }
   }
 }
 
-/* merge two chunks */
-void Mem::merge_chunks (int c1, int c2)
+/*
+ * pages written, flat and in the page table
+ */
+int Mem::_pagecount (void)
 {
-  unsigned int i;
+  int n = _npages;
+  LL i;
 
-  Assert (_mem_addr[c1]+_mem_len[c1] == _mem_addr[c2], "What?");
-  Assert (c1 < c2, "Hmm...");
+  for (i=0; i < (_flatLimit >> (MEM_PAGE_BITS+5)); i++)
+    n += __builtin_popcount (_flatPages[i]);
+  return n;
+}
 
-#if 0
-  printf ("Nchunks = %d\n", _chunks);
-#endif
+/*
+ * page holding addr, allocated (zero-filled) if "alloc" is set;
+ * NULL if it does not exist
+ */
+LL *
+Mem::_page (LL addr, int alloc)
+{
+  MemRegion *r;
+  LL hi = addr >> 32;
+  unsigned int l1 = ((unsigned int)addr >> (MEM_PAGE_BITS + MEM_L2_BITS));
+  unsigned int l2 = ((unsigned int)addr >> MEM_PAGE_BITS) & MEM_L2_MASK;
+  int i, j;
+
+  if (addr < _flatLimit) {
+    unsigned int *w = &_flatPages[addr >> (MEM_PAGE_BITS+5)];
+    unsigned int bit = 1U << ((addr >> MEM_PAGE_BITS) & 31);
+
+    if (!(*w & bit)) {
+      if (!alloc) return NULL;
+      *w |= bit;
+    }
+    if (alloc)
+      _flatDirty[addr >> (MEM_PAGE_BITS+5)] |= bit;
+    return _flat + ((addr & ~(LL)(MEM_PAGE_SIZE-1)) >> MEM_ALIGN);
+  }
 
-  get_more (c1, _mem_len[c2], 1);
-  for (i=0; i < _mem_len[c2]; i++) {
-    _mem[c1][i+_mem_addr[c2]-_mem_addr[c1]] = _mem[c2][i];
+  /* almost always one region: the low 4 GB */
+  if (_lastRegion < _nregions && _regions[_lastRegion]->hi == hi)
+    i = _lastRegion;
+  else {
+    for (i=0; i < _nregions; i++)
+      if (_regions[i]->hi >= hi)
+	break;
+    if (i == _nregions || _regions[i]->hi != hi) {
+      if (!alloc) return NULL;
+      if (_nregions == _maxregions) {
+	_maxregions = _maxregions ? 2*_maxregions : 4;
+	if (_regions)
+	  REALLOC (_regions, MemRegion *, _maxregions);
+	else
+	  MALLOC (_regions, MemRegion *, _maxregions);
+      }
+      for (j=_nregions; j > i; j--)
+	_regions[j] = _regions[j-1];
+      NEW (r, MemRegion);
+      r->hi = hi;
+      for (j=0; j < (1 << MEM_L1_BITS); j++)
+	r->l1[j] = NULL;
+      memset (r->dirty, 0, sizeof (r->dirty));
+      _regions[i] = r;
+      _nregions++;
+    }
+    _lastRegion = i;
   }
-  FREE (_mem[c2]);
-  for (i=c2; i < _chunks-1; i++) {
-    _mem[i] = _mem[i+1];
-    _mem_len[i] = _mem_len[i+1];
-    _mem_addr[i] = _mem_addr[i+1];
+  r = _regions[i];
+
+  if (!r->l1[l1]) {
+    if (!alloc) return NULL;
+    MALLOC (r->l1[l1], LL *, 1 << MEM_L2_BITS);
+    for (j=0; j < (1 << MEM_L2_BITS); j++)
+      r->l1[l1][j] = NULL;
+  }
+  if (!r->l1[l1][l2]) {
+    if (!alloc) return NULL;
+    MALLOC (r->l1[l1][l2], LL, MEM_PAGE_WORDS);
+    for (j=0; j < MEM_PAGE_WORDS; j++)
+      r->l1[l1][l2][j] = MEM_BAD;
+    _npages++;
   }
-  _mem_len[i] = 0;
-  _chunks--;
-  CHECK_INV ("merge_chunks",0);
+  if (alloc)
+    r->dirty[(unsigned int)addr >> (MEM_PAGE_BITS+5)] |= MEM_DIRTY_BIT (addr);
+  return r->l1[l1][l2];
+}
 
-  return;
+/*
+ * TLB miss: look the page up and replace the entry it maps to.  Reads
+ * of pages never written return NULL and leave the TLB alone.
+ */
+MemTLB *
+Mem::_translate (LL addr, int alloc)
+{
+  MemTLB *t;
+  LL *p;
+
+  if (!(p = _page (addr, alloc)))
+    return NULL;
+  t = &_tlb[(addr >> MEM_PAGE_BITS) & (MEM_TLB_SIZE-1)];
+  t->vpn = addr >> MEM_PAGE_BITS;
+  t->page = p;
+  t->dirty = _dirtyword (addr);	/* writes that hit in the TLB set it */
+  return t;
 }
 
 /*
- *  garbage collect chunks periodically
+ * first page at or after *addr (rounded down to a page); sets *addr to
+ * its address.  NULL if there is none.
  */
-void Mem::chunk_gc (int force)
+LL *
+Mem::_nextpage (LL *addr)
 {
   int i;
+  unsigned int l1, l2;
+  LL a = *addr & ~(LL)(MEM_PAGE_SIZE-1);
+  MemRegion *r;
 
-  if (force || (_chunks - _last_chunk_collect > CHUNK_THRESHOLD)) {
-    CHECK_INV("chunk_gc0", 0);
-    i = 0;
-    while (i < _chunks-1) {
-      if (_mem_addr[i]+_mem_len[i] == _mem_addr[i+1])
-	merge_chunks (i, i+1);
-      else
-	i++;
+  for (; a < _flatLimit; a += MEM_PAGE_SIZE) {
+    if (!_flatPages[a >> (MEM_PAGE_BITS+5)]) {
+      a |= (LL)MEM_PAGE_SIZE*31;	/* skip the rest of the word */
+      continue;
+    }
+    if (_flatPages[a >> (MEM_PAGE_BITS+5)] & (1U << ((a >> MEM_PAGE_BITS) & 31))) {
+      *addr = a;
+      return _flat + (a >> MEM_ALIGN);
     }
-    _last_chunk_collect = _chunks;
-    CHECK_INV("chunk_gc1", 0);
   }
 
+  for (i=0; i < _nregions; i++) {
+    r = _regions[i];
+    if (r->hi < (a >> 32)) continue;
+    if (r->hi > (a >> 32))
+      a = r->hi << 32;
+    l1 = (unsigned int)a >> (MEM_PAGE_BITS + MEM_L2_BITS);
+    l2 = ((unsigned int)a >> MEM_PAGE_BITS) & MEM_L2_MASK;
+    for (; l1 < (1 << MEM_L1_BITS); l1++, l2 = 0) {
+      if (!r->l1[l1]) continue;
+      for (; l2 < (1 << MEM_L2_BITS); l2++)
+	if (r->l1[l1][l2]) {
+	  *addr = (r->hi << 32) |
+	    ((LL)l1 << (MEM_PAGE_BITS + MEM_L2_BITS)) | ((LL)l2 << MEM_PAGE_BITS);
+	  return r->l1[l1][l2];
+	}
+    }
+    a = (r->hi + 1) << 32;
+    if (a == 0) break;
+  }
+  return NULL;
 }
 
 /*
- * store value at addr
+ * Load a binary image (image.h), into dup as well if it is not NULL.
+ * Each segment's payload is read in one go and stored a word at a time.
  */
-void 
-Mem::Write (LL addr, LL val)
+int
+Mem::_mergebinary (FILE *fp, Mem *dup)
 {
-  int i, j, w;
-  int ch, ret;
-  LL len, sz;
-  LL *data;
-
-  addr >>= MEM_ALIGN;
-
-//  CHECK_INV ("wbefore", addr);
-
-//  context_disable ();
-
-  if ((_lastWriteRow != -1) &&
-      (_mem_addr[_lastWriteRow] <= addr) && 
-      (addr < _mem_addr[_lastWriteRow]+_mem_len[_lastWriteRow])) {
-     _mem[_lastWriteRow][addr-_mem_addr[_lastWriteRow]] = val;
-     return;
-  }
-  w = _binsearchw (addr);
-  _lastWriteRow = w;
-
-  if ((w < _chunks) &&
-      ((_mem_addr[w] <= addr) && (addr < _mem_addr[w]+_mem_len[w]))) {
-    _mem[w][addr-_mem_addr[w]] = val;
-    //  CHECK_INV("write0", addr);
-//    context_enable ();
-    return;
-  }
-  i = w;
-
-  if ((i < _chunks) && (_chunks > 0) && (addr == (_mem_addr[i] + _mem_len[i]))) {
-    /* check merging chunks! */
-    if ((i < (_chunks-1)) && (_mem_addr[i+1] == addr)) {
-      /* merge two chunks! */
-      merge_chunks (i,i+1);
-      _mem[i][addr-_mem_addr[i]] = val;
-//      CHECK_INV("write1", addr);
-//      context_enable();
-      return;
+  unsigned char hdr[IMAGE_HDR_SIZE];
+  unsigned char *tab, *t;
+  Byte *buf;
+  ImageSegment seg;
+  unsigned int i, nseg;
+  long start;
+
+  start = ftell (fp);
+  if (fread (hdr, 1, IMAGE_HDR_SIZE, fp) != IMAGE_HDR_SIZE ||
+      memcmp (hdr, IMAGE_MAGIC, IMAGE_MAGIC_LEN) != 0)
+    fatal_error ("Bad binary image header");
+  if (image_get (hdr + 8, 4) != IMAGE_VERSION)
+    fatal_error ("Binary image version %u not supported", (unsigned int)image_get (hdr + 8, 4));
+  nseg = image_get (hdr + 12, 4);
+  if (nseg == 0)
+    return _pagecount () * MEM_PAGE_WORDS;
+
+  MALLOC (tab, unsigned char, nseg * IMAGE_SEG_SIZE);
+  if (fread (tab, IMAGE_SEG_SIZE, nseg, fp) != nseg)
+    fatal_error ("Binary image segment table truncated");
+
+  for (i=0; i < nseg; i++) {
+    t = tab + i * IMAGE_SEG_SIZE;
+    seg.addr = image_get (t, 8);
+    seg.filesz = image_get (t + 8, 8);
+    seg.memsz = image_get (t + 16, 8);
+    seg.fill = image_get (t + 24, 8);
+    seg.offset = image_get (t + 32, 8);
+    if (seg.filesz > seg.memsz)
+      fatal_error ("Binary image segment %u: payload larger than segment", i);
+
+    if (seg.filesz > 0) {
+      MALLOC (buf, Byte, seg.filesz);
+      if (fseek (fp, start + (long)seg.offset, SEEK_SET) != 0 ||
+	  fread (buf, 1, seg.filesz, fp) != seg.filesz)
+	fatal_error ("Binary image segment %u truncated", i);
+      WriteBlock (seg.addr, buf, seg.filesz);
+      if (dup)
+	dup->WriteBlock (seg.addr, buf, seg.filesz);
+      free (buf);
     }
-    /* extend chunk! */
-    get_more (i, addr-_mem_addr[i]-_mem_len[i]+1);
-    _mem[i][addr-_mem_addr[i]] = val;
-//    CHECK_INV("write2", addr);
-//    context_enable();
-    return;
-  }
-  /* we need to move other chunks to the end */
-  ch = i;
-  ret = create_new_chunk (addr, ch);
-  if (ret == 1) {
-    /* save data and len */
-    data = _mem[_chunks-1];
-    len = _mem_len[_chunks-1];
-
-    /* move other chunks up */
-    for (j = _chunks-1; j >= ch+1; j--) {
-      _mem_addr[j] = _mem_addr[j-1];
-      _mem_len[j] = _mem_len[j-1];
-      _mem[j] = _mem[j-1];
-    }
-
-    /* set chunk info */
-    _mem[ch] = data;
-    _mem_len[ch] = len;
-    _mem_addr[ch] = addr;
-    get_more (ch, addr-_mem_addr[ch]-_mem_len[ch]+1);
-    _mem[ch][0] = val;
-    // chunk_gc(0);
-
+    _fill (seg.addr + seg.filesz, seg.addr + seg.memsz, seg.fill);
+    if (dup)
+      dup->_fill (seg.addr + seg.filesz, seg.addr + seg.memsz, seg.fill);
   }
-  else if (ret == 0) {
-    _mem[ch][addr - _mem_addr[ch]] = val;
-    // chunk_gc(0);
-  }
-  else {
-//     fatal_error ("Unknown ret value");
-  }
-
-//  CHECK_INV("write3", addr);
-
-//  context_enable();
-//  return;
+  free (tab);
+  return _pagecount () * MEM_PAGE_WORDS;
 }
 
 /*
@@ -598,6 +593,105 @@ Mem::ReadImageAndDuplicate (FILE *fp, Mem *dup_m)
   freemem ();
   return MergeImageAndDuplicate (fp, dup_m);
 }
+/*
+ * read "len" bytes at offset "off" of an ELF file
+ */
+static void
+elf_read (FILE *fp, long off, void *buf, LL len)
+{
+  if (fseek (fp, off, SEEK_SET) != 0 || fread (buf, 1, len, fp) != (size_t)len)
+    fatal_error ("ELF file truncated");
+}
+
+/*
+ * load a fresh memory image from a 32-bit big-endian MIPS executable:
+ * every PT_LOAD segment in one block, the rest of the segment (.bss,
+ * .sbss) zeroed.  Returns the entry point and the value of _gp (0 if
+ * the symbol table has none).
+ */
+int
+Mem::ReadELF (FILE *fp, LL *entry, LL *gp)
+{
+  unsigned char eh[ELF_EHDR_SIZE], ph[ELF_PHDR_SIZE], sh[ELF_SHDR_SIZE];
+  unsigned char *syms, *sym;
+  char *strs;
+  Byte *buf;
+  LL phoff, shoff, vaddr, filesz, memsz, nsyms, strsize, name;
+  int phentsize, phnum, shentsize, shnum, i, j, nload;
+  long start;
+
+  start = ftell (fp);
+  elf_read (fp, start, eh, ELF_EHDR_SIZE);
+  if (memcmp (eh, ELF_MAGIC, 4) != 0)
+    fatal_error ("Bad ELF header");
+  if (eh[4] != ELFCLASS32 || eh[5] != ELFDATA2MSB ||
+      image_get (eh + 18, 2) != EM_MIPS)
+    fatal_error ("Not a 32-bit big-endian MIPS executable");
+
+  *entry = image_get (eh + 24, 4);
+  *gp = 0;
+  phoff = image_get (eh + 28, 4);
+  shoff = image_get (eh + 32, 4);
+  phentsize = image_get (eh + 42, 2);
+  phnum = image_get (eh + 44, 2);
+  shentsize = image_get (eh + 46, 2);
+  shnum = image_get (eh + 48, 2);
+
+  freemem ();
+
+  nload = 0;
+  for (i=0; i < phnum; i++) {
+    elf_read (fp, start + phoff + i * phentsize, ph, ELF_PHDR_SIZE);
+    if (image_get (ph, 4) != PT_LOAD)
+      continue;
+    vaddr = image_get (ph + 8, 4);
+    filesz = image_get (ph + 16, 4);
+    memsz = image_get (ph + 20, 4);
+    if (filesz > memsz)
+      fatal_error ("ELF segment %d: file size larger than memory size", i);
+    if (filesz > 0) {
+      MALLOC (buf, Byte, filesz);
+      elf_read (fp, start + image_get (ph + 4, 4), buf, filesz);
+      WriteBlock (vaddr, buf, filesz);
+      free (buf);
+    }
+    _fill (vaddr + filesz, vaddr + memsz, 0);
+    nload++;
+  }
+  if (nload == 0)
+    fatal_error ("ELF file has no loadable segments");
+
+  /* _gp from the symbol table, if it was not stripped */
+  for (i=0; i < shnum && *gp == 0; i++) {
+    elf_read (fp, start + shoff + i * shentsize, sh, ELF_SHDR_SIZE);
+    if (image_get (sh + 4, 4) != SHT_SYMTAB)
+      continue;
+    nsyms = image_get (sh + 20, 4) / ELF_SYM_SIZE;
+    MALLOC (syms, unsigned char, nsyms * ELF_SYM_SIZE + 1);
+    elf_read (fp, start + image_get (sh + 16, 4), syms, nsyms * ELF_SYM_SIZE);
+
+    /* linked string table */
+    elf_read (fp, start + shoff + image_get (sh + 24, 4) * shentsize,
+	      sh, ELF_SHDR_SIZE);
+    strsize = image_get (sh + 20, 4);
+    MALLOC (strs, char, strsize + 1);
+    elf_read (fp, start + image_get (sh + 16, 4), strs, strsize);
+    strs[strsize] = '\0';
+
+    for (j=0; j < nsyms; j++) {
+      sym = syms + j * ELF_SYM_SIZE;
+      name = image_get (sym, 4);
+      if (name < strsize && strcmp (strs + name, "_gp") == 0) {
+	*gp = image_get (sym + 4, 4);
+	break;
+      }
+    }
+    free (syms);
+    free (strs);
+  }
+  return _pagecount () * MEM_PAGE_WORDS;
+}
+
 /*
  * read memory image from a file
  */
@@ -646,6 +740,12 @@ Mem::MergeImage (FILE *fp)
   unsigned int len;
   LL a, v, tmp;
   int endian;
+  int c;
+
+  if ((c = getc (fp)) != EOF)
+    ungetc (c, fp);
+  if (c == IMAGE_MAGIC[0])
+    return _mergebinary (fp, NULL);
 
   while (fgets (buf, 1024, fp)) {
     if (buf[0] == '!') {
@@ -789,22 +889,7 @@ Mem::MergeImage (FILE *fp)
     Write (a, v);
   }
 
-  a = 0;
-  for (a1=0; a1 < _chunks; a1++) {
-     assert(_mem_len != NULL);
-     a += _mem_len[a1];
-  }
-
-#if 0
-  {
-    DUMPCHUNKS(0);
-    
-    printf ("************************************************************************\n");
-    chunk_gc (1);
-    DUMPCHUNKS(0);
-    printf ("************************************************************************\n");
-  }
-#endif
+  a = (LL)_pagecount () * MEM_PAGE_WORDS;
 
 //  printf("Mem::MergeImage, returning %d\n", a);
   return a;
@@ -818,6 +903,12 @@ Mem::MergeImageAndDuplicate (FILE *fp, Mem *dup_m)
   unsigned int len;
   LL a, v, tmp;
   int endian;
+  int c;
+
+  if ((c = getc (fp)) != EOF)
+    ungetc (c, fp);
+  if (c == IMAGE_MAGIC[0])
+    return _mergebinary (fp, dup_m);
 
   while (fgets (buf, 1024, fp)) {
     if (buf[0] == '!') {
@@ -965,71 +1056,45 @@ Mem::MergeImageAndDuplicate (FILE *fp, Mem *dup_m)
     dup_m->Write (a, v);
   }
 
-  a = 0;
-  for (a1=0; a1 < _chunks; a1++) {
-     assert(_mem_len != NULL);
-     a += _mem_len[a1];
-  }
+  a = (LL)_pagecount () * MEM_PAGE_WORDS;
   return a;
 }
 
-/* Dump memory image */
+/* Dump memory image, one line group per page; empty pages are skipped */
 void 
 Mem::DumpImage (FILE *fp)
 {
-  int i, j, k;
+  int j;
   LL addr, data;
-  unsigned int len;
-
-  chunk_gc (1);
-
-  for (i=0; i < _chunks; i++) {
-    fprintf (fp, "# Chunk %d of %d\n", i, _chunks);
-    addr = _mem_addr[i] << MEM_ALIGN;
+  LL *p;
 
-    for (j=0; j < _mem_len[i]; j++)
-      if (_mem[i][j] != _mem[i][0])
+  addr = 0;
+  while ((p = _nextpage (&addr))) {
+    for (j=0; j < MEM_PAGE_WORDS; j++)
+      if (p[j] != p[0])
 	break;
-    if (j == _mem_len[i]) {
-      data = _mem[i][0];
-      len = _mem_len[i];
-#if MEM_ALIGN == 3
-      fprintf (fp, "@0x%08x%08x 0x%08x%08x %lu\n",
-	       (unsigned int)(addr >> 32),
-	       (unsigned int)(addr & 0xffffffff),
-	       (unsigned int)(data >> 32),
-	       (unsigned int)(data & 0xffffffff), len);
-#elif MEM_ALIGN == 2
-      fprintf (fp, "@0x%08x 0x%08x %lu\n", (unsigned int)addr,
-	       (unsigned int) data, len);
-#else
-#error What?
-#endif
-    }
-    else {
-#if MEM_ALIGN == 3
-	fprintf (fp, "*0x%08x%08x %lu\n",
+    if (j == MEM_PAGE_WORDS) {
+      data = p[0];
+      if (data != MEM_BAD)
+	fprintf (fp, "@0x%08x%08x 0x%08x%08x %lu\n",
 		 (unsigned int)(addr >> 32),
 		 (unsigned int)(addr & 0xffffffff),
-		 (unsigned int) _mem_len[i]);
-#elif MEM_ALIGN == 2
-	fprintf (fp, "*0x%08x 0x%08x\n", (unsigned int)addr,
-		 (unsigned int) _mem_len[i]);
-#else
-#error Unknown mem format
-#endif
-	for (j=0; j < _mem_len[i]; j++) {
-	  data = _mem[i][j];
-#if MEM_ALIGN == 3
+		 (unsigned int)(data >> 32),
+		 (unsigned int)(data & 0xffffffff), (unsigned long)MEM_PAGE_WORDS);
+    }
+    else {
+      fprintf (fp, "*0x%08x%08x %lu\n",
+	       (unsigned int)(addr >> 32),
+	       (unsigned int)(addr & 0xffffffff),
+	       (unsigned long)MEM_PAGE_WORDS);
+      for (j=0; j < MEM_PAGE_WORDS; j++) {
+	data = p[j];
 	fprintf (fp, "0x%08x%08x\n",
 		 (unsigned int)(data >> 32),
 		 (unsigned int)(data & 0xffffffff));
-#elif MEM_ALIGN == 2
-	fprintf (fp, "0x%08x\n", (unsigned int) data);
-#else
-#error Unknown mem format
-#endif
-	}
+      }
     }
+    addr += MEM_PAGE_SIZE;
+    if (addr == 0) break;
   }
 }
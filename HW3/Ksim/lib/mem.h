@@ -26,6 +26,21 @@
 
 /*
  * Physical memory: Assumes big-endian format!
+ *
+ * Memory is kept in MEM_PAGE_SIZE-byte pages, allocated on the first
+ * write to them; reading a page that was never written returns
+ * MEM_BAD.  Every 4 GB region of the address space has a two-level
+ * page table, and a small direct-mapped TLB holds the host address of
+ * recently used pages, so an access is normally one compare and one
+ * load.
+ *
+ * Reserve() instead maps the whole 32-bit space as one MAP_NORESERVE
+ * array of words, which the host fills in lazily; accesses below
+ * MEM_FLAT_SIZE are then a single indexed load or store.
+ *
+ * Either way every page has a dirty bit, set by each write to it and
+ * cleared by SaveState, so a checkpoint can hold just the pages written
+ * since the one before.
  */
 
 typedef unsigned long long LL;
@@ -33,13 +48,36 @@ typedef unsigned char Byte;
 typedef unsigned int Word;
 
 #define MEM_BAD  0x0ULL
+#define MEM_CKPT_END (~0ULL)		/* ends the pages of a checkpoint */
 
 #define MEM_ALIGN 3 /* bottom three bits zero */
 
+#define MEM_PAGE_BITS 12
+#define MEM_PAGE_SIZE (1 << MEM_PAGE_BITS)
+#define MEM_PAGE_WORDS (MEM_PAGE_SIZE >> MEM_ALIGN)
+#define MEM_L2_BITS 10		/* pages per second-level table */
+#define MEM_L1_BITS (32 - MEM_PAGE_BITS - MEM_L2_BITS)
+#define MEM_TLB_SIZE 64		/* power of two */
+#define MEM_FLAT_SIZE (1ULL << 32)	/* bytes covered by Reserve() */
+#define MEM_DIRTY_WORDS (1 << (MEM_L1_BITS + MEM_L2_BITS - 5))
+#define MEM_DIRTY_BIT(addr) (1U << (((addr) >> MEM_PAGE_BITS) & 31))
+
 #ifndef MIN
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
 #endif
 
+struct MemRegion {
+  LL hi;			/* address >> 32 */
+  LL **l1[1 << MEM_L1_BITS];	/* second-level tables, NULL if empty */
+  unsigned int dirty[MEM_DIRTY_WORDS]; /* one bit per page */
+};
+
+struct MemTLB {
+  LL vpn;			/* address >> MEM_PAGE_BITS, ~0 if invalid */
+  LL *page;
+  unsigned int *dirty;		/* word of the page's dirty bit */
+};
+
 class Mem {
 public:
   Mem();
@@ -52,9 +90,42 @@ public:
   int MergeImage (FILE *fp);	// merge image from file with current mem
   int MergeImageAndDuplicate (FILE *fp, Mem*);
   void DumpImage (FILE *fp);	// write current mem to file
+  int ReadELF (FILE *fp, LL *entry, LL *gp); // load fresh MIPS executable
   
-  LL Read (LL addr);
-  void Write (LL addr, LL val);
+  int Reserve (void);		// flat 32-bit space, 0 if unavailable
+  void CopyFrom (Mem *m);	// make this a copy of m
+  void SaveState (FILE *fp, int delta); // binary checkpoint, see mem.cc
+  void RestoreState (FILE *fp);
+
+  void WriteBlock (LL addr, const Byte *buf, LL len); // target byte order
+  void ReadBlock (LL addr, Byte *buf, LL len);
+
+  LL Read (LL addr) {
+    MemTLB *t;
+
+    if (addr < _flatLimit)
+      return _flat[addr >> MEM_ALIGN];
+    t = &_tlb[(addr >> MEM_PAGE_BITS) & (MEM_TLB_SIZE-1)];
+    if (t->vpn != (addr >> MEM_PAGE_BITS) && !(t = _translate (addr, 0)))
+      return MEM_BAD;
+    return t->page[(addr >> MEM_ALIGN) & (MEM_PAGE_WORDS-1)];
+  }
+
+  void Write (LL addr, LL val) {
+    MemTLB *t;
+
+    if (addr < _flatLimit) {
+      _flat[addr >> MEM_ALIGN] = val;
+      _flatPages[addr >> (MEM_PAGE_BITS+5)] |= MEM_DIRTY_BIT (addr);
+      _flatDirty[addr >> (MEM_PAGE_BITS+5)] |= MEM_DIRTY_BIT (addr);
+      return;
+    }
+    t = &_tlb[(addr >> MEM_PAGE_BITS) & (MEM_TLB_SIZE-1)];
+    if (t->vpn != (addr >> MEM_PAGE_BITS))
+      t = _translate (addr, 1);
+    t->page[(addr >> MEM_ALIGN) & (MEM_PAGE_WORDS-1)] = val;
+    *t->dirty |= MEM_DIRTY_BIT (addr);
+  }
   
   Word BEReadWord (LL addr) {
     return BEGetWord (addr, Read (addr));
@@ -120,33 +191,28 @@ public:
   int Compare (Mem *m, int verbose = 1);
 
 private:
-  int _chunks;
-  int _numchunks;
-  int _last_chunk_collect;
-
-  // array of blocks of memory
-  LL **_mem;
+  MemRegion **_regions;		/* sorted by hi */
+  int _nregions, _maxregions;
+  int _lastRegion;
+  int _npages;
 
-  // length of each block
-  LL *_mem_len;
+  MemTLB _tlb[MEM_TLB_SIZE];
 
-  // size of each block
-  // LL *mem_sz;
-
-  // start address for each block
-  LL *_mem_addr;
+  LL *_flat;			/* Reserve()d words, or NULL */
+  LL _flatLimit;		/* bytes of _flat, 0 if none */
+  unsigned int *_flatPages;	/* one bit per page of _flat written */
+  unsigned int *_flatDirty;	/* ... and written since the last SaveState */
 
   void freemem (void);
-  void get_more (int chunkid, long long num, int merging = 0);
-  int  create_new_chunk (LL addr, int ch);
-  void merge_chunks (int chunk1, int chunk2);
-  void chunk_gc (int force);
-
-  inline int _binsearch (LL addr);
-  int _binsearchw (LL addr);
-
-  // Optimize for locality
-  int _lastWriteRow, _lastReadRow;
+  void _freeregion (int i);
+  int _pagecount (void);
+  int _mergebinary (FILE *fp, Mem *dup);
+  void _fill (LL addr, LL end, LL pattern);
+  MemTLB *_translate (LL addr, int alloc);
+  LL *_page (LL addr, int alloc);
+  unsigned int *_dirtyword (LL addr);
+  void _cleardirty (void);
+  LL *_nextpage (LL *addr);
 };
   
 
@@ -175,6 +175,13 @@ void SimCreateTask (SimObject *s, char *name, int stksz = DEFAULT_STACK_SIZE);
    void RestoreState (FILE *fp, UnCheckPoint *uc) { }	\
    void DumpStats (void) { }
 
+#define SAVE_SIM_TEMPLATE   				\
+   void MainLoop(void); 				\
+   void Print (FILE *fp) { }				\
+   void SaveState (FILE *fp);				\
+   void RestoreState (FILE *fp, UnCheckPoint *uc);	\
+   void DumpStats (void) { }
+
 #define FAKE_STATS_TEMPLATE				\
    void MainLoop(void); 				\
    void DumpStats (void);				\
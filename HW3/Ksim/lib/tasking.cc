@@ -512,17 +512,17 @@ void     task_read  (FILE *fp, task *t, int ctxt)
 
 void     count_write (FILE *fp, count_t c)
 {
-  unsigned int x;
+  unsigned long long x;
 
-  x = (unsigned int)c;
+  x = (unsigned long long)c;
   
-  fprintf (fp, "%lu\n", x);
+  fprintf (fp, "%llu\n", x);
 }
 
 void     count_read (FILE *fp, count_t *c)
 {
-  unsigned int x;
+  unsigned long long x;
 
-  fscanf (fp, "%lu", &x);
+  fscanf (fp, "%llu", &x);
   *c = x;
 }